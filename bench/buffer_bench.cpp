@@ -0,0 +1,57 @@
+#include <benchmark/benchmark.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <string>
+#include "../src/buffer/buffer.h"
+
+// 小块追加后整体取出，对应写响应头的用法
+static void BM_BufferAppendRetrieve(benchmark::State& state) {
+    Buffer buff;
+    std::string chunk(state.range(0), 'x');
+    for (auto _ : state) {
+        for (int i = 0; i < 16; i++) {
+            buff.Append(chunk);
+        }
+        benchmark::DoNotOptimize(buff.Peek());
+        buff.RetrieveAll();
+    }
+    state.SetBytesProcessed(state.iterations() * 16 * state.range(0));
+}
+BENCHMARK(BM_BufferAppendRetrieve)->Arg(16)->Arg(256)->Arg(4096);
+
+// 部分取出后继续追加，触发把未读数据挪回头部
+static void BM_BufferPartialRetrieve(benchmark::State& state) {
+    Buffer buff;
+    std::string chunk(state.range(0), 'x');
+    for (auto _ : state) {
+        buff.Append(chunk);
+        buff.Retrieve(chunk.size() / 2);
+        if (buff.ReadableBytes() > 64 * 1024) {
+            buff.RetrieveAll();
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_BufferPartialRetrieve)->Arg(64)->Arg(1024);
+
+// 每次迭代包含一次write和一次ReadFd，两者都是真实的系统调用
+static void BM_BufferReadFd(benchmark::State& state) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+        state.SkipWithError("socketpair failed");
+        return;
+    }
+    std::string data(state.range(0), 'x');
+    Buffer buff;
+    int err = 0;
+    for (auto _ : state) {
+        ssize_t n = write(fds[1], data.data(), data.size());
+        benchmark::DoNotOptimize(n);
+        buff.ReadFd(fds[0], &err);
+        buff.RetrieveAll();
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+    close(fds[0]);
+    close(fds[1]);
+}
+BENCHMARK(BM_BufferReadFd)->Arg(512)->Arg(16 * 1024);
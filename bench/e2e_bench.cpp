@@ -0,0 +1,218 @@
+/*
+端到端回环压测：进程内启动WebServer，用loadgen在127.0.0.1上按不同并发数压测
+1. 在临时目录下生成 resources/，每种文件大小一个 /size_<字节数>.html，外加登录后跳转的页面，工作目录切到该临时目录
+2. 服务端监听内核分配的临时端口，用户存储为memory，不依赖MySQL，关闭日志、慢日志和按IP限流
+3. 对每个(文件大小, 并发数)组合闭环压测一轮，结果汇总为JSON，便于不同版本之间比较
+用法: ./e2ebench [选项]
+  -s, --sizes LIST         文件大小，逗号分隔，可带K/M后缀(默认1K,64K,1M)
+  -c, --concurrency LIST   连接数，逗号分隔(默认1,16,64,256)
+  -d, --duration SEC       每轮时长(默认5)
+  -t, --threads N          压测线程数(默认2)
+  -l, --login PERCENT      请求组合中POST登录的比例(默认0)
+      --json FILE          结果文件(默认e2e.json)
+*/
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fmt/format.h>
+#include "../loadgen/loadgen.h"
+#include "../src/server/webserver.h"
+
+using namespace std;
+
+static bool ParseList(const string& arg, vector<long>& out)
+{
+    out.clear();
+    size_t start = 0;
+    while (start < arg.size()) {
+        size_t end = arg.find(',', start);
+        string item = arg.substr(start, end == string::npos ? string::npos : end - start);
+        char* suffix = nullptr;
+        long value = strtol(item.c_str(), &suffix, 10);
+        if (*suffix == 'K' || *suffix == 'k') {
+            value <<= 10;
+        } else if (*suffix == 'M' || *suffix == 'm') {
+            value <<= 20;
+        } else if (*suffix != '\0') {
+            return false;
+        }
+        if (value <= 0) {
+            return false;
+        }
+        out.push_back(value);
+        if (end == string::npos) {
+            break;
+        }
+        start = end + 1;
+    }
+    return !out.empty();
+}
+
+static bool MakeResources(const filesystem::path& root, const vector<long>& sizes)
+{
+    error_code ec;
+    for (const char* dir : { "resources", "log", "iplist" }) {
+        filesystem::create_directories(root / dir, ec);
+        if (ec) {
+            return false;
+        }
+    }
+    /* 登录成功/失败后返回的页面 */
+    for (const char* page : { "welcome.html", "error.html" }) {
+        ofstream(root / "resources" / page) << "<html><body>" << page << "</body></html>\n";
+    }
+    for (long size : sizes) {
+        ofstream file(root / "resources" / fmt::format("size_{}.html", size), ios::binary);
+        string line(63, 'x');
+        line += '\n';
+        for (long left = size; left > 0; left -= line.size()) {
+            file.write(line.data(), min<long>(left, line.size()));
+        }
+        if (!file) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    enum { OPT_JSON = 256 };
+    static const option LONG_OPTS[] = {
+        { "sizes", required_argument, nullptr, 's' },
+        { "concurrency", required_argument, nullptr, 'c' },
+        { "duration", required_argument, nullptr, 'd' },
+        { "threads", required_argument, nullptr, 't' },
+        { "login", required_argument, nullptr, 'l' },
+        { "json", required_argument, nullptr, OPT_JSON },
+        { "help", no_argument, nullptr, 'h' },
+        { nullptr, 0, nullptr, 0 },
+    };
+    vector<long> sizes = { 1 << 10, 64 << 10, 1 << 20 };
+    vector<long> concurrency = { 1, 16, 64, 256 };
+    double duration = 5;
+    int threads = 2;
+    int loginPercent = 0;
+    string jsonPath = "e2e.json";
+    int opt;
+    while ((opt = getopt_long(argc, argv, "s:c:d:t:l:h", LONG_OPTS, nullptr)) != -1) {
+        bool ok = true;
+        switch (opt) {
+        case 's': ok = ParseList(optarg, sizes); break;
+        case 'c': ok = ParseList(optarg, concurrency); break;
+        case 'd': duration = atof(optarg); ok = duration > 0; break;
+        case 't': threads = atoi(optarg); ok = threads > 0; break;
+        case 'l': loginPercent = atoi(optarg); ok = loginPercent >= 0 && loginPercent <= 100; break;
+        case OPT_JSON: jsonPath = optarg; break;
+        default: ok = false; break;
+        }
+        if (!ok) {
+            fprintf(stderr, "usage: %s [-s 1K,64K,1M] [-c 1,16,64,256] [-d seconds] [-t threads] "
+                            "[-l login%%] [--json file]\n", argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    jsonPath = filesystem::absolute(jsonPath).string();
+
+    char tmpl[] = "/tmp/e2ebenchXXXXXX";
+    if (!mkdtemp(tmpl)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    filesystem::path root = tmpl;
+    if (!MakeResources(root, sizes) || chdir(tmpl) != 0) {
+        fprintf(stderr, "prepare %s failed\n", tmpl);
+        return 1;
+    }
+
+    int result = 0;
+    {
+        ServerConfig serverConfig;
+        serverConfig.port = 0;
+        serverConfig.userStore = "memory";
+        serverConfig.log = false;
+        serverConfig.slowRequestMs = 0;
+        /* 所有连接都来自127.0.0.1，按IP限流会把压测本身挡掉 */
+        serverConfig.maxConnPerIp = 0;
+        serverConfig.ipRate = 0;
+        WebServer server(serverConfig);
+        if (server.IsClosed()) {
+            fprintf(stderr, "server init failed\n");
+            filesystem::remove_all(root);
+            return 1;
+        }
+        thread loop([&server]() { server.Start(); });
+
+        LoadConfig base;
+        base.port = server.Port();
+        base.durationSec = duration;
+
+        /* 预热：注册登录用的账号，同时让文件进入页缓存 */
+        LoadConfig warmup = base;
+        warmup.threads = 1;
+        warmup.connections = 1;
+        warmup.durationSec = 0.2;
+        warmup.mix.push_back({ "POST", "/register.html", "username=bench&password=bench", 1 });
+        for (long size : sizes) {
+            warmup.mix.push_back({ "GET", fmt::format("/size_{}.html", size), "", 1 });
+        }
+        RunLoad(warmup);
+
+        string json = fmt::format("{{\"port\":{},\"durationSec\":{},\"loginPercent\":{},\"runs\":[",
+                                  base.port, duration, loginPercent);
+        printf("%10s %8s %12s %10s %10s %10s %8s\n", "size", "conns", "req/s", "p50(us)", "p99(us)", "p99.9(us)", "errors");
+        bool first = true;
+        for (long size : sizes) {
+            for (long conns : concurrency) {
+                LoadConfig config = base;
+                config.connections = conns;
+                config.threads = min<int>(threads, conns);
+                config.mix.push_back({ "GET", fmt::format("/size_{}.html", size), "", 100 - loginPercent });
+                if (loginPercent > 0) {
+                    config.mix.push_back({ "POST", "/login.html", "username=bench&password=bench", loginPercent });
+                }
+                if (config.mix.front().weight == 0) {
+                    config.mix.erase(config.mix.begin());
+                }
+                LoadResult r = RunLoad(config);
+                uint64_t errors = r.connectErrors + r.readErrors + r.timeouts;
+                for (auto& kv : r.status) {
+                    errors += kv.first == 200 ? 0 : kv.second;
+                }
+                printf("%10ld %8ld %12.1f %10lu %10lu %10lu %8lu\n", size, conns,
+                       r.seconds > 0 ? r.requests / r.seconds : 0,
+                       (unsigned long)r.latency.Percentile(0.5), (unsigned long)r.latency.Percentile(0.99),
+                       (unsigned long)r.latency.Percentile(0.999), (unsigned long)errors);
+                fflush(stdout);
+                if (r.requests == 0) {
+                    result = 1;
+                }
+                /* 在loadgen的结果对象前补上文件大小 */
+                json += fmt::format("{}{{\"fileBytes\":{},{}", first ? "" : ",", size, ResultJson(config, r).substr(1));
+                first = false;
+            }
+        }
+        json += "]}";
+
+        server.Stop();
+        loop.join();
+
+        FILE* fp = fopen(jsonPath.c_str(), "w");
+        if (fp) {
+            fprintf(fp, "%s\n", json.c_str());
+            fclose(fp);
+            printf("results written to %s\n", jsonPath.c_str());
+        } else {
+            fprintf(stderr, "open %s failed\n", jsonPath.c_str());
+            result = 1;
+        }
+    }
+    filesystem::remove_all(root);
+    return result;
+}
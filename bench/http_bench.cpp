@@ -0,0 +1,93 @@
+#include <benchmark/benchmark.h>
+#include <string>
+#include "../src/buffer/buffer.h"
+#include "../src/http/httprequest.h"
+#include "../src/http/httpresponse.h"
+
+// 浏览器发出的典型GET请求
+static const char BROWSER_GET[] =
+    "GET /index.html HTTP/1.1\r\n"
+    "Host: 127.0.0.1:1316\r\n"
+    "Connection: keep-alive\r\n"
+    "Cache-Control: max-age=0\r\n"
+    "Upgrade-Insecure-Requests: 1\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0 Safari/537.36\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,*/*;q=0.8\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+    "\r\n";
+
+static const char LOGIN_POST[] =
+    "POST /login HTTP/1.1\r\n"
+    "Host: 127.0.0.1:1316\r\n"
+    "Connection: keep-alive\r\n"
+    "Content-Type: application/x-www-form-urlencoded\r\n"
+    "Content-Length: 35\r\n"
+    "\r\n"
+    "username=alice%40example&password=p";
+
+static void ParseRequest(benchmark::State& state, const char* raw, size_t len) {
+    Buffer buff;
+    HttpRequest request;
+    for (auto _ : state) {
+        buff.Append(raw, len);
+        request.Init();
+        bool ok = request.parse(buff);
+        benchmark::DoNotOptimize(ok);
+        buff.RetrieveAll();
+    }
+    state.SetBytesProcessed(state.iterations() * len);
+}
+
+static void BM_ParseGet(benchmark::State& state) {
+    ParseRequest(state, BROWSER_GET, sizeof(BROWSER_GET) - 1);
+}
+BENCHMARK(BM_ParseGet);
+
+static void BM_ParseLoginPost(benchmark::State& state) {
+    ParseRequest(state, LOGIN_POST, sizeof(LOGIN_POST) - 1);
+}
+BENCHMARK(BM_ParseLoginPost);
+
+// 静态文件：每次都要stat+open+mmap，与io线程上的实际路径一致
+static void BM_MakeResponseFile(benchmark::State& state) {
+    Buffer buff;
+    HttpResponse response;
+    for (auto _ : state) {
+        std::string path = "/index.html";
+        response.Init("../resources", path, true, 200);
+        response.MakeResponse(buff);
+        benchmark::DoNotOptimize(response.File());
+        response.UnmapFile();
+        buff.RetrieveAll();
+    }
+}
+BENCHMARK(BM_MakeResponseFile);
+
+static void BM_MakeResponseNotFound(benchmark::State& state) {
+    Buffer buff;
+    HttpResponse response;
+    for (auto _ : state) {
+        std::string path = "/no-such-file.html";
+        response.Init("../resources", path, true, 200);
+        response.MakeResponse(buff);
+        response.UnmapFile();
+        buff.RetrieveAll();
+    }
+}
+BENCHMARK(BM_MakeResponseNotFound);
+
+// 动态处理函数(/stats、/metrics)生成的响应体
+static void BM_MakeResponseContent(benchmark::State& state) {
+    Buffer buff;
+    HttpResponse response;
+    std::string body(state.range(0), 'x');
+    for (auto _ : state) {
+        std::string path = "/stats";
+        response.Init("../resources", path, true, 200);
+        response.SetContent(body, "application/json");
+        response.MakeResponse(buff);
+        buff.RetrieveAll();
+    }
+}
+BENCHMARK(BM_MakeResponseContent)->Arg(256)->Arg(8192);
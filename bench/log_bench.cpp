@@ -0,0 +1,44 @@
+#include <benchmark/benchmark.h>
+#include <stdlib.h>
+#include <string>
+#include "../src/log/log.h"
+
+// 日志写到临时目录，进程内只初始化一次(文本模式)
+static void InitLog() {
+    static bool inited = []() {
+        char dir[] = "/tmp/logbenchXXXXXX";
+        if (!mkdtemp(dir)) {
+            return false;
+        }
+        Log::Instance()->init(0, dir, ".log", 4096, LOG_TEXT);
+        return true;
+    }();
+    (void)inited;
+}
+
+// 调用线程上格式化一行并拷进本线程的缓冲区；->Threads(N)衡量多线程争用
+static void BM_LogWrite(benchmark::State& state) {
+    InitLog();
+    if (state.thread_index() == 0) {
+        Log::Instance()->SetLevel(0);
+    }
+    std::string path = "/index.html";
+    int fd = 42;
+    for (auto _ : state) {
+        LOG_INFO("Client[{}] {} {} {}us", fd, "GET", path, 123);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LogWrite)->Threads(1)->Threads(4)->UseRealTime();
+
+// 级别被过滤掉的调用点只读一个原子变量
+static void BM_LogFiltered(benchmark::State& state) {
+    InitLog();
+    Log::Instance()->SetLevel(1);
+    int fd = 42;
+    for (auto _ : state) {
+        LOG_DEBUG("Client[{}] filtered", fd);
+    }
+    Log::Instance()->SetLevel(0);
+}
+BENCHMARK(BM_LogFiltered);
@@ -0,0 +1,65 @@
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "../src/log/blockQueue.h"
+#include "../src/pool/threadpool.h"
+
+static const int ITEMS_PER_PRODUCER = 100000;
+
+// range(0)个生产者、一个消费者，统计每秒通过队列的元素数
+static void BM_BlockDequeThroughput(benchmark::State& state) {
+    const int producers = state.range(0);
+    for (auto _ : state) {
+        BlockDeque<int> queue(1000);
+        std::thread consumer([&queue, producers]() {
+            int item;
+            for (int i = 0; i < producers * ITEMS_PER_PRODUCER; i++) {
+                queue.pop(item);
+            }
+        });
+        std::vector<std::thread> threads;
+        for (int p = 0; p < producers; p++) {
+            threads.emplace_back([&queue]() {
+                for (int i = 0; i < ITEMS_PER_PRODUCER; i++) {
+                    queue.push_back(i);
+                }
+            });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+        consumer.join();
+    }
+    state.SetItemsProcessed(state.iterations() * producers * ITEMS_PER_PRODUCER);
+}
+BENCHMARK(BM_BlockDequeThroughput)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// range(0)个线程用commit提交空任务给4线程的池，与DealRead_/DealWrite_的用法相同
+static void BM_ThreadPoolThroughput(benchmark::State& state) {
+    const int producers = state.range(0);
+    const int tasks = ITEMS_PER_PRODUCER / 10;
+    for (auto _ : state) {
+        std::atomic<int> done{0};
+        {
+            ThreadPool pool(4, 1000);
+            pool.start();
+            std::vector<std::thread> threads;
+            for (int p = 0; p < producers; p++) {
+                threads.emplace_back([&pool, &done, tasks]() {
+                    for (int i = 0; i < tasks; i++) {
+                        pool.commit([&done]() { done.fetch_add(1, std::memory_order_relaxed); });
+                    }
+                });
+            }
+            for (auto& t : threads) {
+                t.join();
+            }
+            while (done.load() < producers * tasks) {
+                std::this_thread::yield();
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * producers * tasks);
+}
+BENCHMARK(BM_ThreadPoolThroughput)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime()->Unit(benchmark::kMillisecond);
@@ -0,0 +1,66 @@
+#include <benchmark/benchmark.h>
+#include <random>
+#include "../src/timer/heaptimer.h"
+
+static const int TIMERS = 100000;
+
+static TimeoutCallBack NoopCallback() {
+    static TimeoutCallBack cb = std::make_shared<std::function<void()>>([]() {});
+    return cb;
+}
+
+static void BM_HeapTimerAdd(benchmark::State& state) {
+    for (auto _ : state) {
+        HeapTimer timer;
+        for (int id = 0; id < state.range(0); id++) {
+            timer.add(id, 60000 + id % 1000, NoopCallback());
+        }
+        state.PauseTiming();
+        timer.clear();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_HeapTimerAdd)->Arg(TIMERS)->Unit(benchmark::kMillisecond);
+
+// 每次读写事件都会reset一次，对应 WebServer::ExtentTime_
+static void BM_HeapTimerReset(benchmark::State& state) {
+    HeapTimer timer;
+    for (int id = 0; id < state.range(0); id++) {
+        timer.add(id, 60000, NoopCallback());
+    }
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> pick(0, state.range(0) - 1);
+    for (auto _ : state) {
+        timer.reset(pick(rng), 60000);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_HeapTimerReset)->Arg(TIMERS);
+
+// 10万个已到期的定时器，一次tick全部触发
+static void BM_HeapTimerTick(benchmark::State& state) {
+    HeapTimer timer;
+    for (auto _ : state) {
+        state.PauseTiming();
+        for (int id = 0; id < state.range(0); id++) {
+            timer.add(id, 0, NoopCallback());
+        }
+        state.ResumeTiming();
+        timer.tick();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_HeapTimerTick)->Arg(TIMERS)->Unit(benchmark::kMillisecond);
+
+// 没有到期定时器时的tick，即每轮epoll_wait之前的固定开销
+static void BM_HeapTimerNextTimeout(benchmark::State& state) {
+    HeapTimer timer;
+    for (int id = 0; id < state.range(0); id++) {
+        timer.add(id, 60000, NoopCallback());
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(timer.GetNextTimeout());
+    }
+}
+BENCHMARK(BM_HeapTimerNextTimeout)->Arg(TIMERS);
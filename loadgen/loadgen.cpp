@@ -0,0 +1,587 @@
+#include "loadgen.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <random>
+#include <thread>
+#include <fmt/format.h>
+using namespace std;
+
+static int64_t NowNs()
+{
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool ParseLoadRequest(const string& spec, LoadRequest& request)
+{
+    string rest = spec;
+    size_t star = rest.find('*');
+    size_t space = rest.find(' ');
+    if (star != string::npos && (space == string::npos || star < space)) {
+        request.weight = atoi(rest.substr(0, star).c_str());
+        rest = rest.substr(star + 1);
+        if (request.weight <= 0) {
+            return false;
+        }
+    }
+    space = rest.find(' ');
+    if (space == string::npos || space == 0) {
+        return false;
+    }
+    request.method = rest.substr(0, space);
+    rest = rest.substr(space + 1);
+    space = rest.find(' ');
+    request.path = rest.substr(0, space);
+    request.body = space == string::npos ? "" : rest.substr(space + 1);
+    return !request.path.empty() && request.path[0] == '/';
+}
+
+static string RenderRequest(const LoadConfig& config, const LoadRequest& req)
+{
+    string out = fmt::format("{} {} HTTP/1.1\r\nHost: {}:{}\r\nConnection: {}\r\n",
+                             req.method, req.path, config.host, config.port,
+                             config.keepAlive ? "keep-alive" : "close");
+    if (!req.body.empty()) {
+        out += fmt::format("Content-Type: application/x-www-form-urlencoded\r\nContent-Length: {}\r\n",
+                           req.body.size());
+    }
+    out += "\r\n";
+    out += req.body;
+    return out;
+}
+
+namespace {
+
+struct Conn {
+    int fd = -1;
+    bool connected = false;
+    bool closeAfter = false;        // 服务端在最近的响应里要求关闭连接
+    int64_t retryAtNs = 0;          // 建连失败后的重试时刻
+    string out;
+    size_t outOff = 0;
+    string in;
+    size_t inOff = 0;
+    deque<int64_t> inflight;        // 在途请求的起始时刻，开环模式下为计划发送时刻
+};
+
+/* 一个线程的压测循环 */
+class Worker {
+public:
+    Worker(const LoadConfig& config, const sockaddr_in& addr, int connNum, double rate,
+           const vector<string>& requests, const vector<int>& weights,
+           Histogram* latency, int64_t startNs, int64_t endNs, uint64_t seed)
+        : config_(config), addr_(addr), conns_(connNum), rate_(rate),
+          requests_(requests), weights_(weights), latency_(latency),
+          startNs_(startNs), endNs_(endNs), rng_(seed)
+    {
+        depth_ = config_.keepAlive ? max(config_.pipeline, 1) : 1;
+        totalWeight_ = weights_.empty() ? 0 : weights_.back();
+    }
+
+    void Run();
+    LoadResult result;
+
+private:
+    static const int64_t RETRY_NS = 10 * 1000 * 1000;
+
+    void Connect_(Conn& conn);
+    void Reconnect_(Conn& conn, bool lost);
+    void OnEvent_(Conn& conn, uint32_t events);
+    bool Flush_(Conn& conn);
+    void Send_(Conn& conn, int64_t startNs);
+    void OnResponses_(Conn& conn);
+    void Fill_(Conn& conn);
+    void Dispatch_(int64_t now);
+    void CheckTimeouts_(int64_t now);
+    void Observe_(int64_t startNs, int64_t endNs);
+    void Finish_();
+    const string& Pick_();
+
+    const LoadConfig& config_;
+    sockaddr_in addr_;
+    vector<Conn> conns_;
+    double rate_;
+    const vector<string>& requests_;
+    const vector<int>& weights_;
+    Histogram* latency_;
+    int64_t startNs_;
+    int64_t endNs_;
+    mt19937_64 rng_;
+    int depth_;
+    int totalWeight_;
+    int epfd_ = -1;
+    int timerFd_ = -1;
+
+    /* 开环模式：到了计划时刻但还没有连接可用的请求 */
+    deque<int64_t> backlog_;
+    int64_t nextSendNs_ = 0;
+    int64_t intervalNs_ = 0;
+    size_t rr_ = 0;
+};
+
+const string& Worker::Pick_()
+{
+    if (requests_.size() == 1) {
+        return requests_[0];
+    }
+    int r = uniform_int_distribution<int>(0, totalWeight_ - 1)(rng_);
+    size_t idx = upper_bound(weights_.begin(), weights_.end(), r) - weights_.begin();
+    return requests_[idx];
+}
+
+void Worker::Connect_(Conn& conn)
+{
+    conn = Conn();
+    conn.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (conn.fd < 0) {
+        result.connectErrors++;
+        conn.retryAtNs = NowNs() + RETRY_NS;
+        return;
+    }
+    int one = 1;
+    setsockopt(conn.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    int ret = connect(conn.fd, reinterpret_cast<const sockaddr*>(&addr_), sizeof(addr_));
+    if (ret < 0 && errno != EINPROGRESS) {
+        close(conn.fd);
+        conn.fd = -1;
+        result.connectErrors++;
+        conn.retryAtNs = NowNs() + RETRY_NS;
+        return;
+    }
+    epoll_event ev = {};
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.ptr = &conn;
+    epoll_ctl(epfd_, EPOLL_CTL_ADD, conn.fd, &ev);
+}
+
+/* lost为true表示在途请求随连接一起丢失 */
+void Worker::Reconnect_(Conn& conn, bool lost)
+{
+    if (lost) {
+        result.readErrors += conn.inflight.size();
+    }
+    if (conn.fd >= 0) {
+        close(conn.fd); // close会把fd从epoll中移除
+    }
+    Connect_(conn);
+}
+
+bool Worker::Flush_(Conn& conn)
+{
+    while (conn.outOff < conn.out.size()) {
+        ssize_t n = send(conn.fd, conn.out.data() + conn.outOff, conn.out.size() - conn.outOff, MSG_NOSIGNAL);
+        if (n < 0) {
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        conn.outOff += n;
+    }
+    conn.out.clear();
+    conn.outOff = 0;
+    return true;
+}
+
+void Worker::Send_(Conn& conn, int64_t startNs)
+{
+    conn.out += Pick_();
+    conn.inflight.push_back(startNs);
+    if (!Flush_(conn)) {
+        Reconnect_(conn, true);
+    }
+}
+
+void Worker::Fill_(Conn& conn)
+{
+    while (conn.fd >= 0 && conn.connected && !conn.closeAfter &&
+           static_cast<int>(conn.inflight.size()) < depth_ && NowNs() < endNs_) {
+        Send_(conn, NowNs());
+    }
+}
+
+void Worker::Dispatch_(int64_t now)
+{
+    while (nextSendNs_ <= now && nextSendNs_ < endNs_) {
+        backlog_.push_back(nextSendNs_);
+        nextSendNs_ += intervalNs_;
+    }
+    /* 轮流找还有空位的连接，全都占满时请求留在backlog里继续计时 */
+    size_t tried = 0;
+    while (!backlog_.empty() && tried < conns_.size()) {
+        Conn& conn = conns_[rr_++ % conns_.size()];
+        if (conn.fd >= 0 && conn.connected && !conn.closeAfter && static_cast<int>(conn.inflight.size()) < depth_) {
+            Send_(conn, backlog_.front());
+            backlog_.pop_front();
+            tried = 0;
+        } else {
+            tried++;
+        }
+    }
+}
+
+void Worker::OnResponses_(Conn& conn)
+{
+    while (conn.inOff < conn.in.size()) {
+        size_t hdrEnd = conn.in.find("\r\n\r\n", conn.inOff);
+        if (hdrEnd == string::npos) {
+            break;
+        }
+        const char* p = conn.in.data() + conn.inOff;
+        int status = 0;
+        if (strncmp(p, "HTTP/1.", 7) == 0 && hdrEnd - conn.inOff > 12) {
+            status = atoi(p + 9);
+        }
+        size_t bodyLen = 0;
+        bool closeConn = false;
+        size_t lineStart = conn.in.find("\r\n", conn.inOff) + 2;
+        while (lineStart < hdrEnd + 2) {
+            size_t lineEnd = conn.in.find("\r\n", lineStart);
+            size_t colon = conn.in.find(':', lineStart);
+            if (colon != string::npos && colon < lineEnd) {
+                string name = conn.in.substr(lineStart, colon - lineStart);
+                transform(name.begin(), name.end(), name.begin(), ::tolower);
+                const char* value = conn.in.data() + colon + 1;
+                while (*value == ' ') {
+                    value++;
+                }
+                if (name == "content-length") {
+                    bodyLen = strtoul(value, nullptr, 10);
+                } else if (name == "connection" && strncasecmp(value, "close", 5) == 0) {
+                    closeConn = true;
+                }
+            }
+            lineStart = lineEnd + 2;
+        }
+        size_t total = hdrEnd + 4 + bodyLen - conn.inOff;
+        if (conn.in.size() - conn.inOff < total) {
+            break;
+        }
+        conn.inOff += total;
+        if (conn.inflight.empty()) {
+            /* 服务端主动发来的响应(例如拒绝连接时) */
+            closeConn = true;
+        } else {
+            Observe_(conn.inflight.front(), NowNs());
+            conn.inflight.pop_front();
+            result.requests++;
+        }
+        result.bytes += total;
+        result.status[status]++;
+        if (closeConn) {
+            conn.closeAfter = true;
+            break;
+        }
+    }
+    if (conn.inOff == conn.in.size()) {
+        conn.in.clear();
+        conn.inOff = 0;
+    } else if (conn.inOff > (1 << 16)) {
+        conn.in.erase(0, conn.inOff);
+        conn.inOff = 0;
+    }
+}
+
+void Worker::Observe_(int64_t startNs, int64_t endNs)
+{
+    uint64_t us = max<int64_t>(endNs - startNs, 0) / 1000;
+    latency_->Observe(us);
+    result.maxLatencyUs = max(result.maxLatencyUs, us);
+}
+
+/* 结束时刻还在排队或在途的请求按已经等待的时间记入延迟，并单独计数 */
+void Worker::Finish_()
+{
+    if (rate_ > 0) {
+        /* 最后一次Dispatch_之后到结束时刻之间计划的请求也没能发出 */
+        while (nextSendNs_ < endNs_) {
+            backlog_.push_back(nextSendNs_);
+            nextSendNs_ += intervalNs_;
+        }
+    }
+    for (int64_t scheduled : backlog_) {
+        Observe_(scheduled, endNs_);
+    }
+    result.unsent += backlog_.size();
+    backlog_.clear();
+    for (Conn& conn : conns_) {
+        for (int64_t startNs : conn.inflight) {
+            Observe_(startNs, endNs_);
+        }
+        result.incomplete += conn.inflight.size();
+        conn.inflight.clear();
+    }
+}
+
+void Worker::OnEvent_(Conn& conn, uint32_t events)
+{
+    if (!conn.connected) {
+        int err = 0;
+        socklen_t len = sizeof(err);
+        getsockopt(conn.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+        if (err != 0 || (events & (EPOLLERR | EPOLLHUP))) {
+            result.connectErrors++;
+            close(conn.fd);
+            conn.fd = -1;
+            conn.retryAtNs = NowNs() + RETRY_NS;
+            return;
+        }
+        if (!(events & EPOLLOUT)) {
+            return;
+        }
+        conn.connected = true;
+        result.connects++;
+    }
+    if (events & EPOLLIN) {
+        char buf[65536];
+        bool eof = false;
+        while (true) {
+            ssize_t n = read(conn.fd, buf, sizeof(buf));
+            if (n > 0) {
+                conn.in.append(buf, n);
+                continue;
+            }
+            eof = n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK);
+            break;
+        }
+        OnResponses_(conn);
+        if (eof || conn.closeAfter) {
+            Reconnect_(conn, !conn.inflight.empty());
+            return;
+        }
+    }
+    if ((events & EPOLLOUT) && !Flush_(conn)) {
+        Reconnect_(conn, true);
+        return;
+    }
+    if ((events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) && !(events & EPOLLIN)) {
+        Reconnect_(conn, true);
+        return;
+    }
+    if (rate_ <= 0) {
+        Fill_(conn);
+    }
+}
+
+void Worker::CheckTimeouts_(int64_t now)
+{
+    int64_t limit = static_cast<int64_t>(config_.timeoutMs) * 1000 * 1000;
+    for (Conn& conn : conns_) {
+        if (conn.fd < 0) {
+            if (now >= conn.retryAtNs) {
+                Connect_(conn);
+            }
+        } else if (!conn.inflight.empty() && now - conn.inflight.front() > limit) {
+            result.timeouts += conn.inflight.size();
+            conn.inflight.clear();
+            Reconnect_(conn, false);
+        }
+    }
+}
+
+void Worker::Run()
+{
+    epfd_ = epoll_create1(0);
+    if (rate_ > 0) {
+        intervalNs_ = max<int64_t>(static_cast<int64_t>(1e9 / rate_), 1);
+        nextSendNs_ = startNs_;
+        timerFd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+        epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.ptr = nullptr;
+        epoll_ctl(epfd_, EPOLL_CTL_ADD, timerFd_, &ev);
+    }
+    for (Conn& conn : conns_) {
+        Connect_(conn);
+    }
+    epoll_event events[256];
+    int64_t lastCheck = NowNs();
+    while (true) {
+        int64_t now = NowNs();
+        if (now >= endNs_) {
+            break;
+        }
+        if (rate_ > 0) {
+            Dispatch_(now);
+            /* timerfd按纳秒精度在下一个计划时刻唤醒，epoll_wait的毫秒超时不够细 */
+            int64_t wake = max(nextSendNs_, now + 1000);
+            itimerspec spec = {};
+            spec.it_value.tv_sec = wake / 1000000000;
+            spec.it_value.tv_nsec = wake % 1000000000;
+            timerfd_settime(timerFd_, TFD_TIMER_ABSTIME, &spec, nullptr);
+        }
+        int waitMs = static_cast<int>(min<int64_t>((endNs_ - now) / 1000000 + 1, 100));
+        int n = epoll_wait(epfd_, events, 256, waitMs);
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.ptr == nullptr) {
+                uint64_t expirations;
+                ssize_t ret = read(timerFd_, &expirations, sizeof(expirations));
+                (void)ret;
+                continue;
+            }
+            OnEvent_(*static_cast<Conn*>(events[i].data.ptr), events[i].events);
+        }
+        now = NowNs();
+        if (now - lastCheck >= 10 * 1000 * 1000) {
+            CheckTimeouts_(now);
+            lastCheck = now;
+        }
+    }
+    Finish_();
+    for (Conn& conn : conns_) {
+        if (conn.fd >= 0) {
+            close(conn.fd);
+        }
+    }
+    if (timerFd_ >= 0) {
+        close(timerFd_);
+    }
+    close(epfd_);
+}
+
+} // namespace
+
+static bool Resolve(const string& host, int port, sockaddr_in& addr)
+{
+    addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* res = nullptr;
+    if (getaddrinfo(host.c_str(), nullptr, &hints, &res) != 0 || !res) {
+        return false;
+    }
+    addr = *reinterpret_cast<sockaddr_in*>(res->ai_addr);
+    addr.sin_port = htons(port);
+    freeaddrinfo(res);
+    return true;
+}
+
+LoadResult RunLoad(const LoadConfig& config)
+{
+    LoadResult total;
+    sockaddr_in addr;
+    if (!Resolve(config.host, config.port, addr)) {
+        total.connectErrors = 1;
+        return total;
+    }
+    vector<LoadRequest> mix = config.mix.empty() ? vector<LoadRequest>(1) : config.mix;
+    vector<string> requests;
+    vector<int> weights;
+    int sum = 0;
+    for (auto& req : mix) {
+        requests.push_back(RenderRequest(config, req));
+        sum += req.weight;
+        weights.push_back(sum);
+    }
+
+    int threads = max(1, min(config.threads, config.connections));
+    Histogram latency;
+    vector<unique_ptr<Worker>> workers;
+    int64_t startNs = NowNs();
+    int64_t endNs = startNs + static_cast<int64_t>(config.durationSec * 1e9);
+    random_device rd;
+    for (int i = 0; i < threads; i++) {
+        int connNum = config.connections / threads + (i < config.connections % threads ? 1 : 0);
+        workers.emplace_back(make_unique<Worker>(config, addr, connNum, config.rate / threads,
+                                                 requests, weights, &latency, startNs, endNs, rd()));
+    }
+    vector<thread> pool;
+    for (auto& worker : workers) {
+        pool.emplace_back([&worker]() { worker->Run(); });
+    }
+    for (auto& t : pool) {
+        t.join();
+    }
+    total.seconds = (NowNs() - startNs) / 1e9;
+    for (auto& worker : workers) {
+        const LoadResult& r = worker->result;
+        total.requests += r.requests;
+        total.bytes += r.bytes;
+        total.connects += r.connects;
+        total.connectErrors += r.connectErrors;
+        total.readErrors += r.readErrors;
+        total.timeouts += r.timeouts;
+        total.unsent += r.unsent;
+        total.incomplete += r.incomplete;
+        total.maxLatencyUs = max(total.maxLatencyUs, r.maxLatencyUs);
+        for (auto& kv : r.status) {
+            total.status[kv.first] += kv.second;
+        }
+    }
+    total.latency = latency.Snap();
+    return total;
+}
+
+static string FormatUs(uint64_t us)
+{
+    if (us >= 1000000) {
+        return fmt::format("{:.2f}s", us / 1e6);
+    } else if (us >= 1000) {
+        return fmt::format("{:.2f}ms", us / 1e3);
+    }
+    return fmt::format("{}us", us);
+}
+
+static const double PERCENTILES[] = { 0.5, 0.9, 0.99, 0.999 };
+
+string FormatResult(const LoadConfig& config, const LoadResult& r)
+{
+    fmt::memory_buffer out;
+    auto it = back_inserter(out);
+    fmt::format_to(it, "{}:{}  {} threads, {} connections, pipeline {}, {}, {}\n",
+                   config.host, config.port, config.threads, config.connections, config.pipeline,
+                   config.keepAlive ? "keep-alive" : "close",
+                   config.rate > 0 ? fmt::format("open loop {} req/s", config.rate) : string("closed loop"));
+    fmt::format_to(it, "  {} requests in {:.2f}s, {:.2f} MB read\n", r.requests, r.seconds, r.bytes / 1e6);
+    fmt::format_to(it, "  Requests/sec: {:.1f}   Transfer/sec: {:.2f} MB\n",
+                   r.seconds > 0 ? r.requests / r.seconds : 0, r.seconds > 0 ? r.bytes / 1e6 / r.seconds : 0);
+    fmt::format_to(it, "  Latency  mean {}  max {}\n",
+                   FormatUs(r.latency.count ? r.latency.sum / r.latency.count : 0), FormatUs(r.maxLatencyUs));
+    for (double q : PERCENTILES) {
+        fmt::format_to(it, "    p{:<6} {}\n", q * 100, FormatUs(r.latency.Percentile(q)));
+    }
+    fmt::format_to(it, "  Status");
+    for (auto& kv : r.status) {
+        fmt::format_to(it, "  {}: {}", kv.first, kv.second);
+    }
+    fmt::format_to(it, "\n  Connects {}, connect errors {}, lost {}, timeouts {}\n",
+                   r.connects, r.connectErrors, r.readErrors, r.timeouts);
+    fmt::format_to(it, "  At end: {} unsent, {} incomplete (counted in latency up to the end of the run)\n",
+                   r.unsent, r.incomplete);
+    return fmt::to_string(out);
+}
+
+string ResultJson(const LoadConfig& config, const LoadResult& r)
+{
+    fmt::memory_buffer out;
+    auto it = back_inserter(out);
+    fmt::format_to(it, "{{\"threads\":{},\"connections\":{},\"pipeline\":{},\"keepAlive\":{},\"rate\":{},",
+                   config.threads, config.connections, config.pipeline, config.keepAlive, config.rate);
+    fmt::format_to(it, "\"seconds\":{:.3f},\"requests\":{},\"bytes\":{},\"rps\":{:.1f},",
+                   r.seconds, r.requests, r.bytes, r.seconds > 0 ? r.requests / r.seconds : 0);
+    fmt::format_to(it, "\"latencyUs\":{{\"mean\":{},\"max\":{}",
+                   r.latency.count ? r.latency.sum / r.latency.count : 0, r.maxLatencyUs);
+    for (double q : PERCENTILES) {
+        fmt::format_to(it, ",\"p{}\":{}", q * 100, r.latency.Percentile(q));
+    }
+    fmt::format_to(it, "}},\"status\":{{");
+    bool first = true;
+    for (auto& kv : r.status) {
+        fmt::format_to(it, "{}\"{}\":{}", first ? "" : ",", kv.first, kv.second);
+        first = false;
+    }
+    fmt::format_to(it, "}},\"connects\":{},\"connectErrors\":{},\"lost\":{},\"timeouts\":{},",
+                   r.connects, r.connectErrors, r.readErrors, r.timeouts);
+    fmt::format_to(it, "\"unsent\":{},\"incomplete\":{}}}", r.unsent, r.incomplete);
+    return fmt::to_string(out);
+}
@@ -0,0 +1,63 @@
+#ifndef LOADGEN_H
+#define LOADGEN_H
+/*
+多线程epoll压测客户端，取代webbench的一请求一进程一连接模型
+1. 每个线程一个epoll，负责 connections/threads 个非阻塞连接
+2. keep-alive下连接复用，每个连接最多同时有 pipeline 个未完成的请求(HTTP流水线)
+3. 闭环模式(rate == 0)：连接收到响应后立刻发下一个，延迟从真正发出时算起
+   开环模式(rate > 0)：按固定速率排好每个请求的计划发送时刻，延迟从计划时刻算起，
+   服务端变慢时排队等待的时间也计入延迟，避免协同遗漏(coordinated omission)。
+   到结束时刻还没发出(unsent)或还没收到响应(incomplete)的请求同样记一个延迟样本，
+   取结束时刻减去计划/发出时刻，是真实延迟的下限；否则压测末尾积压最严重的请求会从分位数里消失
+4. 延迟记入 Histogram(对数-线性分桶，相对误差 <= 12.5%)，输出p50/p90/p99/p99.9
+*/
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "../src/metrics/metrics.h"
+
+struct LoadRequest {
+    std::string method = "GET";
+    std::string path = "/";
+    std::string body;           // 非空时按表单提交
+    int weight = 1;             // 在请求组合中的权重
+};
+
+struct LoadConfig {
+    std::string host = "127.0.0.1";
+    int port = 1316;
+    int threads = 2;
+    int connections = 64;       // 所有线程合计
+    int pipeline = 1;           // 每个连接最多的在途请求数，keepAlive为false时固定为1
+    bool keepAlive = true;
+    double durationSec = 10;
+    double rate = 0;            // 所有线程合计的请求速率(req/s)，0为闭环模式
+    int timeoutMs = 5000;       // 在途请求超过该时间没有响应，断开重连并计为超时
+    std::vector<LoadRequest> mix;
+};
+
+struct LoadResult {
+    double seconds = 0;
+    uint64_t requests = 0;      // 收到完整响应的请求数
+    uint64_t bytes = 0;         // 收到的响应字节数(含头)
+    uint64_t connects = 0;
+    uint64_t connectErrors = 0;
+    uint64_t readErrors = 0;    // 在途请求因连接断开而丢失的次数
+    uint64_t timeouts = 0;
+    uint64_t unsent = 0;        // 开环模式下到结束时刻仍在排队、没有连接可发的请求
+    uint64_t incomplete = 0;    // 到结束时刻已发出但还没收到响应的请求
+    uint64_t maxLatencyUs = 0;
+    std::map<int, uint64_t> status;
+    Histogram::Snapshot latency; // 微秒
+};
+
+/* 解析请求组合的一项："[权重*]方法 路径 [表单]"，例如 "3*POST /login username=a&password=b" */
+bool ParseLoadRequest(const std::string& spec, LoadRequest& request);
+
+LoadResult RunLoad(const LoadConfig& config);
+
+std::string FormatResult(const LoadConfig& config, const LoadResult& result);
+std::string ResultJson(const LoadConfig& config, const LoadResult& result);
+
+#endif // LOADGEN_H
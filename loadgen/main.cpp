@@ -0,0 +1,107 @@
+/*
+压测客户端
+用法: ./loadgen [选项] [host:]port
+  -t, --threads N       线程数(默认2)
+  -c, --connections N   连接数(默认64)
+  -d, --duration SEC    持续时间(默认10)
+  -p, --pipeline N      每个连接的流水线深度(默认1)
+  -R, --rate N          开环模式的总请求速率(req/s)，不指定为闭环模式
+  -u, --url SPEC        请求组合的一项，可重复："[权重*]方法 路径 [表单]"
+                        例如 -u "9*GET /index.html" -u "1*POST /login username=alice&password=pw"
+      --close           每个请求新建连接(Connection: close)
+      --timeout MS      在途请求超时(默认5000)
+      --json FILE       结果另存为JSON，便于比较不同版本
+例如: ./loadgen -t 4 -c 256 -d 30 -R 50000 127.0.0.1:1316
+*/
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include "loadgen.h"
+
+using namespace std;
+
+static void Usage(const char* prog)
+{
+    fprintf(stderr,
+            "usage: %s [-t threads] [-c connections] [-d seconds] [-p pipeline] [-R rate]\n"
+            "          [-u \"[weight*]METHOD /path [form]\"]... [--close] [--timeout ms] [--json file]\n"
+            "          [host:]port\n",
+            prog);
+}
+
+int main(int argc, char* argv[])
+{
+    enum { OPT_CLOSE = 256, OPT_TIMEOUT, OPT_JSON };
+    static const option LONG_OPTS[] = {
+        { "threads", required_argument, nullptr, 't' },
+        { "connections", required_argument, nullptr, 'c' },
+        { "duration", required_argument, nullptr, 'd' },
+        { "pipeline", required_argument, nullptr, 'p' },
+        { "rate", required_argument, nullptr, 'R' },
+        { "url", required_argument, nullptr, 'u' },
+        { "close", no_argument, nullptr, OPT_CLOSE },
+        { "timeout", required_argument, nullptr, OPT_TIMEOUT },
+        { "json", required_argument, nullptr, OPT_JSON },
+        { "help", no_argument, nullptr, 'h' },
+        { nullptr, 0, nullptr, 0 },
+    };
+    LoadConfig config;
+    string jsonPath;
+    int opt;
+    while ((opt = getopt_long(argc, argv, "t:c:d:p:R:u:h", LONG_OPTS, nullptr)) != -1) {
+        switch (opt) {
+        case 't': config.threads = atoi(optarg); break;
+        case 'c': config.connections = atoi(optarg); break;
+        case 'd': config.durationSec = atof(optarg); break;
+        case 'p': config.pipeline = atoi(optarg); break;
+        case 'R': config.rate = atof(optarg); break;
+        case 'u': {
+            LoadRequest req;
+            if (!ParseLoadRequest(optarg, req)) {
+                fprintf(stderr, "bad request spec: %s\n", optarg);
+                return 1;
+            }
+            config.mix.push_back(req);
+            break;
+        }
+        case OPT_CLOSE: config.keepAlive = false; break;
+        case OPT_TIMEOUT: config.timeoutMs = atoi(optarg); break;
+        case OPT_JSON: jsonPath = optarg; break;
+        default:
+            Usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (optind < argc) {
+        string target = argv[optind];
+        size_t colon = target.rfind(':');
+        if (colon != string::npos) {
+            config.host = target.substr(0, colon);
+            target = target.substr(colon + 1);
+        }
+        config.port = atoi(target.c_str());
+    }
+    if (config.threads <= 0 || config.connections <= 0 || config.durationSec <= 0 ||
+        config.pipeline <= 0 || config.port <= 0 || config.port > 65535) {
+        Usage(argv[0]);
+        return 1;
+    }
+    if (!config.keepAlive && config.pipeline > 1) {
+        fprintf(stderr, "pipeline needs keep-alive, using 1\n");
+        config.pipeline = 1;
+    }
+
+    LoadResult result = RunLoad(config);
+    fputs(FormatResult(config, result).c_str(), stdout);
+    if (!jsonPath.empty()) {
+        FILE* fp = fopen(jsonPath.c_str(), "w");
+        if (!fp) {
+            fprintf(stderr, "open %s failed\n", jsonPath.c_str());
+            return 1;
+        }
+        fprintf(fp, "%s\n", ResultJson(config, result).c_str());
+        fclose(fp);
+    }
+    return result.requests > 0 ? 0 : 1;
+}
@@ -0,0 +1,419 @@
+#include "config.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <fmt/format.h>
+
+using namespace std;
+
+namespace {
+
+struct Key {
+    const char* name;
+    const char* help;
+    function<bool(ServerConfig&, const string&)> set;
+    function<string(const ServerConfig&)> get;
+    bool isBool;
+};
+
+bool ToLong(const string& value, long& out)
+{
+    if (value.empty()) {
+        return false;
+    }
+    char* end = nullptr;
+    errno = 0;
+    out = strtol(value.c_str(), &end, 10);
+    return errno == 0 && *end == '\0';
+}
+
+bool ToBool(const string& value, bool& out)
+{
+    if (value == "1" || value == "true" || value == "on" || value == "yes") {
+        out = true;
+    } else if (value == "0" || value == "false" || value == "off" || value == "no") {
+        out = false;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+Key IntKey(const char* name, int ServerConfig::*field, long lo, long hi, const char* help)
+{
+    return { name, help,
+        [field, lo, hi](ServerConfig& c, const string& v) {
+            long n;
+            if (!ToLong(v, n) || n < lo || n > hi) {
+                return false;
+            }
+            c.*field = int(n);
+            return true;
+        },
+        [field](const ServerConfig& c) { return to_string(c.*field); }, false };
+}
+
+Key DoubleKey(const char* name, double ServerConfig::*field, const char* help)
+{
+    return { name, help,
+        [field](ServerConfig& c, const string& v) {
+            char* end = nullptr;
+            double d = strtod(v.c_str(), &end);
+            if (v.empty() || *end != '\0' || d < 0) {
+                return false;
+            }
+            c.*field = d;
+            return true;
+        },
+        [field](const ServerConfig& c) { return fmt::format("{}", c.*field); }, false };
+}
+
+Key BoolKey(const char* name, bool ServerConfig::*field, const char* help)
+{
+    return { name, help,
+        [field](ServerConfig& c, const string& v) { return ToBool(v, c.*field); },
+        [field](const ServerConfig& c) { return string(c.*field ? "true" : "false"); }, true };
+}
+
+Key StringKey(const char* name, string ServerConfig::*field, const char* help,
+              function<bool(const string&)> check = nullptr)
+{
+    return { name, help,
+        [field, check](ServerConfig& c, const string& v) {
+            if (check && !check(v)) {
+                return false;
+            }
+            c.*field = v;
+            return true;
+        },
+        [field](const ServerConfig& c) { return c.*field; }, false };
+}
+
+/* 既接受数字也接受名字，如 log_level = warn */
+Key EnumKey(const char* name, int ServerConfig::*field, vector<const char*> names, const char* help)
+{
+    return { name, help,
+        [field, names](ServerConfig& c, const string& v) {
+            for (size_t i = 0; i < names.size(); i++) {
+                if (v == names[i] || v == to_string(i)) {
+                    c.*field = int(i);
+                    return true;
+                }
+            }
+            return false;
+        },
+        [field, names](const ServerConfig& c) {
+            int i = c.*field;
+            return i >= 0 && size_t(i) < names.size() ? string(names[i]) : to_string(i);
+        }, false };
+}
+
+const vector<Key>& Keys()
+{
+    using C = ServerConfig;
+    const long MAX = 1L << 30;
+    static const vector<Key> keys = {
+        IntKey("port", &C::port, 0, 65535, "listen port, 0 picks an ephemeral port"),
+        IntKey("trig_mode", &C::trigMode, 0, 3, "0 LT/LT, 1 LT/ET, 2 ET/LT, 3 ET/ET (listen/conn)"),
+        IntKey("timeout_ms", &C::timeoutMs, -1, MAX, "idle connection timeout, <=0 disables"),
+        BoolKey("linger", &C::linger, "SO_LINGER 1s on close"),
+        IntKey("backlog", &C::backlog, 1, MAX, "listen backlog"),
+        BoolKey("reuse_port", &C::reusePort, "SO_REUSEPORT on the listen socket"),
+        BoolKey("tcp_nodelay", &C::tcpNoDelay, "TCP_NODELAY on accepted connections"),
+        IntKey("sndbuf", &C::sndBuf, 0, MAX, "SO_SNDBUF bytes, 0 keeps the kernel default"),
+        IntKey("rcvbuf", &C::rcvBuf, 0, MAX, "SO_RCVBUF bytes, 0 keeps the kernel default"),
+        IntKey("max_connections", &C::maxConnections, 1, MAX, "concurrent connection limit"),
+        IntKey("drain_timeout_ms", &C::drainTimeoutMs, 0, MAX, "upgrade/shutdown wait for open connections"),
+        IntKey("drain_idle_ms", &C::drainIdleMs, 0, MAX, "idle timeout while draining"),
+        IntKey("workers", &C::workers, 0, 256, "prefork worker processes sharing the port, 0 = single process"),
+        IntKey("io_threads", &C::ioThreads, 0, 1024, "io pool threads, 0 = CPU count"),
+        IntKey("io_queue", &C::ioQueue, 1, MAX, "io pool queue capacity"),
+        IntKey("cpu_threads", &C::cpuThreads, 0, 1024, "cpu pool threads, 0 = CPU count / 2"),
+        IntKey("cpu_queue", &C::cpuQueue, 1, MAX, "cpu pool queue capacity"),
+        IntKey("db_threads", &C::dbThreads, 0, 1024, "db pool threads, 0 = conn_pool_max"),
+        IntKey("db_queue", &C::dbQueue, 1, MAX, "db pool queue capacity"),
+        StringKey("cpu_affinity", &C::cpuAffinity, "CPUs for io threads, e.g. 0-3,6 (empty = no pinning)",
+            [](const string& v) { vector<int> cpus; return v.empty() || ParseCpuList(v, cpus); }),
+        IntKey("reactor_cpu", &C::reactorCpu, -1, 4095, "CPU for the event loop thread, -1 = no pinning"),
+        IntKey("read_buffer", &C::readBuffer, 64, MAX, "initial per-connection read buffer bytes"),
+        IntKey("write_buffer", &C::writeBuffer, 64, MAX, "initial per-connection write buffer bytes"),
+        IntKey("max_header_bytes", &C::maxHeaderBytes, 256, MAX, "request line + headers limit, 431 beyond"),
+        IntKey("max_body_bytes", &C::maxBodyBytes, 0, MAX, "Content-Length limit, 413 beyond"),
+        StringKey("src_dir", &C::srcDir, "static files, empty = ./resources"),
+        StringKey("user_store", &C::userStore, "mysql, memory or sqlite:<file>"),
+        StringKey("sql_host", &C::sqlHost, "MySQL host"),
+        IntKey("sql_port", &C::sqlPort, 1, 65535, "MySQL port"),
+        StringKey("sql_user", &C::sqlUser, "MySQL user"),
+        StringKey("sql_password", &C::sqlPassword, "MySQL password"),
+        StringKey("sql_db", &C::sqlDb, "MySQL database"),
+        IntKey("conn_pool", &C::connPool, 1, 1024, "MySQL connections kept open (pool minimum)"),
+        IntKey("conn_pool_max", &C::connPoolMax, 0, 1024, "MySQL connection pool limit, 0 = 2 * conn_pool"),
+        IntKey("conn_acquire_timeout_ms", &C::connAcquireTimeoutMs, 0, MAX, "wait for a free MySQL connection"),
+        IntKey("conn_health_interval_ms", &C::connHealthIntervalMs, 100, MAX, "ping idle MySQL connections this often"),
+        IntKey("auth_cache_ttl_ms", &C::authCacheTtlMs, 0, MAX, "auth cache TTL, 0 disables the cache"),
+        IntKey("auth_cache_negative_ttl_ms", &C::authCacheNegativeTtlMs, 0, MAX, "TTL of cached failures"),
+        IntKey("auth_cache_size", &C::authCacheSize, 1, MAX, "auth cache entries"),
+        IntKey("max_conn_per_ip", &C::maxConnPerIp, 0, MAX, "concurrent connections per IP, 0 = unlimited"),
+        DoubleKey("ip_rate", &C::ipRate, "requests per second per IP, 0 = unlimited"),
+        DoubleKey("ip_burst", &C::ipBurst, "token bucket size per IP"),
+        BoolKey("log", &C::log, "enable logging"),
+        EnumKey("log_level", &C::logLevel, { "debug", "info", "warn", "error" }, "debug, info, warn or error"),
+        StringKey("log_levels", &C::logLevels, "per-module levels, e.g. http=debug,pool=warn (core/http/server/pool/timer)",
+            [](const string& v) { vector<pair<string, int>> levels; return ParseLogLevels(v, levels); }),
+        IntKey("log_queue", &C::logQueue, 1, MAX, "log buffer lines per thread"),
+        EnumKey("log_mode", &C::logMode, { "text", "deferred", "binary" }, "text, deferred or binary"),
+        IntKey("log_file_mb", &C::logFileMb, 1, 1 << 20, "rotate the log file after this many MiB"),
+        IntKey("log_total_mb", &C::logTotalMb, 0, 1 << 20, "log directory quota in MiB, oldest files go first, 0 = unlimited"),
+        BoolKey("log_compress", &C::logCompress, "gzip rotated log files"),
+        IntKey("slow_request_ms", &C::slowRequestMs, -1, MAX, "slow log threshold, <=0 disables"),
+    };
+    return keys;
+}
+
+string Normalize(string key)
+{
+    replace(key.begin(), key.end(), '-', '_');
+    return key;
+}
+
+const Key* FindKey(const string& key)
+{
+    string name = Normalize(key);
+    for (const Key& k : Keys()) {
+        if (name == k.name) {
+            return &k;
+        }
+    }
+    return nullptr;
+}
+
+string Trim(const string& s)
+{
+    size_t begin = s.find_first_not_of(" \t\r");
+    if (begin == string::npos) {
+        return "";
+    }
+    size_t end = s.find_last_not_of(" \t\r");
+    return s.substr(begin, end - begin + 1);
+}
+
+} // namespace
+
+bool SetConfigValue(ServerConfig& config, const string& key, const string& value, string& error)
+{
+    const Key* k = FindKey(key);
+    if (!k) {
+        error = fmt::format("unknown option '{}'", key);
+        return false;
+    }
+    if (!k->set(config, value)) {
+        error = fmt::format("invalid value '{}' for {} ({})", value, k->name, k->help);
+        return false;
+    }
+    return true;
+}
+
+bool LoadConfigFile(const string& path, ServerConfig& config, string& error)
+{
+    ifstream in(path);
+    if (!in) {
+        error = fmt::format("cannot open config file {}", path);
+        return false;
+    }
+    string line;
+    int lineNo = 0;
+    while (getline(in, line)) {
+        lineNo++;
+        size_t hash = line.find('#');
+        if (hash != string::npos) {
+            line.resize(hash);
+        }
+        line = Trim(line);
+        if (line.empty()) {
+            continue;
+        }
+        size_t eq = line.find('=');
+        if (eq == string::npos) {
+            error = fmt::format("{}:{}: expected 'key = value'", path, lineNo);
+            return false;
+        }
+        string err;
+        if (!SetConfigValue(config, Trim(line.substr(0, eq)), Trim(line.substr(eq + 1)), err)) {
+            error = fmt::format("{}:{}: {}", path, lineNo, err);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ParseCommandLine(int argc, char* argv[], ServerConfig& config, string& error, bool& help)
+{
+    help = false;
+    /* 第一遍只找配置文件，保证命令行总是覆盖文件 */
+    string file;
+    bool explicitFile = false;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if ((arg == "-c" || arg == "--config") && i + 1 < argc) {
+            file = argv[++i];
+            explicitFile = true;
+        } else if (arg.compare(0, 9, "--config=") == 0) {
+            file = arg.substr(9);
+            explicitFile = true;
+        }
+    }
+    if (!explicitFile && access("./webserver.conf", R_OK) == 0) {
+        file = "./webserver.conf";
+    }
+    if (!file.empty() && !LoadConfigFile(file, config, error)) {
+        return false;
+    }
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            help = true;
+            return false;
+        }
+        if (arg == "-c" || arg == "--config") {
+            i++;
+            continue;
+        }
+        if (arg.compare(0, 9, "--config=") == 0) {
+            continue;
+        }
+        if (arg == "-p" && i + 1 < argc) {
+            if (!SetConfigValue(config, "port", argv[++i], error)) {
+                return false;
+            }
+            continue;
+        }
+        if (arg.compare(0, 2, "--") != 0) {
+            error = fmt::format("unexpected argument '{}'", arg);
+            return false;
+        }
+        string key = arg.substr(2);
+        string value;
+        size_t eq = key.find('=');
+        if (eq != string::npos) {
+            value = key.substr(eq + 1);
+            key.resize(eq);
+        } else {
+            const Key* k = FindKey(key);
+            bool next;
+            if (!k && key.compare(0, 3, "no-") == 0 && (k = FindKey(key.substr(3))) && k->isBool) {
+                key = key.substr(3);
+                value = "false";
+            } else if (!k) {
+                error = fmt::format("unknown option '--{}'", key);
+                return false;
+            } else if (k->isBool && (i + 1 >= argc || !ToBool(argv[i + 1], next))) {
+                /* 布尔项后面不跟取值时视为true */
+                value = "true";
+            } else if (i + 1 < argc) {
+                value = argv[++i];
+            } else {
+                error = fmt::format("missing value for --{}", key);
+                return false;
+            }
+        }
+        if (!SetConfigValue(config, key, value, error)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+string ConfigUsage(const char* prog)
+{
+    ServerConfig defaults;
+    fmt::memory_buffer out;
+    auto it = back_inserter(out);
+    fmt::format_to(it, "usage: {} [-c file] [-p port] [--key=value]...\n", prog);
+    fmt::format_to(it, "  -c, --config FILE   config file (default ./webserver.conf if present)\n");
+    fmt::format_to(it, "  -p PORT             same as --port\n");
+    fmt::format_to(it, "options (also valid as 'key = value' in the config file):\n");
+    for (const Key& k : Keys()) {
+        string name = k.name;
+        replace(name.begin(), name.end(), '_', '-');
+        fmt::format_to(it, "  --{:<28} {} [{}]\n", name, k.help, k.get(defaults));
+    }
+    return fmt::to_string(out);
+}
+
+string DumpConfig(const ServerConfig& config)
+{
+    fmt::memory_buffer out;
+    auto it = back_inserter(out);
+    for (const Key& k : Keys()) {
+        fmt::format_to(it, "{} = {}\n", k.name, k.get(config));
+    }
+    return fmt::to_string(out);
+}
+
+bool ParseCpuList(const string& spec, vector<int>& cpus)
+{
+    cpus.clear();
+    size_t start = 0;
+    while (start <= spec.size()) {
+        size_t end = spec.find(',', start);
+        string item = Trim(spec.substr(start, end == string::npos ? string::npos : end - start));
+        size_t dash = item.find('-');
+        long lo, hi;
+        if (dash == string::npos) {
+            if (!ToLong(item, lo)) {
+                return false;
+            }
+            hi = lo;
+        } else if (!ToLong(item.substr(0, dash), lo) || !ToLong(item.substr(dash + 1), hi)) {
+            return false;
+        }
+        if (lo < 0 || hi < lo || hi >= 4096) {
+            return false;
+        }
+        for (long cpu = lo; cpu <= hi; cpu++) {
+            cpus.push_back(int(cpu));
+        }
+        if (end == string::npos) {
+            break;
+        }
+        start = end + 1;
+    }
+    return !cpus.empty();
+}
+
+bool ParseLogLevels(const string& spec, vector<pair<string, int>>& levels)
+{
+    static const char* NAMES[] = { "debug", "info", "warn", "error", "off" };
+    levels.clear();
+    size_t start = 0;
+    while (start < spec.size()) {
+        size_t end = spec.find(',', start);
+        string item = Trim(spec.substr(start, end == string::npos ? string::npos : end - start));
+        size_t eq = item.find('=');
+        if (eq == string::npos) {
+            return false;
+        }
+        string module = Trim(item.substr(0, eq));
+        string value = Trim(item.substr(eq + 1));
+        int level = -1;
+        for (int i = 0; i < 5; i++) {
+            if (value == NAMES[i] || value == to_string(i)) {
+                level = i;
+            }
+        }
+        if (module.empty() || level < 0) {
+            return false;
+        }
+        levels.emplace_back(module, level);
+        if (end == string::npos) {
+            break;
+        }
+        start = end + 1;
+    }
+    return true;
+}
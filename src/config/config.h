@@ -0,0 +1,112 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+/*
+服务端的全部可调参数，取值优先级：默认值 < 配置文件 < 命令行
+配置文件每行一项，#之后为注释：
+    port = 1316
+    io_threads = 8          # 0为CPU核数
+    cpu_affinity = 0-3,6    # io线程依次绑定到这些CPU
+运行中收到SIGHUP时按同样的顺序重新读取，只有日志级别(含按模块的级别)与切换/配额、连接/限流上限、认证缓存、
+空闲超时等可在线修改的项立即生效，见 WebServer::Reload_
+命令行用同样的键名，-和_等价：--io-threads=8、--io_threads 8；布尔项可写 --linger / --no-linger
+-c/--config 指定配置文件，不指定时读取存在的 ./webserver.conf
+*/
+#include <string>
+#include <utility>
+#include <vector>
+
+struct ServerConfig {
+    /* 监听与连接 */
+    int port = 1316;
+    int trigMode = 3;               // 0 LT+LT, 1 LT+ET, 2 ET+LT, 3 ET+ET(监听+连接)
+    int timeoutMs = 60000;          // 空闲连接超时，<=0不超时
+    bool linger = false;            // 关闭时等待未发送的数据(SO_LINGER 1秒)
+    int backlog = 1024;
+    bool reusePort = false;         // SO_REUSEPORT
+    bool tcpNoDelay = false;        // 已接受连接上的TCP_NODELAY
+    int sndBuf = 0;                 // SO_SNDBUF/SO_RCVBUF，0为系统默认
+    int rcvBuf = 0;
+    int maxConnections = 65536;
+    int drainTimeoutMs = 30000;     // 升级/退出时等待已有连接及线程池任务处理完的上限
+    int drainIdleMs = 1000;         // 排空期间空闲连接的超时，到期即关闭
+
+    /* 进程：workers>0时由master为每个worker绑定一个SO_REUSEPORT监听socket并fork，见 server/master.h */
+    int workers = 0;                // 0为单进程
+
+    /* 线程(prefork模式下为每个worker的数量) */
+    int ioThreads = 6;              // 0为CPU核数
+    int ioQueue = 1000;
+    int cpuThreads = 0;             // 0为CPU核数的一半
+    int cpuQueue = 256;
+    int dbThreads = 0;              // 0为连接池上限
+    int dbQueue = 1024;
+    std::string cpuAffinity;        // io线程绑定的CPU列表，如 "0-3,6"，空为不绑定
+    int reactorCpu = -1;            // Reactor线程绑定的CPU，-1为不绑定
+
+    /* 每个连接读写缓冲区的初始大小，不够时自动扩容 */
+    int readBuffer = 1024;
+    int writeBuffer = 1024;
+    /* 超过时回431/413并关闭连接，未收全的请求最多缓存这么多 */
+    int maxHeaderBytes = 8192;
+    int maxBodyBytes = 1 << 20;
+
+    /* 静态资源目录，空为 当前目录/resources */
+    std::string srcDir;
+
+    /* 用户存储，见 ParseStoreSpec */
+    std::string userStore = "mysql";
+    std::string sqlHost = "localhost";
+    int sqlPort = 3306;
+    std::string sqlUser = "root";
+    std::string sqlPassword = "root";
+    std::string sqlDb = "webserver1";
+    int connPool = 12;              // 连接池最小连接数
+    int connPoolMax = 0;            // 连接池上限，0为connPool的两倍
+    int connAcquireTimeoutMs = 500; // 取连接最多等待多久
+    int connHealthIntervalMs = 5000;// 空闲连接的ping间隔
+    int authCacheTtlMs = 60000;     // 0为不启用认证缓存
+    int authCacheNegativeTtlMs = 5000;
+    int authCacheSize = 65536;
+
+    /* 按IP限流，0为不限制 */
+    int maxConnPerIp = 1024;
+    double ipRate = 2000;
+    double ipBurst = 4000;
+
+    /* 日志 */
+    bool log = true;
+    int logLevel = 1;               // 0 debug, 1 info, 2 warn, 3 error
+    std::string logLevels;          // 按模块覆盖日志级别，如 "http=debug,pool=warn"，见 ParseLogLevels
+    int logQueue = 1024;
+    int logMode = 0;                // LogMode：0 text, 1 deferred, 2 binary
+    int logFileMb = 64;             // 单个日志文件超过后切换
+    int logTotalMb = 1024;          // 日志目录总量上限，超出时删最旧的文件，0不限
+    bool logCompress = true;        // gzip切换下来的文件
+    int slowRequestMs = 500;        // <=0关闭慢日志
+};
+
+/* key的-和_等价；值不合法或key未知时返回false并写入error */
+bool SetConfigValue(ServerConfig& config, const std::string& key, const std::string& value, std::string& error);
+
+/* 解析配置文件，出错时error带上行号 */
+bool LoadConfigFile(const std::string& path, ServerConfig& config, std::string& error);
+
+/* 先读配置文件再应用其余参数；遇到-h/--help时help置为true并返回false */
+bool ParseCommandLine(int argc, char* argv[], ServerConfig& config, std::string& error, bool& help);
+
+/* 所有参数的说明及默认值 */
+std::string ConfigUsage(const char* prog);
+
+/* 以配置文件格式输出当前取值 */
+std::string DumpConfig(const ServerConfig& config);
+
+/* "0-3,6" -> {0,1,2,3,6} */
+bool ParseCpuList(const std::string& spec, std::vector<int>& cpus);
+
+/*
+"http=debug,pool=warn" -> {{"http",0},{"pool",2}}
+级别可写debug/info/warn/error/off或0-4；模块名由 Log::ModuleByName 解析，这里不检查
+*/
+bool ParseLogLevels(const std::string& spec, std::vector<std::pair<std::string, int>>& levels);
+
+#endif // CONFIG_H
@@ -1,15 +1,34 @@
 #include "httpconn.h"
+
+#undef LOG_MODULE
+#define LOG_MODULE LOG_MOD_HTTP
+
 using namespace std;
 
 string HttpConn::srcDir;
 std::atomic<int> HttpConn::userCount;
 bool HttpConn::isET;
+int HttpConn::readBufferSize = 1024;
+int HttpConn::writeBufferSize = 1024;
+std::atomic<bool> HttpConn::draining;
+unordered_map<string, HttpConn::Handler> HttpConn::handlers_;
+unordered_map<string, pair<string, HttpConn::AsyncHandler>> HttpConn::asyncHandlers_;
 
 HttpConn::HttpConn()
+    : readBuff_(readBufferSize)
+    , writeBuff_(writeBufferSize)
 {
     fd_ = -1;
     addr_ = {0};
     isClose_ = true;
+    generation_ = 0;
+    pending_ = false;
+    busy_ = false;
+    keepAlive_ = false;
+    reqStartUs_ = 0;
+    parseUs_ = parsedUs_ = readyUs_ = 0;
+    readBytes_ = 0;
+    respBytes_ = 0;
 }
 
 HttpConn::~HttpConn() { 
@@ -18,6 +37,13 @@ HttpConn::~HttpConn() {
 
 void HttpConn::init(int sockFd, const sockaddr_in& addr){
     assert(sockFd > 0);
+    lock_guard<mutex> locker(mtx_);
+    generation_++;
+    trace_.Reset();
+    trace_.Mark(RequestTrace::ACCEPT);
+    pending_ = false;
+    busy_ = false;
+    work_ = nullptr;
     userCount++;
     addr_ = addr;
     fd_ = sockFd;
@@ -26,14 +52,38 @@ void HttpConn::init(int sockFd, const sockaddr_in& addr){
     isClose_ = false;
 }
 
+void HttpConn::RegisterHandler(const string& path, Handler handler) {
+    handlers_[path] = std::move(handler);
+}
+
+void HttpConn::RegisterHandler(const string& path, const string& pool, AsyncHandler handler) {
+    asyncHandlers_[path] = make_pair(pool, std::move(handler));
+}
+
+HttpConn::Work HttpConn::TakeWork(string& pool) {
+    pool = workPool_;
+    return std::move(work_);
+}
+
+int64_t HttpConn::NowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 ssize_t HttpConn::read(int* saveErrno){
     // 从sockFd读到ReadBuff
     ssize_t len = -1;
+    if(readBuff_.ReadableBytes() == 0) {
+        reqStartUs_ = NowUs();
+    }
+    readBytes_ = 0;
     do {
         len = readBuff_.ReadFd(fd_, saveErrno);
         if (len <= 0) {
             break;
         }
+        readBytes_ += len;
+        busy_ = true;
     } while (isET);
     return len;
 }
@@ -72,18 +122,78 @@ ssize_t HttpConn::write(int* saveErrno) {
 bool HttpConn::process() {
     request_.Init();
     if(readBuff_.ReadableBytes() <= 0) {
+        busy_ = false;
+        return false;
+    }
+    busy_ = true;
+    int64_t parseStart = NowUs();
+    bool parsed = request_.parse(readBuff_);
+    if(!parsed && request_.Incomplete()) {
+        /* 请求还没收全，继续等EPOLLIN */
         return false;
     }
-    else if(request_.parse(readBuff_)) {
-        response_.Init(srcDir, request_.path(), request_.IsKeepAlive(), 200);
+    parsedUs_ = NowUs();
+    parseUs_ = parsedUs_ - parseStart;
+    trace_.Mark(RequestTrace::PARSED);
+    if(parsed) {
+        USDT_PROBE3(request_parsed, fd_, request_.method().c_str(), request_.path().c_str());
+        auto async = asyncHandlers_.find(request_.path());
+        if(async != asyncHandlers_.end()) {
+            Work work = async->second.second(request_);
+            if(work) {
+                /* 交给其他线程池，完成后由Resume生成响应 */
+                pending_ = true;
+                work_ = std::move(work);
+                workPool_ = async->second.first;
+                return true;
+            }
+        }
+        keepAlive_ = request_.IsKeepAlive() && !draining;
+        response_.Init(srcDir, request_.path(), keepAlive_, 200);
+        auto it = handlers_.find(request_.path());
+        if(it != handlers_.end()) {
+            string body, contentType = "text/plain";
+            it->second(request_, body, contentType);
+            response_.SetContent(std::move(body), std::move(contentType));
+        }
     } else {
-        response_.Init(srcDir, request_.path(), false, 400);
+        keepAlive_ = false;
+        response_.Init(srcDir, request_.path(), false, request_.ErrorCode());
+        if(request_.ErrorCode() != 400) {
+            /* 413/431没有错误页，回空响应体后关闭；缓冲区里剩下的数据随连接一起丢弃 */
+            response_.SetContent("", "text/plain");
+        }
     }
+    MakeResponse_();
+    return true;
+}
 
+bool HttpConn::Resume(uint64_t generation, const Finish& finish, const std::function<void()>& onReady) {
+    lock_guard<mutex> locker(mtx_);
+    if(isClose_ || generation != generation_ || !pending_) {
+        return false;
+    }
+    pending_ = false;
+    string body, contentType = "text/plain";
+    bool hasBody = finish && finish(request_, body, contentType);
+    keepAlive_ = request_.IsKeepAlive() && !draining;
+    response_.Init(srcDir, request_.path(), keepAlive_, 200);
+    if(hasBody) {
+        response_.SetContent(std::move(body), std::move(contentType));
+    }
+    MakeResponse_();
+    onReady();
+    return true;
+}
+
+void HttpConn::MakeResponse_() {
     response_.MakeResponse(writeBuff_);
+    readyUs_ = NowUs();
+    trace_.Mark(RequestTrace::HANDLED);
     /* 响应头 */
     iov_[0].iov_base = const_cast<char*>(writeBuff_.Peek());
     iov_[0].iov_len = writeBuff_.ReadableBytes();
+    iov_[1].iov_len = 0;
     iovCnt_ = 1;
 
     /* 文件 */
@@ -92,18 +202,22 @@ bool HttpConn::process() {
         iov_[1].iov_len = response_.FileLen();
         iovCnt_ = 2;
     }
-    return true;
+    respBytes_ = ToWriteBytes();
+    USDT_PROBE3(response_ready, fd_, response_.Code(), respBytes_);
 }
 
-void HttpConn::Close() {
+bool HttpConn::Close() {
+    lock_guard<mutex> locker(mtx_);
     response_.UnmapFile();
-    if(isClose_ == false){
-        isClose_ = true; 
+    if(isClose_.exchange(true) == false){
         userCount--;
+        USDT_PROBE1(conn_close, fd_);
         close(fd_);
         LOG_INFO("Client[{}]({}:{}) quit, UserCount:{}",
                  fd_, GetIP(), GetPort(), (int)userCount);
+        return true;
     }
+    return false;
 }
 
 int HttpConn::GetFd() const {
@@ -6,9 +6,13 @@
 #include <arpa/inet.h>   // sockaddr_in
 #include <stdlib.h>      // atoi()
 #include <errno.h>      
+#include <functional>
+#include <mutex>
+#include <unordered_map>
 
 #include "../log/log.h"
-#include "../pool/sqlconnRAII.h"
+#include "../metrics/reqtrace.h"
+#include "../metrics/probes.h"
 #include "httprequest.h"
 #include "httpresponse.h"
 
@@ -20,29 +24,87 @@ public:
     void init(int sockFd, const sockaddr_in& addr);
     ssize_t read(int* saveErrno);
     ssize_t write(int* saveErrno);
-    void Close();
+    bool Close(); // 只有真正关闭了连接的那次调用返回true
     int GetFd() const;
+    bool IsClosed() const { return isClose_; }
     int GetPort() const;
     const char* GetIP() const;
     sockaddr_in GetAddr() const;
     bool process();
+    /* 读缓冲区里已有一个完整的请求，下一次process会为它生成响应 */
+    bool HasRequest() const { return HttpRequest::IsComplete(readBuff_); }
+
+    /*
+    挂起与恢复：耗时的处理交给其他线程池，io线程立即返回
+    Work   在指定线程池中运行，连接可能随时被关闭或复用，所以只能使用自己捕获的数据
+    Finish 是Work的结果，Resume时在连接锁内执行：可改写请求(例如登录后的跳转页面)，
+           返回true表示已生成响应体，返回false则按request.path()发送文件
+    */
+    using Finish = std::function<bool(HttpRequest& request, std::string& body, std::string& contentType)>;
+    using Work = std::function<Finish()>;
+    /* 在io线程上执行，根据请求决定是否挂起；返回空的Work表示按普通请求处理 */
+    using AsyncHandler = std::function<Work(const HttpRequest& request)>;
+
+    /* process返回true后若仍处于挂起状态，响应尚未生成，不能注册EPOLLOUT */
+    bool IsPending() const { return pending_; }
+    /* 从读到请求数据起，到响应发完、回到等待下一个请求为止；排空时只关闭不忙的连接 */
+    bool IsBusy() const { return busy_; }
+    /* 取出待执行的Work及其目标线程池名 */
+    Work TakeWork(std::string& pool);
+    /* 每次init加一，用来识别fd被关闭后又被新连接复用的情况 */
+    uint64_t Generation() const { return generation_; }
+    /* Work完成后调用：连接仍是挂起时的那一个，才生成响应并在锁内执行onReady
+       返回false表示连接已关闭或已被复用，结果直接丢弃 */
+    bool Resume(uint64_t generation, const Finish& finish, const std::function<void()>& onReady);
     int ToWriteBytes() { 
         return iov_[0].iov_len + iov_[1].iov_len; 
     }
+    /* 与已生成响应里的Connection头一致 */
     bool IsKeepAlive() const {
-        return request_.IsKeepAlive();
+        return keepAlive_;
     }
+    /* 访问日志用：当前请求的方法、路径、状态码、响应字节数和开始时间 */
+    const HttpRequest& GetRequest() const { return request_; }
+    int StatusCode() const { return response_.Code(); }
+    size_t ResponseBytes() const { return respBytes_; }
+    int64_t RequestStartUs() const { return reqStartUs_; }
+    /* 指标用：解析耗时、从解析完到响应就绪的耗时(含挂起等待)、响应就绪的时刻，单位微秒 */
+    int64_t ParseUs() const { return parseUs_; }
+    int64_t HandleUs() const { return readyUs_ - parsedUs_; }
+    int64_t ReadyUs() const { return readyUs_; }
+    /* 最近一次read()读到的字节数 */
+    size_t ReadBytes() const { return readBytes_; }
+    /* 当前请求的阶段时间戳；PARSED和HANDLED在这里打点，其余由WebServer打点 */
+    RequestTrace& Trace() { return trace_; }
+    static int64_t NowUs();
+
+    /* 动态路由：请求路径命中时由回调生成响应体和Content-type，启动阶段注册，之后只读 */
+    using Handler = std::function<void(const HttpRequest& request, std::string& body, std::string& contentType)>;
+    static void RegisterHandler(const std::string& path, Handler handler);
+    /* 异步路由：Work在名为pool的线程池中执行，pool为空表示在当前io线程直接执行 */
+    static void RegisterHandler(const std::string& path, const std::string& pool, AsyncHandler handler);
 
     static bool isET;
     static string srcDir;
+    static int readBufferSize;  // 新建连接对象时读写缓冲区的初始大小
+    static int writeBufferSize;
+    static std::atomic<bool> draining; // 排空中：之后的响应都带Connection: close，发完即关闭
     static std::atomic<int> userCount;
     
 private:
+    void MakeResponse_();
    
     int fd_;
     struct  sockaddr_in addr_;
 
-    bool isClose_;
+    std::atomic<bool> isClose_;
+    std::atomic<uint64_t> generation_;
+    std::mutex mtx_; // 保护init/Close与Resume之间的竞争
+    bool pending_;
+    std::atomic<bool> busy_;
+    bool keepAlive_;
+    Work work_;
+    std::string workPool_;
     
     int iovCnt_;
     struct iovec iov_[2];
@@ -52,6 +114,17 @@ private:
 
     HttpRequest request_;
     HttpResponse response_;
+
+    int64_t reqStartUs_; // 请求第一个字节到达时的steady_clock时间
+    int64_t parseUs_;
+    int64_t parsedUs_;
+    int64_t readyUs_;
+    size_t readBytes_;
+    size_t respBytes_;
+    RequestTrace trace_;
+
+    static std::unordered_map<std::string, Handler> handlers_;
+    static std::unordered_map<std::string, std::pair<std::string, AsyncHandler>> asyncHandlers_;
 };
 
 
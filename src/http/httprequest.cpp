@@ -4,6 +4,11 @@
  * @copyleft Apache 2.0
  */ 
 #include "httprequest.h"
+#include <strings.h>
+
+#undef LOG_MODULE
+#define LOG_MODULE LOG_MOD_HTTP
+
 using namespace std;
 
 const unordered_set<string> HttpRequest::DEFAULT_HTML{
@@ -13,11 +18,18 @@ const unordered_set<string> HttpRequest::DEFAULT_HTML{
 const unordered_map<string, int> HttpRequest::DEFAULT_HTML_TAG {
             {"/register.html", 0}, {"/login.html", 1},  };
 
+size_t HttpRequest::maxHeaderBytes = 8192;
+size_t HttpRequest::maxBodyBytes = 1 << 20;
+
 void HttpRequest::Init() {
     method_ = path_ = version_ = body_ = "";
     state_ = REQUEST_LINE;
     header_.clear();
     post_.clear();
+    contentLength_ = 0;
+    incomplete_ = false;
+    errorCode_ = 400;
+    authPending_ = authIsLogin_ = false;
 }
 
 bool HttpRequest::IsKeepAlive() const {
@@ -32,7 +44,29 @@ bool HttpRequest::parse(Buffer& buff) {
     if(buff.ReadableBytes() <= 0) {
         return false;
     }
+    switch(Scan_(buff)) {
+    case SCAN_INCOMPLETE:
+        incomplete_ = true;
+        return false;
+    case SCAN_HEADER_TOO_LARGE:
+        LOG_WARN("Request headers exceed {} bytes", maxHeaderBytes);
+        errorCode_ = 431;
+        return false;
+    case SCAN_BODY_TOO_LARGE:
+        LOG_WARN("Request body exceeds {} bytes", maxBodyBytes);
+        errorCode_ = 413;
+        return false;
+    default:
+        break;
+    }
     while(buff.ReadableBytes() && state_ != FINISH) {
+        if(state_ == BODY) {
+            /* 请求体按Content-Length截取而不是按行：后面可能紧跟着流水线上的下一个请求 */
+            size_t len = ContentLength_();
+            ParseBody_(std::string(buff.Peek(), len));
+            buff.Retrieve(len);
+            break;
+        }
         const char* lineEnd = search(buff.Peek(), buff.BeginWriteConst(), CRLF, CRLF + 2);
         std::string line(buff.Peek(), lineEnd);
         switch(state_)
@@ -49,9 +83,6 @@ bool HttpRequest::parse(Buffer& buff) {
                 state_ = FINISH;
             }
             break;
-        case BODY:
-            ParseBody_(line);
-            break;
         default:
             break;
         }
@@ -110,13 +141,54 @@ void HttpRequest::ParseHeader_(const string& line) {
         size_t value_start = line.find_first_not_of(' ', colon_pos + 1);
         if (value_start != string::npos) {
             string value = line.substr(value_start);
+            if(strcasecmp(key.c_str(), "Content-Length") == 0) {
+                contentLength_ = strtoul(value.c_str(), nullptr, 10);
+            }
             header_[key] = value;
         }
     } else {
-        state_ = BODY;
+        /* 空行：头部结束，没有请求体的请求到此为止 */
+        state_ = ContentLength_() > 0 ? BODY : FINISH;
     }
 }
 
+size_t HttpRequest::ContentLength_() const {
+    return contentLength_;
+}
+
+/* 头部以空行结束，且其后至少有Content-Length字节。
+   TCP可能把一个请求拆成多次读到，不完整时parse不能消费任何数据 */
+bool HttpRequest::IsComplete(const Buffer& buff) {
+    return Scan_(buff) != SCAN_INCOMPLETE;
+}
+
+HttpRequest::SCAN_RESULT HttpRequest::Scan_(const Buffer& buff) {
+    const char END[] = "\r\n\r\n";
+    const char* begin = buff.Peek();
+    const char* end = buff.BeginWriteConst();
+    const char* headerEnd = search(begin, end, END, END + 4);
+    if(headerEnd == end) {
+        /* 还没看到空行，但已经超过上限：不必等下去 */
+        return buff.ReadableBytes() > maxHeaderBytes ? SCAN_HEADER_TOO_LARGE : SCAN_INCOMPLETE;
+    }
+    if(static_cast<size_t>(headerEnd + 4 - begin) > maxHeaderBytes) {
+        return SCAN_HEADER_TOO_LARGE;
+    }
+    size_t length = 0;
+    const char* line = begin;
+    while(line < headerEnd) {
+        const char* lineEnd = search(line, headerEnd + 2, END, END + 2);
+        if(lineEnd - line > 15 && strncasecmp(line, "Content-Length:", 15) == 0) {
+            length = strtoul(line + 15, nullptr, 10);
+        }
+        line = lineEnd + 2;
+    }
+    if(length > maxBodyBytes) {
+        return SCAN_BODY_TOO_LARGE;
+    }
+    return static_cast<size_t>(end - (headerEnd + 4)) >= length ? SCAN_COMPLETE : SCAN_INCOMPLETE;
+}
+
 void HttpRequest::ParseBody_(const string& line) {
     body_ = line;
     ParsePost_();
@@ -137,13 +209,8 @@ void HttpRequest::ParsePost_() {
             int tag = DEFAULT_HTML_TAG.find(path_)->second;
             LOG_DEBUG("Tag:{}", tag);
             if(tag == 0 || tag == 1) {
-                bool isLogin = (tag == 1);
-                if(UserVerify(post_["username"], post_["password"], isLogin)) {
-                    path_ = "/welcome.html";
-                } 
-                else {
-                    path_ = "/error.html";
-                }
+                authPending_ = true;
+                authIsLogin_ = (tag == 1);
             }
         }
     }   
@@ -190,65 +257,9 @@ void HttpRequest::ParseFormUrlencoded_() {
     }
 }
 
-bool HttpRequest::UserVerify(const string &name, const string &pwd, bool isLogin) {
-    if(name == "" || pwd == "") { return false; }
-    LOG_INFO("Verify name:{} pwd:{}", name.c_str(), pwd.c_str());
-    MYSQL* sql;
-    SqlConnRAII(&sql,  SqlConnPool::Instance());
-    assert(sql);
-    
-    bool flag = false;
-    unsigned int j = 0;
-    char order[256] = { 0 };
-    MYSQL_FIELD *fields = nullptr;
-    MYSQL_RES *res = nullptr;
-    
-    if(!isLogin) { flag = true; }
-    /* 查询用户及密码 */
-    snprintf(order, 256, "SELECT username, password FROM user WHERE username='%s' LIMIT 1", name.c_str());
-    LOG_DEBUG("{}", order);
-
-    if(mysql_query(sql, order)) { 
-        mysql_free_result(res);
-        return false; 
-    }
-    res = mysql_store_result(sql);
-    j = mysql_num_fields(res);
-    fields = mysql_fetch_fields(res);
-
-    while(MYSQL_ROW row = mysql_fetch_row(res)) {
-        LOG_DEBUG("MYSQL ROW: {} {}", row[0], row[1]);
-        string password(row[1]);
-        /* 注册行为 且 用户名未被使用*/
-        if(isLogin) {
-            if(pwd == password) { flag = true; }
-            else {
-                flag = false;
-                LOG_DEBUG("pwd error!");
-            }
-        } 
-        else { 
-            flag = false; 
-            LOG_DEBUG("user used!");
-        }
-    }
-    mysql_free_result(res);
-
-    /* 注册行为 且 用户名未被使用*/
-    if(!isLogin && flag == true) {
-        LOG_DEBUG("regirster!");
-        bzero(order, 256);
-        snprintf(order, 256,"INSERT INTO user(username, password) VALUES('%s','%s')", name.c_str(), pwd.c_str());
-        LOG_DEBUG("{}", order);
-        if(mysql_query(sql, order)) { 
-            LOG_DEBUG("Insert error!");
-            flag = false; 
-        }
-        flag = true;
-    }
-    SqlConnPool::Instance()->FreeConn(sql);
-    LOG_DEBUG("UserVerify success!!");
-    return flag;
+void HttpRequest::FinishAuth(bool ok) {
+    authPending_ = false;
+    path_ = ok ? "/welcome.html" : "/error.html";
 }
 
 std::string HttpRequest::path() const{
@@ -11,12 +11,9 @@
 #include <string>
 #include <regex>
 #include <errno.h>     
-#include <mysql/mysql.h>  //mysql
 
 #include "../buffer/buffer.h"
 #include "../log/log.h"
-#include "../pool/sqlconnpool.h"
-#include "../pool/sqlconnRAII.h"
 
 class HttpRequest {
 public:
@@ -53,6 +50,24 @@ public:
 
     bool IsKeepAlive() const;
 
+    /* parse返回false时，若头部或请求体还没收全则为true：缓冲区未被消费，读到更多数据后重新parse */
+    bool Incomplete() const { return incomplete_; }
+    /* parse返回false且不是Incomplete时应答的状态码：400，头部过大431，请求体过大413 */
+    int ErrorCode() const { return errorCode_; }
+    /*
+    缓冲区开头是否已有一个完整的请求(头部和Content-Length字节的请求体)，不消费数据
+    头部超过maxHeaderBytes或Content-Length超过maxBodyBytes时也返回true，交给parse拒绝，不再继续缓存
+    */
+    static bool IsComplete(const Buffer& buff);
+
+    static size_t maxHeaderBytes;   // 请求行加全部头部，含结尾的空行
+    static size_t maxBodyBytes;
+
+    /* 登录/注册表单需要查UserStore：parse只做记录，查询完成后用FinishAuth改写目标页面 */
+    bool AuthPending() const { return authPending_; }
+    bool AuthIsLogin() const { return authIsLogin_; }
+    void FinishAuth(bool ok);
+
     /* 
     todo 
     void HttpConn::ParseFormData() {}
@@ -63,17 +78,24 @@ private:
     bool ParseRequestLine_(const std::string& line);
     void ParseHeader_(const std::string& line);
     void ParseBody_(const std::string& line);
+    size_t ContentLength_() const;
+
+    enum SCAN_RESULT { SCAN_INCOMPLETE, SCAN_COMPLETE, SCAN_HEADER_TOO_LARGE, SCAN_BODY_TOO_LARGE };
+    static SCAN_RESULT Scan_(const Buffer& buff);
 
     void ParsePath_();
     void ParsePost_();
     void ParseFormUrlencoded_();
 
-    static bool UserVerify(const std::string& name, const std::string& pwd, bool isLogin);
-
     PARSE_STATE state_;
     std::string method_, path_, version_, body_;
     std::unordered_map<std::string, std::string> header_;
     std::unordered_map<std::string, std::string> post_;
+    size_t contentLength_;
+    bool incomplete_;
+    int errorCode_;
+    bool authPending_;
+    bool authIsLogin_;
 
     static const std::unordered_set<std::string> DEFAULT_HTML;
     static const std::unordered_map<std::string, int> DEFAULT_HTML_TAG;
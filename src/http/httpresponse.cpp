@@ -5,6 +5,9 @@
  */ 
 #include "httpresponse.h"
 
+#undef LOG_MODULE
+#define LOG_MODULE LOG_MOD_HTTP
+
 using namespace std;
 
 const unordered_map<string, string> HttpResponse::SUFFIX_TYPE = {
@@ -34,6 +37,8 @@ const unordered_map<int, string> HttpResponse::CODE_STATUS = {
     { 400, "Bad Request" },
     { 403, "Forbidden" },
     { 404, "Not Found" },
+    { 413, "Payload Too Large" },
+    { 431, "Request Header Fields Too Large" },
 };
 
 const unordered_map<int, string> HttpResponse::CODE_PATH = {
@@ -48,6 +53,7 @@ HttpResponse::HttpResponse() {
     isKeepAlive_ = false;
     mmFile_ = nullptr; 
     mmFileStat_ = { 0 };
+    hasContent_ = false;
 };
 
 HttpResponse::~HttpResponse() {
@@ -63,9 +69,25 @@ void HttpResponse::Init(const string& srcDir, string& path, bool isKeepAlive, in
     srcDir_ = srcDir;
     mmFile_ = nullptr; 
     mmFileStat_ = { 0 };
+    hasContent_ = false;
+    content_.clear();
+}
+
+void HttpResponse::SetContent(string body, string contentType) {
+    hasContent_ = true;
+    content_ = std::move(body);
+    contentType_ = std::move(contentType);
 }
 
 void HttpResponse::MakeResponse(Buffer& buff) {
+    if(hasContent_) {
+        if(code_ == -1) { code_ = 200; }
+        AddStateLine_(buff);
+        AddHeader_(buff);
+        buff.Append("Content-length: " + to_string(content_.size()) + "\r\n\r\n");
+        buff.Append(content_);
+        return;
+    }
     /* 判断请求的资源文件 */
     if(stat((srcDir_ + path_).data(), &mmFileStat_) < 0 || S_ISDIR(mmFileStat_.st_mode)) {
         code_ = 404;
@@ -117,7 +139,11 @@ void HttpResponse::AddHeader_(Buffer& buff) {
     } else{
         buff.Append("close\r\n");
     }
-    buff.Append("Content-type: " + GetFileType_() + "\r\n");
+    buff.Append("Content-type: " + (hasContent_ ? contentType_ : GetFileType_()) + "\r\n");
+    fmt::string_view date = WallClock::HttpDate();
+    buff.Append("Date: ", 6);
+    buff.Append(date.data(), date.size());
+    buff.Append("\r\n", 2);
 }
 
 void HttpResponse::AddContent_(Buffer& buff) {
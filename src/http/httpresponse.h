@@ -14,6 +14,7 @@
 
 #include "../buffer/buffer.h"
 #include "../log/log.h"
+#include "../timer/wallclock.h"
 
 class HttpResponse {
 public:
@@ -27,6 +28,8 @@ public:
     size_t FileLen() const;
     void ErrorContent(Buffer& buff, std::string message);
     int Code() const { return code_; }
+    /* 由动态处理函数生成的响应体，设置后不再读取srcDir下的文件 */
+    void SetContent(std::string body, std::string contentType);
 
 private:
     void AddStateLine_(Buffer &buff);
@@ -45,6 +48,10 @@ private:
     char* mmFile_; 
     struct stat mmFileStat_;
 
+    bool hasContent_;
+    std::string content_;
+    std::string contentType_;
+
     static const std::unordered_map<std::string, std::string> SUFFIX_TYPE;
     static const std::unordered_map<int, std::string> CODE_STATUS;
     static const std::unordered_map<int, std::string> CODE_PATH;
@@ -0,0 +1,185 @@
+#include "analytics.h"
+#include <arpa/inet.h>
+#include <math.h>
+#include "../timer/wallclock.h"
+#include "../metrics/metrics.h"
+using namespace std;
+
+uint64_t HyperLogLog::Estimate() const
+{
+    const double m = static_cast<double>(REGISTERS);
+    const double alpha = 0.7213 / (1.0 + 1.079 / m);
+    double sum = 0;
+    size_t zeros = 0;
+    for (size_t i = 0; i < REGISTERS; i++) {
+        sum += ldexp(1.0, -registers_[i]);
+        if (registers_[i] == 0) {
+            zeros++;
+        }
+    }
+    double est = alpha * m * m / sum;
+    /* 基数较小时原始估计偏差大，改用线性计数 */
+    if (est <= 2.5 * m && zeros != 0) {
+        est = m * log(m / static_cast<double>(zeros));
+    }
+    return static_cast<uint64_t>(est + 0.5);
+}
+
+Analytics::Analytics(int windowSec, size_t topK)
+    : windowSec_(max(windowSec, 1))
+    , topK_(topK)
+{
+    int64_t start = WallClock::NowNs() / 1000000000;
+    for (size_t i = 0; i < SHARDS; i++) {
+        shards_.emplace_back(make_unique<Shard>(start, topK));
+    }
+}
+
+/* splitmix64的终结函数，把IP打散成均匀的64位哈希 */
+uint64_t Analytics::Mix_(uint64_t x)
+{
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+/* 调用方持有shard.mtx。空闲超过一个窗口时，上一窗口的统计也应为空 */
+void Analytics::Roll_(Shard& shard, int64_t nowSec)
+{
+    if (nowSec - shard.windowStart < windowSec_) {
+        return;
+    }
+    if (nowSec - shard.windowStart < 2 * windowSec_) {
+        shard.lastClients = shard.curClients;
+        swap(shard.lastTopIps, shard.topIps);
+        swap(shard.lastTopPaths, shard.topPaths);
+        shard.lastConns = shard.conns;
+        shard.lastRequests = shard.requests;
+    } else {
+        shard.lastClients.Clear();
+        shard.lastTopIps.Clear();
+        shard.lastTopPaths.Clear();
+        shard.lastConns = shard.lastRequests = 0;
+    }
+    shard.curClients.Clear();
+    shard.topIps.Clear();
+    shard.topPaths.Clear();
+    shard.conns = shard.requests = 0;
+    shard.windowStart = nowSec - (nowSec - shard.windowStart) % windowSec_;
+}
+
+void Analytics::RecordClient(uint32_t ip)
+{
+    uint64_t hash = Mix_(ip);
+    int64_t nowSec = WallClock::NowNs() / 1000000000;
+    Shard& shard = *shards_[MetricShard() % SHARDS];
+    lock_guard<mutex> locker(shard.mtx);
+    Roll_(shard, nowSec);
+    shard.curClients.Add(hash);
+    shard.totalClients.Add(hash);
+    shard.conns++;
+}
+
+void Analytics::RecordRequest(uint32_t ip, const string& path)
+{
+    string key = path.size() > MAX_PATH_LEN ? path.substr(0, MAX_PATH_LEN) : path;
+    uint64_t ipHash = Mix_(ip);
+    uint64_t pathHash = Mix_(hash<string>()(key));
+    int64_t nowSec = WallClock::NowNs() / 1000000000;
+    Shard& shard = *shards_[MetricShard() % SHARDS];
+    lock_guard<mutex> locker(shard.mtx);
+    Roll_(shard, nowSec);
+    shard.topIps.Add(ip, ipHash);
+    shard.topPaths.Add(key, pathHash);
+    shard.requests++;
+}
+
+void Analytics::AppendEscaped_(fmt::memory_buffer& out, const string& str)
+{
+    out.push_back('"');
+    for (unsigned char c : str) {
+        if (c == '"' || c == '\\') {
+            out.push_back('\\');
+            out.push_back(static_cast<char>(c));
+        } else if (c < 0x20) {
+            fmt::format_to(fmt::appender(out), "\\u{:04x}", c);
+        } else {
+            out.push_back(static_cast<char>(c));
+        }
+    }
+    out.push_back('"');
+}
+
+void Analytics::AppendTop_(fmt::memory_buffer& out, const vector<HeavyHitters<uint32_t>::Item>& top)
+{
+    out.push_back('[');
+    for (size_t i = 0; i < top.size(); i++) {
+        char ip[INET_ADDRSTRLEN];
+        in_addr addr;
+        addr.s_addr = top[i].key;
+        inet_ntop(AF_INET, &addr, ip, sizeof(ip));
+        fmt::format_to(fmt::appender(out), "{}{{\"ip\":\"{}\",\"count\":{}}}", i ? "," : "", ip, top[i].count);
+    }
+    out.push_back(']');
+}
+
+void Analytics::AppendTop_(fmt::memory_buffer& out, const vector<HeavyHitters<string>::Item>& top)
+{
+    out.push_back('[');
+    for (size_t i = 0; i < top.size(); i++) {
+        fmt::format_to(fmt::appender(out), "{}{{\"path\":", i ? "," : "");
+        AppendEscaped_(out, top[i].key);
+        fmt::format_to(fmt::appender(out), ",\"count\":{}}}", top[i].count);
+    }
+    out.push_back(']');
+}
+
+string Analytics::Json()
+{
+    int64_t nowSec = WallClock::NowNs() / 1000000000;
+    /* 逐个分片加锁合并，不同分片的快照之间可能相差几个请求 */
+    int64_t windowStart = 0;
+    HyperLogLog curClients, lastClients, totalClients;
+    auto topIps = make_unique<HeavyHitters<uint32_t>>(topK_);
+    auto lastTopIps = make_unique<HeavyHitters<uint32_t>>(topK_);
+    auto topPaths = make_unique<HeavyHitters<string>>(topK_);
+    auto lastTopPaths = make_unique<HeavyHitters<string>>(topK_);
+    uint64_t conns = 0, requests = 0, lastConns = 0, lastRequests = 0;
+    for (auto& shard : shards_) {
+        lock_guard<mutex> locker(shard->mtx);
+        Roll_(*shard, nowSec);
+        windowStart = shard->windowStart;
+        curClients.Merge(shard->curClients);
+        lastClients.Merge(shard->lastClients);
+        totalClients.Merge(shard->totalClients);
+        topIps->Merge(shard->topIps);
+        lastTopIps->Merge(shard->lastTopIps);
+        topPaths->Merge(shard->topPaths);
+        lastTopPaths->Merge(shard->lastTopPaths);
+        conns += shard->conns;
+        requests += shard->requests;
+        lastConns += shard->lastConns;
+        lastRequests += shard->lastRequests;
+    }
+
+    fmt::memory_buffer out;
+    fmt::format_to(fmt::appender(out),
+                   "{{\"window_sec\":{},\"window_start\":{},"
+                   "\"unique_clients\":{{\"current\":{},\"previous\":{},\"total\":{}}},"
+                   "\"connections\":{{\"current\":{},\"previous\":{}}},"
+                   "\"requests\":{{\"current\":{},\"previous\":{}}},",
+                   windowSec_, windowStart,
+                   curClients.Estimate(), lastClients.Estimate(), totalClients.Estimate(),
+                   conns, lastConns, requests, lastRequests);
+    fmt::format_to(fmt::appender(out), "\"top_ips\":{{\"current\":");
+    AppendTop_(out, topIps->Top());
+    fmt::format_to(fmt::appender(out), ",\"previous\":");
+    AppendTop_(out, lastTopIps->Top());
+    fmt::format_to(fmt::appender(out), "}},\"top_paths\":{{\"current\":");
+    AppendTop_(out, topPaths->Top());
+    fmt::format_to(fmt::appender(out), ",\"previous\":");
+    AppendTop_(out, lastTopPaths->Top());
+    fmt::format_to(fmt::appender(out), "}}}}\n");
+    return fmt::to_string(out);
+}
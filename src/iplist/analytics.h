@@ -0,0 +1,231 @@
+#ifndef ANALYTICS_H
+#define ANALYTICS_H
+/*
+访问流量的在线统计，内存占用固定，与客户端数量和请求量无关
+1. HyperLogLog：按时间窗口估计独立客户端IP数(当前窗口/上一窗口/启动以来)
+2. Count-Min Sketch + 小顶表：估计每个IP、每个路径的请求次数，只保留计数最大的K个(heavy hitters)
+   新条目只有在CMS估计值超过表中最小计数时才替换它，低频的长尾不会把表冲掉
+3. 窗口滚动时清空当前窗口的统计，上一窗口的结果保留一份用于输出
+4. 统计按线程分成SHARDS份(分片号同Counter/Histogram)，每份一把锁，记录时各线程互不竞争；
+   输出时把各分片合并：HyperLogLog逐寄存器取最大，Count-Min Sketch逐格相加后重新估计各分片热点的计数
+所有计数都是近似值：CMS只会高估，误差上界约为 窗口内请求数 * e / CountMinSketch::WIDTH
+*/
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <fmt/format.h>
+
+class HyperLogLog {
+public:
+    static const int PRECISION = 12; // 4096个寄存器，标准误差约 1.04/sqrt(4096) = 1.6%
+
+    HyperLogLog() { Clear(); }
+
+    void Add(uint64_t hash) {
+        size_t idx = hash >> (64 - PRECISION);
+        uint64_t rest = (hash << PRECISION) | (1ull << (PRECISION - 1)); // 哨兵位保证rest不为0
+        uint8_t rank = static_cast<uint8_t>(__builtin_clzll(rest) + 1);
+        if (rank > registers_[idx]) {
+            registers_[idx] = rank;
+        }
+    }
+
+    void Merge(const HyperLogLog& other) {
+        for (size_t i = 0; i < REGISTERS; i++) {
+            registers_[i] = std::max(registers_[i], other.registers_[i]);
+        }
+    }
+
+    uint64_t Estimate() const;
+
+    void Clear() { memset(registers_, 0, sizeof(registers_)); }
+
+private:
+    static const size_t REGISTERS = 1 << PRECISION;
+    uint8_t registers_[REGISTERS];
+};
+
+class CountMinSketch {
+public:
+    static const size_t DEPTH = 4;
+    static const size_t WIDTH = 2048;
+
+    CountMinSketch() { Clear(); }
+
+    /* 计数加一，返回加入后的估计值 */
+    uint32_t Add(uint64_t hash) {
+        uint32_t est = UINT32_MAX;
+        for (size_t i = 0; i < DEPTH; i++) {
+            uint32_t& c = counters_[i][Index_(hash, i)];
+            if (c != UINT32_MAX) {
+                c++;
+            }
+            est = std::min(est, c);
+        }
+        return est;
+    }
+
+    uint32_t Estimate(uint64_t hash) const {
+        uint32_t est = UINT32_MAX;
+        for (size_t i = 0; i < DEPTH; i++) {
+            est = std::min(est, counters_[i][Index_(hash, i)]);
+        }
+        return est;
+    }
+
+    /* 逐格相加，饱和在UINT32_MAX */
+    void Merge(const CountMinSketch& other) {
+        for (size_t i = 0; i < DEPTH; i++) {
+            for (size_t j = 0; j < WIDTH; j++) {
+                uint32_t& c = counters_[i][j];
+                c = c > UINT32_MAX - other.counters_[i][j] ? UINT32_MAX : c + other.counters_[i][j];
+            }
+        }
+    }
+
+    void Clear() { memset(counters_, 0, sizeof(counters_)); }
+
+private:
+    /* 由一个64位哈希派生出DEPTH个独立下标(Kirsch-Mitzenmacher) */
+    static size_t Index_(uint64_t hash, size_t row) {
+        uint32_t h1 = static_cast<uint32_t>(hash);
+        uint32_t h2 = static_cast<uint32_t>(hash >> 32) | 1;
+        return (h1 + row * h2) % WIDTH;
+    }
+
+    uint32_t counters_[DEPTH][WIDTH];
+};
+
+/* Count-Min Sketch 估计频率，固定K个槽位记录当前最热的key */
+template<class Key>
+class HeavyHitters {
+public:
+    struct Item {
+        Key key;
+        uint32_t count;
+        uint64_t hash;
+    };
+
+    explicit HeavyHitters(size_t k) : k_(k) { items_.reserve(k); }
+
+    void Add(const Key& key, uint64_t hash) {
+        uint32_t est = sketch_.Add(hash);
+        auto it = index_.find(key);
+        if (it != index_.end()) {
+            items_[it->second].count = est;
+            return;
+        }
+        if (items_.size() < k_) {
+            index_.emplace(key, items_.size());
+            items_.push_back({key, est, hash});
+            return;
+        }
+        size_t minIdx = 0;
+        for (size_t i = 1; i < items_.size(); i++) {
+            if (items_[i].count < items_[minIdx].count) {
+                minIdx = i;
+            }
+        }
+        if (est > items_[minIdx].count) {
+            index_.erase(items_[minIdx].key);
+            index_.emplace(key, minIdx);
+            items_[minIdx] = {key, est, hash};
+        }
+    }
+
+    /* 合并另一个分片：sketch相加后，两边表中的key按合并后的sketch重新估计，保留最大的K个 */
+    void Merge(const HeavyHitters& other) {
+        sketch_.Merge(other.sketch_);
+        for (const Item& item : other.items_) {
+            if (index_.count(item.key) == 0) {
+                index_.emplace(item.key, items_.size());
+                items_.push_back(item);
+            }
+        }
+        for (Item& item : items_) {
+            item.count = sketch_.Estimate(item.hash);
+        }
+        if (items_.size() > k_) {
+            items_ = Top();
+            items_.resize(k_);
+            index_.clear();
+            for (size_t i = 0; i < items_.size(); i++) {
+                index_.emplace(items_[i].key, i);
+            }
+        }
+    }
+
+    /* 按计数从大到小排序 */
+    std::vector<Item> Top() const {
+        std::vector<Item> top(items_);
+        std::sort(top.begin(), top.end(), [](const Item& a, const Item& b) { return a.count > b.count; });
+        return top;
+    }
+
+    void Clear() {
+        sketch_.Clear();
+        items_.clear();
+        index_.clear();
+    }
+
+private:
+    size_t k_;
+    CountMinSketch sketch_;
+    std::vector<Item> items_;
+    std::unordered_map<Key, size_t> index_;
+};
+
+class Analytics {
+public:
+    Analytics(int windowSec = 60, size_t topK = 20);
+
+    static constexpr size_t SHARDS = 8;
+
+    /* 新连接，Reactor线程在accept后调用；ip为网络字节序 */
+    void RecordClient(uint32_t ip);
+    /* 一次请求完成，工作线程调用 */
+    void RecordRequest(uint32_t ip, const std::string& path);
+
+    /* /stats 的JSON输出 */
+    std::string Json();
+
+    static const size_t MAX_PATH_LEN = 96; // 超长的路径截断后再计数
+
+private:
+    struct alignas(64) Shard {
+        explicit Shard(int64_t start, size_t topK)
+            : windowStart(start), topIps(topK), lastTopIps(topK), topPaths(topK), lastTopPaths(topK) {}
+
+        std::mutex mtx;
+        int64_t windowStart; // 各分片从同一时刻开始按windowSec_对齐滚动，窗口边界相同
+        HyperLogLog curClients;
+        HyperLogLog lastClients;
+        HyperLogLog totalClients;
+        HeavyHitters<uint32_t> topIps;
+        HeavyHitters<uint32_t> lastTopIps;
+        HeavyHitters<std::string> topPaths;
+        HeavyHitters<std::string> lastTopPaths;
+        uint64_t conns = 0;
+        uint64_t requests = 0;
+        uint64_t lastConns = 0;
+        uint64_t lastRequests = 0;
+    };
+
+    void Roll_(Shard& shard, int64_t nowSec);
+    static uint64_t Mix_(uint64_t x);
+    static void AppendTop_(fmt::memory_buffer& out, const std::vector<HeavyHitters<uint32_t>::Item>& top);
+    static void AppendTop_(fmt::memory_buffer& out, const std::vector<HeavyHitters<std::string>::Item>& top);
+    static void AppendEscaped_(fmt::memory_buffer& out, const std::string& str);
+
+    const int windowSec_;
+    const size_t topK_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+#endif // ANALYTICS_H
@@ -0,0 +1,275 @@
+#include "ipacl.h"
+#include <arpa/inet.h>
+#include <ctype.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <fstream>
+#include <sstream>
+#include "../log/log.h"
+
+#undef LOG_MODULE
+#define LOG_MODULE LOG_MOD_SERVER
+
+using namespace std;
+
+enum { ACL_NONE = -1, ACL_DENY = 0, ACL_ALLOW = 1 };
+
+struct IpAcl::Node {
+    Key key;
+    int len;
+    int action;
+    unique_ptr<Node> child[2];
+
+    Node(const Key& k, int l, int a) : key(Mask_(k, l)), len(l), action(a) {}
+};
+
+IpAcl::IpAcl(const string& path)
+    : path_(path), defaultAllow_(true), ruleCount_(0), lastCheck_(0), mtime_(0)
+{
+    struct stat st;
+    if (stat(path_.c_str(), &st) == 0) {
+        mtime_ = st.st_mtime;
+        Load();
+    }
+}
+
+IpAcl::~IpAcl() = default;
+
+void IpAcl::Clear()
+{
+    root_.reset();
+    defaultAllow_ = true;
+    ruleCount_ = 0;
+}
+
+bool IpAcl::Load()
+{
+    ifstream in(path_);
+    if (!in) {
+        LOG_WARN("ACL file {} open failed, keep {} rules", path_, ruleCount_);
+        return false;
+    }
+    /* 先在临时对象里解析，全部成功后再替换，避免半份规则生效 */
+    IpAcl fresh("");
+    string line;
+    int lineNo = 0;
+    while (getline(in, line)) {
+        lineNo++;
+        if (!fresh.AddRule(line)) {
+            LOG_ERROR("ACL {}:{} invalid rule \"{}\", keep old rules", path_, lineNo, line);
+            return false;
+        }
+    }
+    root_ = move(fresh.root_);
+    defaultAllow_ = fresh.defaultAllow_;
+    ruleCount_ = fresh.ruleCount_;
+    LOG_INFO("ACL loaded {} rules from {}, default {}", ruleCount_, path_, defaultAllow_ ? "allow" : "deny");
+    return true;
+}
+
+void IpAcl::MaybeReload()
+{
+    time_t now = time(nullptr);
+    if (now == lastCheck_ || path_.empty()) {
+        return;
+    }
+    lastCheck_ = now;
+    struct stat st;
+    if (stat(path_.c_str(), &st) != 0) {
+        if (mtime_ != 0) {
+            /* 文件被删除：清空规则，恢复默认放行 */
+            Clear();
+            mtime_ = 0;
+            LOG_INFO("ACL file {} removed, rules cleared", path_);
+        }
+        return;
+    }
+    if (st.st_mtime != mtime_) {
+        mtime_ = st.st_mtime;
+        Load();
+    }
+}
+
+bool IpAcl::AddRule(const string& rawLine)
+{
+    string line = rawLine.substr(0, rawLine.find('#'));
+    istringstream ss(line);
+    string action, target, extra;
+    if (!(ss >> action)) {
+        return true; // 空行
+    }
+    if (!(ss >> target) || (ss >> extra)) {
+        return false;
+    }
+    if (action == "default") {
+        if (target != "allow" && target != "deny") {
+            return false;
+        }
+        defaultAllow_ = (target == "allow");
+        return true;
+    }
+    if (action != "allow" && action != "deny") {
+        return false;
+    }
+    string addr = target;
+    int len = -1;
+    size_t slash = target.find('/');
+    bool hasPrefix = (slash != string::npos);
+    if (hasPrefix) {
+        addr = target.substr(0, slash);
+        /* 前缀长度只能是数字，strtol会接受前导空白和正负号 */
+        const char* digits = target.c_str() + slash + 1;
+        if (!isdigit(static_cast<unsigned char>(*digits))) {
+            return false;
+        }
+        char* end = nullptr;
+        long value = strtol(digits, &end, 10);
+        if (*end != '\0' || value > 128) {
+            return false;
+        }
+        len = static_cast<int>(value);
+    }
+    Key key;
+    in_addr v4;
+    in6_addr v6;
+    if (inet_pton(AF_INET, addr.c_str(), &v4) == 1) {
+        if (!hasPrefix) {
+            len = 32;
+        }
+        if (len > 32) {
+            return false;
+        }
+        key = FromV4_(v4.s_addr);
+        len += 96;
+    } else if (inet_pton(AF_INET6, addr.c_str(), &v6) == 1) {
+        if (!hasPrefix) {
+            len = 128;
+        }
+        if (len > 128) {
+            return false;
+        }
+        key = FromV6_(v6);
+    } else {
+        return false;
+    }
+    Insert_(key, len, action == "allow");
+    ruleCount_++;
+    return true;
+}
+
+IpAcl::Key IpAcl::FromV4_(uint32_t ipv4)
+{
+    return Key { 0, (0xFFFFull << 32) | ntohl(ipv4) };
+}
+
+IpAcl::Key IpAcl::FromV6_(const in6_addr& ipv6)
+{
+    Key k { 0, 0 };
+    for (int i = 0; i < 8; i++) {
+        k.hi = (k.hi << 8) | ipv6.s6_addr[i];
+        k.lo = (k.lo << 8) | ipv6.s6_addr[i + 8];
+    }
+    return k;
+}
+
+int IpAcl::Bit_(const Key& k, int i)
+{
+    return i < 64 ? (k.hi >> (63 - i)) & 1 : (k.lo >> (127 - i)) & 1;
+}
+
+int IpAcl::CommonPrefix_(const Key& a, const Key& b, int maxLen)
+{
+    int n;
+    uint64_t x = a.hi ^ b.hi;
+    if (x) {
+        n = __builtin_clzll(x);
+    } else {
+        x = a.lo ^ b.lo;
+        n = x ? 64 + __builtin_clzll(x) : 128;
+    }
+    return n < maxLen ? n : maxLen;
+}
+
+IpAcl::Key IpAcl::Mask_(const Key& k, int len)
+{
+    Key m = k;
+    if (len <= 0) {
+        m.hi = m.lo = 0;
+    } else if (len < 64) {
+        m.hi &= ~0ull << (64 - len);
+        m.lo = 0;
+    } else if (len == 64) {
+        m.lo = 0;
+    } else if (len < 128) {
+        m.lo &= ~0ull << (128 - len);
+    }
+    return m;
+}
+
+void IpAcl::Insert_(Key key, int len, bool allow)
+{
+    int action = allow ? ACL_ALLOW : ACL_DENY;
+    key = Mask_(key, len);
+    unique_ptr<Node>* cur = &root_;
+    while (true) {
+        Node* n = cur->get();
+        if (!n) {
+            cur->reset(new Node(key, len, action));
+            return;
+        }
+        int common = CommonPrefix_(n->key, key, n->len < len ? n->len : len);
+        if (common < n->len) {
+            /* 在公共前缀处分裂出一个中间节点 */
+            unique_ptr<Node> split(new Node(key, common, ACL_NONE));
+            int oldBit = Bit_(n->key, common);
+            split->child[oldBit] = move(*cur);
+            if (common == len) {
+                split->action = action;
+            } else {
+                split->child[Bit_(key, common)].reset(new Node(key, len, action));
+            }
+            *cur = move(split);
+            return;
+        }
+        if (n->len == len) {
+            n->action = action; // 同一前缀后出现的规则覆盖前面的
+            return;
+        }
+        cur = &n->child[Bit_(key, n->len)];
+    }
+}
+
+bool IpAcl::Lookup_(const Key& key) const
+{
+    int best = defaultAllow_ ? ACL_ALLOW : ACL_DENY;
+    const Node* n = root_.get();
+    while (n) {
+        if (CommonPrefix_(n->key, key, n->len) < n->len) {
+            break;
+        }
+        if (n->action != ACL_NONE) {
+            best = n->action;
+        }
+        if (n->len == 128) {
+            break;
+        }
+        n = n->child[Bit_(key, n->len)].get();
+    }
+    return best == ACL_ALLOW;
+}
+
+bool IpAcl::Allowed(uint32_t ipv4) const
+{
+    if (!root_) {
+        return defaultAllow_;
+    }
+    return Lookup_(FromV4_(ipv4));
+}
+
+bool IpAcl::Allowed(const in6_addr& ipv6) const
+{
+    if (!root_) {
+        return defaultAllow_;
+    }
+    return Lookup_(FromV6_(ipv6));
+}
@@ -0,0 +1,66 @@
+#ifndef IPACL_H
+#define IPACL_H
+/*
+CIDR访问控制列表，在accept之后、初始化HttpConn之前检查
+规则文件每行一条，#之后为注释：
+    allow 10.0.0.0/8
+    deny  10.1.0.0/16
+    deny  2001:db8::/32
+    default deny        (不写时默认放行)
+1. 最长前缀匹配决定结果，与规则顺序无关
+2. IPv4地址映射为::ffff:a.b.c.d，与IPv6共用一棵128位的树
+3. 存储为路径压缩的二叉基数树(Patricia trie)，查找只沿一条路径向下
+4. 文件修改时间变化后自动重新加载(最多每秒检查一次)；加载失败时保留旧规则
+只在Reactor线程使用，不加锁
+*/
+#include <stdint.h>
+#include <time.h>
+#include <netinet/in.h>
+#include <memory>
+#include <string>
+
+class IpAcl {
+public:
+    explicit IpAcl(const std::string& path);
+    ~IpAcl();
+
+    // 重新读取规则文件，返回是否成功
+    bool Load();
+    // 距上次检查超过1秒且文件有变化时重新加载
+    void MaybeReload();
+
+    // ip 为网络字节序
+    bool Allowed(uint32_t ipv4) const;
+    bool Allowed(const in6_addr& ipv6) const;
+
+    size_t RuleCount() const { return ruleCount_; }
+
+    // 解析一行规则并插入，供Load和测试使用
+    bool AddRule(const std::string& line);
+    void Clear();
+
+private:
+    struct Key {
+        uint64_t hi;
+        uint64_t lo;
+    };
+    struct Node;
+
+    static Key FromV4_(uint32_t ipv4);
+    static Key FromV6_(const in6_addr& ipv6);
+    static int Bit_(const Key& k, int i);
+    static int CommonPrefix_(const Key& a, const Key& b, int maxLen);
+    static Key Mask_(const Key& k, int len);
+
+    void Insert_(Key key, int len, bool allow);
+    bool Lookup_(const Key& key) const;
+
+    std::string path_;
+    std::unique_ptr<Node> root_;
+    bool defaultAllow_;
+    size_t ruleCount_;
+    time_t lastCheck_;
+    time_t mtime_;
+};
+
+#endif // IPACL_H
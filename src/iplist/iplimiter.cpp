@@ -0,0 +1,124 @@
+#include "iplimiter.h"
+#include <algorithm>
+#include <chrono>
+using namespace std;
+
+IpLimiter::IpLimiter(size_t capacity, int maxConnPerIp, double ratePerSec, double burst)
+    : shards_(new Shard[SHARD_NUM])
+    , slotsPerShard_(max(capacity / SHARD_NUM, PROBE_WINDOW))
+    , maxConnPerIp_(maxConnPerIp)
+    , ratePerSec_(ratePerSec)
+    , burst_(burst)
+    , rejectedConns_(0)
+    , rejectedRequests_(0)
+{
+    for (size_t i = 0; i < SHARD_NUM; i++) {
+        shards_[i].slots.resize(slotsPerShard_);
+    }
+}
+
+void IpLimiter::SetLimits(int maxConnPerIp, double ratePerSec, double burst)
+{
+    maxConnPerIp_ = maxConnPerIp;
+    ratePerSec_ = ratePerSec;
+    burst_ = burst;
+}
+
+int64_t IpLimiter::NowUs_()
+{
+    return chrono::duration_cast<chrono::microseconds>(
+        chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+IpLimiter::Shard& IpLimiter::ShardOf_(uint32_t ip, size_t& home)
+{
+    uint64_t h = static_cast<uint64_t>(ip) * 0x9E3779B97F4A7C15ull;
+    home = static_cast<size_t>((h >> 32) % slotsPerShard_);
+    return shards_[(h >> 58) % SHARD_NUM];
+}
+
+/* 调用方持有shard.mtx。条目只会被原地替换、不会被删除，所以遇到空位即可停止查找 */
+IpLimiter::Entry* IpLimiter::Find_(Shard& shard, size_t home, uint32_t ip, bool create, int64_t nowUs)
+{
+    Entry* victim = nullptr;
+    for (size_t i = 0; i < PROBE_WINDOW; i++) {
+        Entry& e = shard.slots[(home + i) % slotsPerShard_];
+        if (!e.used) {
+            victim = &e;
+            break;
+        }
+        if (e.ip == ip) {
+            e.lastSeenUs = nowUs;
+            return &e;
+        }
+        if (e.conns == 0 && (!victim || e.lastSeenUs < victim->lastSeenUs)) {
+            victim = &e;
+        }
+    }
+    if (!create || !victim) {
+        return nullptr;
+    }
+    victim->ip = ip;
+    victim->used = true;
+    victim->conns = 0;
+    victim->tokens = burst_;
+    victim->lastRefillUs = nowUs;
+    victim->lastSeenUs = nowUs;
+    return victim;
+}
+
+bool IpLimiter::Acquire(uint32_t ip)
+{
+    int limit = maxConnPerIp_;
+    size_t home;
+    Shard& shard = ShardOf_(ip, home);
+    lock_guard<mutex> locker(shard.mtx);
+    Entry* e = Find_(shard, home, ip, true, NowUs_());
+    if (!e) {
+        /* 窗口内全是活跃IP，无法记录时放行 */
+        return true;
+    }
+    if (limit > 0 && e->conns >= static_cast<uint32_t>(limit)) {
+        rejectedConns_++;
+        return false;
+    }
+    e->conns++;
+    return true;
+}
+
+void IpLimiter::Release(uint32_t ip)
+{
+    size_t home;
+    Shard& shard = ShardOf_(ip, home);
+    lock_guard<mutex> locker(shard.mtx);
+    Entry* e = Find_(shard, home, ip, false, NowUs_());
+    if (e && e->conns > 0) {
+        e->conns--;
+    }
+}
+
+bool IpLimiter::AllowRequest(uint32_t ip)
+{
+    double rate = ratePerSec_;
+    if (rate <= 0) {
+        return true;
+    }
+    double burst = burst_;
+    int64_t now = NowUs_();
+    size_t home;
+    Shard& shard = ShardOf_(ip, home);
+    lock_guard<mutex> locker(shard.mtx);
+    Entry* e = Find_(shard, home, ip, true, now);
+    if (!e) {
+        return true;
+    }
+    e->tokens = min(burst, e->tokens + (now - e->lastRefillUs) * rate / 1e6);
+    e->lastRefillUs = now;
+    if (e->tokens < 1.0) {
+        rejectedRequests_++;
+        return false;
+    }
+    e->tokens -= 1.0;
+    return true;
+}
@@ -0,0 +1,66 @@
+#ifndef IPLIMITER_H
+#define IPLIMITER_H
+/*
+按IP的准入控制
+1. 每个IP的并发连接数上限：accept时Acquire，连接关闭时Release
+2. 每个IP的令牌桶请求速率：每次处理请求前消耗一个令牌
+3. 状态存放在固定大小、分片加锁的开放寻址表中，内存占用与客户端数量无关
+   探测窗口内没有空位时，淘汰窗口中最久未访问且没有活跃连接的条目(LRU老化)
+上限为0表示不限制
+*/
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class IpLimiter {
+public:
+    IpLimiter(size_t capacity = 65536, int maxConnPerIp = 1024,
+              double ratePerSec = 2000, double burst = 4000);
+
+    // ip 为网络字节序的IPv4地址
+    bool Acquire(uint32_t ip);
+    void Release(uint32_t ip);
+    bool AllowRequest(uint32_t ip);
+
+    // 运行时调整上限，已有条目下次访问时生效
+    void SetLimits(int maxConnPerIp, double ratePerSec, double burst);
+
+    size_t RejectedConns() const { return rejectedConns_; }
+    size_t RejectedRequests() const { return rejectedRequests_; }
+
+private:
+    struct Entry {
+        uint32_t ip = 0;
+        uint32_t conns = 0;
+        bool used = false;
+        double tokens = 0;
+        int64_t lastRefillUs = 0;
+        int64_t lastSeenUs = 0;
+    };
+
+    struct alignas(64) Shard {
+        std::mutex mtx;
+        std::vector<Entry> slots;
+    };
+
+    static const size_t SHARD_NUM = 64;
+    static const size_t PROBE_WINDOW = 16;
+
+    Shard& ShardOf_(uint32_t ip, size_t& home);
+    Entry* Find_(Shard& shard, size_t home, uint32_t ip, bool create, int64_t nowUs);
+    static int64_t NowUs_();
+
+    std::unique_ptr<Shard[]> shards_;
+    size_t slotsPerShard_;
+
+    std::atomic<int> maxConnPerIp_;
+    std::atomic<double> ratePerSec_;
+    std::atomic<double> burst_;
+
+    std::atomic<size_t> rejectedConns_;
+    std::atomic<size_t> rejectedRequests_;
+};
+
+#endif // IPLIMITER_H
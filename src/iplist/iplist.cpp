@@ -0,0 +1,153 @@
+#include "iplist.h"
+#include <string.h>
+#include <sys/stat.h> // mkdir
+
+constexpr chrono::milliseconds iplist::FLUSH_INTERVAL;
+
+iplist::iplist(const string &path, size_t capacity)
+    : path_(path), file_(nullptr), queue_(capacity), pending_(0), dropped_(0),
+      notified_(false), isClose_(false)
+{
+    file_ = fopen(path_.c_str(), "a");
+    if (!file_)
+    {
+        size_t slash = path_.find_last_of('/');
+        if (slash != string::npos)
+        {
+            mkdir(path_.substr(0, slash).c_str(), 0777);
+            file_ = fopen(path_.c_str(), "a");
+        }
+    }
+    if (file_)
+    {
+        writeThread_ = make_unique<thread>([this] { AsyncWrite_(); });
+    }
+}
+
+iplist::~iplist()
+{
+    if (writeThread_)
+    {
+        {
+            lock_guard<mutex> locker(mtx_);
+            isClose_ = true;
+        }
+        cond_.notify_one();
+        writeThread_->join();
+    }
+    if (file_)
+    {
+        fclose(file_);
+    }
+}
+
+void iplist::insert(struct sockaddr_in addr)
+{
+    AccessRecord rec;
+    rec.timeNs = WallClock::NowNs();
+    rec.ip = addr.sin_addr.s_addr;
+    rec.port = addr.sin_port;
+    rec.status = 0;
+    rec.latencyUs = 0;
+    rec.bytes = 0;
+    rec.method[0] = '\0';
+    rec.path[0] = '\0';
+    Push_(rec);
+}
+
+void iplist::access(const sockaddr_in &addr, const string &method, const string &path,
+                    int status, size_t bytes, int64_t latencyUs)
+{
+    AccessRecord rec;
+    rec.timeNs = WallClock::NowNs();
+    rec.ip = addr.sin_addr.s_addr;
+    rec.port = addr.sin_port;
+    rec.status = static_cast<uint16_t>(status);
+    rec.latencyUs = static_cast<uint32_t>(latencyUs > 0 ? latencyUs : 0);
+    rec.bytes = bytes;
+    size_t n = min(method.size(), sizeof(rec.method) - 1);
+    memcpy(rec.method, method.data(), n);
+    rec.method[n] = '\0';
+    n = min(path.size(), sizeof(rec.path) - 1);
+    memcpy(rec.path, path.data(), n);
+    rec.path[n] = '\0';
+    Push_(rec);
+}
+
+void iplist::Push_(const AccessRecord &rec)
+{
+    size_t pending = ++pending_;
+    if (!file_ || !queue_.TryPush(rec))
+    {
+        pending_--;
+        dropped_++;
+        return;
+    }
+    /* 积压超过一半时提前唤醒写线程，否则等它按周期醒来 */
+    if (pending >= queue_.capacity() / 2 && !notified_.exchange(true))
+    {
+        cond_.notify_one();
+    }
+}
+
+void iplist::Format_(fmt::memory_buffer &out, const AccessRecord &rec)
+{
+    out.append(WallClock::LogPrefix(rec.timeNs));
+    fmt::format_to(fmt::appender(out), "{}.{}.{}.{}:{}",
+                   rec.ip & 0xFF, (rec.ip >> 8) & 0xFF, (rec.ip >> 16) & 0xFF, (rec.ip >> 24) & 0xFF,
+                   ntohs(rec.port));
+    if (rec.status != 0)
+    {
+        fmt::format_to(fmt::appender(out), " {} {} {} {} {}us",
+                       rec.method, rec.path, rec.status, rec.bytes, rec.latencyUs);
+    }
+    out.push_back('\n');
+}
+
+void iplist::AsyncWrite_()
+{
+    fmt::memory_buffer batch;
+    auto lastFlush = chrono::steady_clock::now();
+    bool unflushed = false;
+    while (true)
+    {
+        {
+            unique_lock<mutex> locker(mtx_);
+            cond_.wait_for(locker, FLUSH_INTERVAL / 4, [this] { return notified_ || isClose_; });
+        }
+        notified_ = false;
+        bool closing = isClose_;
+
+        AccessRecord rec;
+        size_t count = 0;
+        while (queue_.TryPop(rec))
+        {
+            Format_(batch, rec);
+            count++;
+            if (batch.size() >= BATCH_BYTES)
+            {
+                fwrite(batch.data(), 1, batch.size(), file_);
+                batch.clear();
+            }
+        }
+        pending_ -= count;
+        if (batch.size() > 0)
+        {
+            fwrite(batch.data(), 1, batch.size(), file_);
+            batch.clear();
+        }
+        unflushed = unflushed || count > 0;
+
+        auto now = chrono::steady_clock::now();
+        if (unflushed && (now - lastFlush >= FLUSH_INTERVAL || closing))
+        {
+            fflush(file_);
+            unflushed = false;
+            lastFlush = now;
+        }
+        if (closing)
+        {
+            return;
+        }
+    }
+}
@@ -1,53 +1,72 @@
 #ifndef IPLISTH
 #define IPLISTH
+/*
+异步批量的访问日志
+1. 连接建立(insert)和请求完成(access)只把定长记录压入无锁队列，调用线程不做格式化和文件IO
+2. 后台线程批量取出记录，格式化后一次fwrite写入，按时间间隔fflush
+3. 队列满时丢弃记录并计数，绝不阻塞Reactor线程
+*/
 #include <string>       // 用于 std::string
-#include <cstdio>       // 用于 FILE*, fopen, fclose, fseek, fputs, fflush, snprintf
+#include <cstdio>       // 用于 FILE*, fopen, fclose, fwrite, fflush
 #include <cstdint>      // 用于 uint32_t, uint16_t
 #include <netinet/in.h> // 用于 struct sockaddr_in
 #include <arpa/inet.h>  // 用于 ntohl, ntohs
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <fmt/format.h>
+#include "../log/lockfreeQueue.h"
+#include "../timer/wallclock.h"
 using namespace std;
 
+struct AccessRecord
+{
+    int64_t timeNs;
+    uint32_t ip;        // 网络字节序
+    uint16_t port;      // 网络字节序
+    uint16_t status;    // 0 表示只是建立连接
+    uint32_t latencyUs;
+    uint64_t bytes;
+    char method[8];
+    char path[96];      // 超长的路径被截断
+};
+
 class iplist
 {
 private:
+    static const size_t BATCH_BYTES = 1 << 16;
+    static constexpr chrono::milliseconds FLUSH_INTERVAL{1000};
+
     string path_;
     FILE *file_;
 
+    LockFreeQueue<AccessRecord> queue_;
+    atomic<size_t> pending_;
+    atomic<size_t> dropped_;
+    atomic<bool> notified_;
+    atomic<bool> isClose_;
+    mutex mtx_;
+    condition_variable cond_;
+    unique_ptr<thread> writeThread_;
+
+    void Push_(const AccessRecord &rec);
+    void AsyncWrite_();
+    static void Format_(fmt::memory_buffer &out, const AccessRecord &rec);
+
 public:
-    iplist(const string &path) : path_(path), file_(nullptr)
-    {
-        file_ = fopen(path_.c_str(), "a+");
-        if (file_)
-        {
-            fseek(file_, 0, SEEK_SET);
-        }
-    };
-    ~iplist()
-    {
-        if (file_)
-        {
-            fclose(file_);
-        }
-    };
-
-    void insert(struct sockaddr_in addr)
-    {
-        if (file_)
-        {
-            auto now = chrono::system_clock::now();
-            time_t now_time_t = chrono::system_clock::to_time_t(now);
-            tm t = *localtime(&now_time_t);
-            string buf = (fmt::format("{:04}-{:02}-{:02} {:02}:{:02}:{:02} {}.{}.{}.{}:{}\n",
-                                      t.tm_year + 1900, t.tm_mon + 1, t.tm_mday,
-                                      t.tm_hour, t.tm_min, t.tm_sec,
-                                      addr.sin_addr.s_addr & 0xFF, (addr.sin_addr.s_addr >> 8) & 0xFF, (addr.sin_addr.s_addr >> 16) & 0xFF, (addr.sin_addr.s_addr >> 24) & 0xFF,
-                                      ntohs(addr.sin_port)));
-            fputs(buf.c_str(), file_);
-            fflush(file_);
-        }
-    };
+    iplist(const string &path, size_t capacity = 8192);
+    ~iplist();
+
+    /* 连接建立，Reactor线程调用 */
+    void insert(struct sockaddr_in addr);
+    /* 一次请求的响应发送完毕，工作线程调用 */
+    void access(const sockaddr_in &addr, const string &method, const string &path,
+                int status, size_t bytes, int64_t latencyUs);
+    /* 因队列满被丢弃的记录数 */
+    size_t Dropped() const { return dropped_; }
 };
 
-#endif
\ No newline at end of file
+#endif
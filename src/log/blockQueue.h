@@ -47,6 +47,8 @@ public:
     void push_front(T &&item); // Move version of push_front
     template<typename... Args>
     void emplace_back(Args&&... args); // Emplace back to construct in-place
+    // 不等待：队列已满或已关闭时返回false
+    bool try_push_back(T &&item);
     
     // Replace std::optional methods with alternative move-based methods
     bool pop_move(T &item); // Pop that moves the value into item
@@ -165,6 +167,17 @@ void BlockDeque<T>::emplace_back(Args&&... args) {
     condConsumer_.notify_one();
 }
 
+template<class T>
+bool BlockDeque<T>::try_push_back(T &&item) {
+    std::unique_lock<std::mutex> locker(mtx_);
+    if(isClose_ || deq_.size() >= capacity_) {
+        return false;
+    }
+    deq_.push_back(std::move(item));
+    condConsumer_.notify_one();
+    return true;
+}
+
 template<class T>
 bool BlockDeque<T>::empty() {
     std::lock_guard<std::mutex> locker(mtx_);
@@ -0,0 +1,97 @@
+#ifndef LOCKFREEQUEUE_H
+#define LOCKFREEQUEUE_H
+
+#include <atomic>
+#include <memory>
+#include <assert.h>
+/*
+无锁的有界队列(Dmitry Vyukov的MPMC环形队列)
+支持多生产者多消费者，满/空时立即返回false，不会阻塞调用线程
+每个槽位带一个序号：seq == pos 表示可写，seq == pos + 1 表示可读
+*/
+template<class T>
+class LockFreeQueue {
+public:
+    explicit LockFreeQueue(size_t capacity = 1024);
+
+    bool TryPush(const T &item);
+
+    bool TryPop(T &item);
+
+    size_t capacity() const { return mask_ + 1; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> seq;
+        T data;
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_;
+    alignas(64) std::atomic<size_t> enqueuePos_;
+    alignas(64) std::atomic<size_t> dequeuePos_;
+};
+
+
+template<class T>
+LockFreeQueue<T>::LockFreeQueue(size_t capacity) {
+    size_t cap = 2;
+    while (cap < capacity) {
+        cap <<= 1;
+    }
+    cells_.reset(new Cell[cap]);
+    mask_ = cap - 1;
+    for (size_t i = 0; i < cap; i++) {
+        cells_[i].seq.store(i, std::memory_order_relaxed);
+    }
+    enqueuePos_.store(0, std::memory_order_relaxed);
+    dequeuePos_.store(0, std::memory_order_relaxed);
+}
+
+template<class T>
+bool LockFreeQueue<T>::TryPush(const T &item) {
+    size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+    Cell *cell;
+    while (true) {
+        cell = &cells_[pos & mask_];
+        size_t seq = cell->seq.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+        if (diff == 0) {
+            if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false; // 队列已满
+        } else {
+            pos = enqueuePos_.load(std::memory_order_relaxed);
+        }
+    }
+    cell->data = item;
+    cell->seq.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+template<class T>
+bool LockFreeQueue<T>::TryPop(T &item) {
+    size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+    Cell *cell;
+    while (true) {
+        cell = &cells_[pos & mask_];
+        size_t seq = cell->seq.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+        if (diff == 0) {
+            if (dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false; // 队列为空
+        } else {
+            pos = dequeuePos_.load(std::memory_order_relaxed);
+        }
+    }
+    item = cell->data;
+    cell->seq.store(pos + mask_ + 1, std::memory_order_release);
+    return true;
+}
+
+#endif // LOCKFREEQUEUE_H
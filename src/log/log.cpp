@@ -1,58 +1,125 @@
 #include "log.h"
+#include <ctype.h>
+#include <dirent.h>
+#include <zlib.h>
+#include <algorithm>
 using namespace std;
 
+constexpr chrono::milliseconds Log::FLUSH_INTERVAL;
+atomic<int> Log::effectiveLevel_[LOG_MOD_COUNT] = {{LOG_LEVEL_OFF}, {LOG_LEVEL_OFF}, {LOG_LEVEL_OFF},
+                                                   {LOG_LEVEL_OFF}, {LOG_LEVEL_OFF}};
+
+static const char *const MODULE_NAMES[LOG_MOD_COUNT] = {"core", "http", "server", "pool", "timer"};
+
+namespace
+{
+/* 线程退出时把自己的LogRing交还给写线程回收 */
+struct RingHolder
+{
+    shared_ptr<LogRing> ring;
+    ~RingHolder()
+    {
+        if (ring)
+        {
+            ring->Detach();
+        }
+    }
+};
+}
+
 Log::Log()
 {
-    lineCount_ = 0;
+    fileBytes_ = 0;
+    fileIndex_ = 0;
+    maxFileBytes_ = 64 << 20;
+    maxTotalBytes_ = 1ull << 30;
+    compress_ = true;
     writeThread_ = nullptr;
-    deque_ = nullptr;
     toDay_ = 0;
     fp_ = nullptr;
+    isOpen_ = false;
+    level_ = 1;
+    for (auto &level : moduleLevel_)
+    {
+        level = -1;
+    }
+    mode_ = LOG_TEXT;
+    ringCapacity_ = 1024 * LINE_RESERVE;
+    notified_ = false;
+    flushRequested_ = false;
 }
 Log::~Log()
 {
     if (writeThread_ && writeThread_->joinable())
     {
-        while (!deque_->empty())
         {
-            deque_->flush();
-        };
-        deque_->Close();
+            lock_guard<mutex> locker(mtx_);
+            isOpen_ = false;
+            UpdateEffectiveLevels_();
+        }
+        cond_.notify_one();
         writeThread_->join();
     }
+    if (compressThread_ && compressThread_->joinable())
+    {
+        compressQue_.push_back(string()); // 空路径通知压缩线程退出
+        compressThread_->join();
+    }
     if (fp_)
     {
-        lock_guard<mutex> locker(mtx_);
-        flush();
+        fflush(fp_);
         fclose(fp_);
+        fp_ = nullptr;
     }
-    isOpen_ = false;
 }
-void Log::AppendLogLevelTitle_(int level)
+void Log::AppendLogLevelTitle_(fmt::memory_buffer &line, int level)
+{
+    line.append(string_view(logrecord::LevelTitle(level)));
+}
+
+fmt::memory_buffer &Log::LineBuffer_()
+{
+    thread_local fmt::memory_buffer line;
+    return line;
+}
+
+LogRing *Log::LocalRing_()
+{
+    thread_local RingHolder holder;
+    if (!holder.ring)
+    {
+        holder.ring = make_shared<LogRing>(ringCapacity_);
+        lock_guard<mutex> locker(ringMtx_);
+        rings_.push_back(holder.ring);
+    }
+    return holder.ring.get();
+}
+
+void Log::Append_(const char *line, size_t len)
 {
-    switch (level)
+    LogRing *ring = LocalRing_();
+    while (!ring->Append(line, len))
+    {
+        /* 超过整个缓冲区的行无法写入；否则等写线程取走数据 */
+        if (len > ring->Capacity() || !isOpen_)
+        {
+            return;
+        }
+        notified_ = true;
+        cond_.notify_one();
+        this_thread::yield();
+    }
+    if (ring->ReadableBytes() >= ring->Capacity() / 2 && !notified_.exchange(true))
     {
-    case 0:
-        buff_.Append("[debug]: ", 9);
-        break;
-    case 1:
-        buff_.Append("[info] : ", 9);
-        break;
-    case 2:
-        buff_.Append("[warn] : ", 9);
-        break;
-    case 3:
-        buff_.Append("[error]: ", 9);
-        break;
-    default:
-        buff_.Append("[info] : ", 9);
-        break;
+        cond_.notify_one();
     }
 }
+
 void Log::flush()
 {
-    deque_->flush();
-    fflush(fp_);
+    flushRequested_ = true;
+    notified_ = true;
+    cond_.notify_one();
 }
 Log *Log::Instance()
 {
@@ -65,19 +132,340 @@ void Log::FlushLogThread()
     Log::Instance()->AsyncWrite_();
 }
 
-void Log::AsyncWrite_()
+uint32_t Log::RegisterFormat(int level, const char *format, const char *file, int line)
+{
+    Log *log = Instance();
+    lock_guard<mutex> locker(log->formatsMtx_);
+    log->formats_.push_back({level, line, file, format});
+    return static_cast<uint32_t>(log->formats_.size() - 1);
+}
+
+/* 取回新注册的格式串；二进制模式下先把它们作为字典记录写入文件 */
+void Log::SyncFormats_()
+{
+    size_t from = known_.size();
+    {
+        lock_guard<mutex> locker(formatsMtx_);
+        known_.insert(known_.end(), formats_.begin() + from, formats_.end());
+    }
+    if (mode_ == LOG_BINARY)
+    {
+        for (size_t i = from; i < known_.size(); i++)
+        {
+            logrecord::BuildDict(out_, static_cast<uint32_t>(i), known_[i]);
+            fileBytes_ += fwrite(out_.data(), 1, out_.size(), fp_);
+        }
+    }
+}
+
+void Log::WriteBlock_(const char *data, size_t len)
+{
+    if (mode_ != LOG_DEFERRED)
+    {
+        fileBytes_ += fwrite(data, 1, len, fp_);
+        return;
+    }
+    /* 延迟模式：逐条解析记录并格式化为文本 */
+    out_.clear();
+    const char *end = data + len;
+    while (static_cast<size_t>(end - data) >= sizeof(logrecord::Header))
+    {
+        logrecord::Header header;
+        memcpy(&header, data, sizeof(header));
+        if (header.size < sizeof(header) || header.size > static_cast<size_t>(end - data))
+        {
+            break;
+        }
+        if (header.fmtId < known_.size())
+        {
+            const logrecord::FormatInfo &info = known_[header.fmtId];
+            out_.append(WallClock::LogPrefix(header.timeNs));
+            AppendLogLevelTitle_(out_, info.level);
+            logrecord::FormatMessage(data, header.size, info, out_);
+            out_.push_back('\n');
+        }
+        data += header.size;
+    }
+    fileBytes_ += fwrite(out_.data(), 1, out_.size(), fp_);
+}
+
+size_t Log::CollectRings_(Buffer &block)
+{
+    size_t bytes = 0;
+    lock_guard<mutex> locker(ringMtx_);
+    for (auto it = rings_.begin(); it != rings_.end();)
+    {
+        /* 先判断Detached再取数据，保证线程退出前写入的内容不会丢失 */
+        bool detached = (*it)->Detached();
+        bytes += (*it)->DrainTo(block);
+        if (detached)
+        {
+            it = rings_.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    return bytes;
+}
+
+/* 只在写线程调用：跨天或当前文件超过maxFileBytes_时切换文件，旧文件交给压缩线程 */
+void Log::RotateIfNeeded_(size_t incoming)
+{
+    time_t now_time_t = time(nullptr);
+    tm t;
+    localtime_r(&now_time_t, &t);
+
+    if (toDay_ == t.tm_mday && (fileBytes_ == 0 || fileBytes_ + incoming <= maxFileBytes_.load()))
+    {
+        return;
+    }
+    string tail = fmt::format("{:04}_{:02}_{:02}", t.tm_year + 1900, t.tm_mon + 1, t.tm_mday);
+    string newFile;
+    if (toDay_ != t.tm_mday)
+    {
+        toDay_ = t.tm_mday;
+        fileIndex_ = 0;
+        newFile = FileName_(tail);
+    }
+    else
+    {
+        newFile = FileName_(fmt::format("{}-{}", tail, ++fileIndex_));
+    }
+    /* 同一天内按序号递增，跳过已存在(含已压缩)的文件 */
+    struct stat st;
+    while (stat(newFile.c_str(), &st) == 0 || stat((newFile + ".gz").c_str(), &st) == 0)
+    {
+        newFile = FileName_(fmt::format("{}-{}", tail, ++fileIndex_));
+    }
+
+    fflush(fp_);
+    fclose(fp_);
+    fp_ = fopen(newFile.c_str(), "a");
+    assert(fp_ != nullptr);
+    string oldFile;
+    {
+        lock_guard<mutex> locker(mtx_);
+        oldFile = fileName_;
+        fileName_ = newFile;
+    }
+    compressQue_.push_back(move(oldFile));
+    fileBytes_ = 0;
+    if (mode_ == LOG_BINARY)
+    {
+        /* 新文件需要完整的文件头和字典才能独立解码 */
+        fileBytes_ += fwrite(logrecord::FILE_MAGIC, 1, sizeof(logrecord::FILE_MAGIC), fp_);
+        known_.clear();
+    }
+}
+
+void Log::SetRotation(size_t maxFileBytes, size_t maxTotalBytes, bool compress)
+{
+    assert(maxFileBytes > 0);
+    maxFileBytes_ = maxFileBytes;
+    maxTotalBytes_ = maxTotalBytes;
+    compress_ = compress;
+}
+
+void Log::CompressThread()
+{
+    Log::Instance()->AsyncCompress_();
+}
+
+void Log::AsyncCompress_()
+{
+    string file;
+    while (compressQue_.pop_move(file) && !file.empty())
+    {
+        if (compress_ && Compress_(file))
+        {
+            unlink(file.c_str());
+        }
+        EnforceQuota_();
+    }
+}
+
+bool Log::Compress_(const string &file)
+{
+    FILE *src = fopen(file.c_str(), "rb");
+    if (!src)
+    {
+        return false;
+    }
+    string dstName = file + ".gz";
+    gzFile dst = gzopen(dstName.c_str(), "wb6");
+    if (!dst)
+    {
+        fclose(src);
+        return false;
+    }
+    vector<char> chunk(1 << 16);
+    size_t n;
+    bool ok = true;
+    while ((n = fread(chunk.data(), 1, chunk.size(), src)) > 0)
+    {
+        if (gzwrite(dst, chunk.data(), static_cast<unsigned>(n)) != static_cast<int>(n))
+        {
+            ok = false;
+            break;
+        }
+    }
+    fclose(src);
+    ok = (gzclose(dst) == Z_OK) && ok;
+    if (!ok)
+    {
+        unlink(dstName.c_str());
+    }
+    return ok;
+}
+
+/* 目录下日志总量超过maxTotalBytes_时，从最旧的文件开始删除，正在写的文件除外 */
+void Log::EnforceQuota_()
 {
-    string str = "";
-    while (deque_->pop(str))
+    size_t quota = maxTotalBytes_;
+    if (quota == 0)
+    {
+        return;
+    }
+    DIR *dir = opendir(path_);
+    if (!dir)
+    {
+        return;
+    }
+    struct Entry
+    {
+        string path;
+        int64_t mtimeNs;
+        size_t size;
+    };
+    vector<Entry> files;
+    size_t total = 0;
+    string active;
     {
         lock_guard<mutex> locker(mtx_);
-        fputs(str.c_str(), fp_);
+        active = fileName_;
+    }
+    while (dirent *ent = readdir(dir))
+    {
+        string name = ent->d_name;
+        if (!IsOwnFile_(name))
+        {
+            continue;
+        }
+        string full = fmt::format("{}/{}", path_, name);
+        struct stat st;
+        if (stat(full.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+        {
+            continue;
+        }
+        total += st.st_size;
+        if (full != active)
+        {
+            int64_t mtimeNs = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+            files.push_back({full, mtimeNs, static_cast<size_t>(st.st_size)});
+        }
+    }
+    closedir(dir);
+    sort(files.begin(), files.end(), [](const Entry &a, const Entry &b)
+         { return a.mtimeNs < b.mtimeNs; });
+    for (const auto &f : files)
+    {
+        if (total <= quota)
+        {
+            break;
+        }
+        if (unlink(f.path.c_str()) == 0)
+        {
+            total -= f.size;
+        }
+    }
+}
+
+/* 本logger切出来的文件：YYYY_MM_DD[-N]<suffix>[.bin][.gz]
+   同目录下的其他文件(如slow.log、其他worker的日志)不计入配额，也不会被删除 */
+bool Log::IsOwnFile_(const string &name) const
+{
+    static const size_t DATE_LEN = 10; // YYYY_MM_DD
+    if (name.size() <= DATE_LEN)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < DATE_LEN; i++)
+    {
+        bool ok = (i == 4 || i == 7) ? name[i] == '_' : isdigit(static_cast<unsigned char>(name[i]));
+        if (!ok)
+        {
+            return false;
+        }
+    }
+    size_t pos = DATE_LEN;
+    if (name[pos] == '-')
+    {
+        size_t digits = ++pos;
+        while (pos < name.size() && isdigit(static_cast<unsigned char>(name[pos])))
+        {
+            pos++;
+        }
+        if (pos == digits)
+        {
+            return false;
+        }
+    }
+    string rest = name.substr(pos);
+    if (rest.size() > 3 && rest.compare(rest.size() - 3, 3, ".gz") == 0)
+    {
+        rest.resize(rest.size() - 3);
+    }
+    return rest == suffix_ || rest == string(suffix_) + ".bin";
+}
+
+string Log::FileName_(const string &tail) const
+{
+    return fmt::format("{}/{}{}{}", path_, tail, suffix_, mode_ == LOG_BINARY ? ".bin" : "");
+}
+
+void Log::AsyncWrite_()
+{
+    Buffer block(static_cast<int>(FLUSH_BYTES));
+    size_t unflushed = 0;
+    auto lastFlush = chrono::steady_clock::now();
+    while (true)
+    {
+        {
+            unique_lock<mutex> locker(mtx_);
+            cond_.wait_for(locker, FLUSH_INTERVAL, [this] { return notified_ || !isOpen_; });
+        }
+        notified_ = false;
+        bool closing = !isOpen_;
+
+        size_t bytes = CollectRings_(block);
+        if (bytes > 0)
+        {
+            RotateIfNeeded_(bytes);
+            SyncFormats_();
+            WriteBlock_(block.Peek(), bytes);
+            block.Retrieve(bytes);
+            unflushed += bytes;
+        }
+
+        auto now = chrono::steady_clock::now();
+        if (unflushed > 0 && (unflushed >= FLUSH_BYTES || now - lastFlush >= FLUSH_INTERVAL ||
+                              flushRequested_.exchange(false) || closing))
+        {
+            fflush(fp_);
+            unflushed = 0;
+            lastFlush = now;
+        }
+        if (closing)
+        {
+            return;
+        }
     }
 }
 
 int Log::GetLevel()
 {
-    lock_guard<mutex> locker(mtx_);
     return level_;
 }
 
@@ -85,38 +473,84 @@ void Log::SetLevel(int level)
 {
     lock_guard<mutex> locker(mtx_);
     level_ = level;
+    UpdateEffectiveLevels_();
 }
 
-void Log::init(int level, const char *path, const char *suffix, int maxQueueCapacity)
+void Log::SetModuleLevel(int module, int level)
 {
+    assert(module >= 0 && module < LOG_MOD_COUNT);
+    lock_guard<mutex> locker(mtx_);
+    moduleLevel_[module] = level;
+    UpdateEffectiveLevels_();
+}
+
+int Log::GetModuleLevel(int module)
+{
+    assert(module >= 0 && module < LOG_MOD_COUNT);
+    int level = moduleLevel_[module];
+    return level < 0 ? level_.load() : level;
+}
+
+int Log::ModuleByName(const string &name)
+{
+    for (int i = 0; i < LOG_MOD_COUNT; i++)
+    {
+        if (name == MODULE_NAMES[i])
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* 调用方持有mtx_ */
+void Log::UpdateEffectiveLevels_()
+{
+    for (int i = 0; i < LOG_MOD_COUNT; i++)
+    {
+        int level = moduleLevel_[i] < 0 ? level_.load() : moduleLevel_[i].load();
+        effectiveLevel_[i].store(isOpen_ ? level : LOG_LEVEL_OFF, memory_order_relaxed);
+    }
+}
+
+void Log::init(int level, const char *path, const char *suffix, int maxQueueCapacity, int mode)
+{
+    assert(!writeThread_);
     /* 初始化各个成员变量 */
     level_ = level;
+    mode_ = mode;
     path_ = path;
     suffix_ = suffix;
-    isOpen_ = true;
-    deque_ = std::make_unique<BlockDeque<std::string>>(maxQueueCapacity);
-    writeThread_ = std::make_unique<std::thread>(FlushLogThread);
+    ringCapacity_ = static_cast<size_t>(maxQueueCapacity > 0 ? maxQueueCapacity : 1) * LINE_RESERVE;
     /* 先用时间格式化文件名 */
     auto now = chrono::system_clock::now();
     time_t now_time_t = chrono::system_clock::to_time_t(now);
     tm tm = *localtime(&now_time_t);
-    string fileName = (fmt::format("{}/{:04}_{:02}_{:02}{}", path_, tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, suffix_));
+    toDay_ = tm.tm_mday;
+    string fileName = FileName_(fmt::format("{:04}_{:02}_{:02}", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday));
     /* 打开文件 */
+    fp_ = fopen(fileName.c_str(), "a");
+    if (fp_ == nullptr)
     {
-        lock_guard<mutex> locker(mtx_);
-        buff_.RetrieveAll();
-        if (fp_)
-        {
-            deque_->flush();
-            fflush(fp_);
-            fclose(fp_);
-        }
+        mkdir(path_, 0777);
         fp_ = fopen(fileName.c_str(), "a");
-        if (fp_ == nullptr)
-        {
-            mkdir(path_, 0777);
-            fp_ = fopen(fileName.c_str(), "a");
-        }
-        assert(fp_ != nullptr);
     }
-}
\ No newline at end of file
+    assert(fp_ != nullptr);
+    fseek(fp_, 0, SEEK_END);
+    fileBytes_ = ftell(fp_);
+    if (mode_ == LOG_BINARY)
+    {
+        fileBytes_ += fwrite(logrecord::FILE_MAGIC, 1, sizeof(logrecord::FILE_MAGIC), fp_);
+    }
+    {
+        lock_guard<mutex> locker(mtx_);
+        fileName_ = fileName;
+    }
+    compressThread_ = std::make_unique<std::thread>(CompressThread);
+    {
+        lock_guard<mutex> locker(mtx_);
+        isOpen_ = true;
+        UpdateEffectiveLevels_();
+    }
+    writeThread_ = std::make_unique<std::thread>(FlushLogThread);
+}
@@ -2,126 +2,189 @@
 #define LOG_H
 /*
 多线程异步日志
+1. 每个线程把格式化好的日志行写入自己的LogRing，不加锁
+2. 后台写线程按时间或数据量把所有LogRing整块取走，一次fwrite写入文件
+3. fflush按时间(FLUSH_INTERVAL)或数据量(FLUSH_BYTES)触发，不再每行刷盘
+   跨天或文件超过maxFileBytes_时由写线程切换文件，旧文件交给压缩线程gzip，
+   并把日志目录的总大小限制在maxTotalBytes_以内
+4. LOG_DEFERRED/LOG_BINARY模式下调用线程只拷贝格式串编号和原始参数(见logrecord.h)，
+   格式化由写线程完成，或直接写二进制文件交给tools/logdecode离线还原
 */
 #include <mutex>
 #include <string>
 #include <thread>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <sys/time.h>
 #include <string.h>
 #include <stdarg.h> // vastart va_end
 #include <assert.h>
 #include <sys/stat.h> //mkdir
-#include "blockQueue.h"
 #include <iomanip>
-#include <fmt/core.h>
+#include <fmt/format.h>
+#include "blockQueue.h"
+#include "logbuffer.h"
+#include "logrecord.h"
 #include "../buffer/buffer.h"
+#include "../timer/wallclock.h"
 using namespace std;
+
+enum LogModule
+{
+    LOG_MOD_CORE = 0,
+    LOG_MOD_HTTP,
+    LOG_MOD_SERVER,
+    LOG_MOD_POOL,
+    LOG_MOD_TIMER,
+    LOG_MOD_COUNT,
+};
+
+static const int LOG_LEVEL_OFF = 4; // 高于所有级别，表示关闭
+
+/* 编译期最低级别：低于它的LOG_*调用是死代码，例如 -DLOG_MIN_LEVEL=1 去掉所有LOG_DEBUG */
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL 0
+#endif
+
+/* 调用点所属模块：源文件在include之后 #undef LOG_MODULE 再重新定义 */
+#ifndef LOG_MODULE
+#define LOG_MODULE LOG_MOD_CORE
+#endif
+
+enum LogMode
+{
+    LOG_TEXT = 0,     // 调用线程格式化
+    LOG_DEFERRED = 1, // 调用线程只记录原始参数，写线程格式化为文本
+    LOG_BINARY = 2,   // 直接写二进制记录，离线解码
+};
+
 class Log
 {
 public:
+    /* maxQueueCapacity: 每个线程缓冲区可容纳的日志行数，按每行256字节折算 */
     void init(int level, const char *path = "./log",
               const char *suffix = ".log",
-              int maxQueueCapacity = 1024);
+              int maxQueueCapacity = 1024,
+              int mode = LOG_TEXT);
+
+    /* 单个文件上限、日志目录总量上限(0表示不限)、是否压缩切换下来的文件 */
+    void SetRotation(size_t maxFileBytes, size_t maxTotalBytes, bool compress);
 
     static Log *Instance();
     static void FlushLogThread();
+    static void CompressThread();
+    /* 每个调用点只注册一次，返回格式串编号 */
+    static uint32_t RegisterFormat(int level, const char *format, const char *file, int line);
     template <typename... Args>
-    void write(int level, string &&format, Args &&...args)
+    void write(int level, uint32_t fmtId, const char *format, Args &&...args)
     {
-        auto now = chrono::system_clock::now();
-        time_t now_time_t = chrono::system_clock::to_time_t(now);
-        tm t = *localtime(&now_time_t);
-
-        /* 日志日期 日志行数 */
-        if (toDay_ != t.tm_mday || (lineCount_ && (lineCount_ % MAX_LINES == 0)))
+        if (mode_ != LOG_TEXT)
         {
-            unique_lock<mutex> locker(mtx_);
-            locker.unlock();
-            string newFile;
-            string tail = fmt::format("{:04}_{:02}_{:02}", t.tm_year + 1900, t.tm_mon + 1, t.tm_mday);
-            if (toDay_ != t.tm_mday)
-            {
-                newFile = fmt::format("{}/{}{}", path_, tail, suffix_);
-                toDay_ = t.tm_mday;
-                lineCount_ = 0;
-            }
-            else
-            {
-                newFile = fmt::format("{}/{}-{}{}", path_, tail, (lineCount_ / MAX_LINES), suffix_);
-            }
-
-            locker.lock();
-            flush();
-            fclose(fp_);
-            fp_ = fopen(newFile.c_str(), "a");
-            assert(fp_ != nullptr);
+            fmt::memory_buffer &record = LineBuffer_();
+            logrecord::Build(record, fmtId, WallClock::NowNs(), args...);
+            Append_(record.data(), record.size());
+            return;
         }
 
-        {
-            unique_lock<mutex> locker(mtx_);
-            lineCount_++;
-            buff_.Append(fmt::format("{:04}-{:02}-{:02} {:02}:{:02}:{:02} ",
-                                     t.tm_year + 1900, t.tm_mon + 1, t.tm_mday,
-                                     t.tm_hour, t.tm_min, t.tm_sec));
-            AppendLogLevelTitle_(level);
-            string message = fmt::vformat(format, fmt::make_format_args(forward<Args>(args)...));
-            buff_.Append(message.c_str(), message.size());
-            buff_.Append("\n\0", 2);
-            if (deque_ && !deque_->full())
-            {
-                deque_->push_back(buff_.RetrieveAllToStr());
-            }
-            else
-            {
-                fputs(buff_.Peek(), fp_);
-            }
-
-            buff_.RetrieveAll();
-        }
+        fmt::memory_buffer &line = LineBuffer_();
+        line.clear();
+        line.append(WallClock::LogPrefix());
+        AppendLogLevelTitle_(line, level);
+        fmt::vformat_to(fmt::appender(line), format, fmt::make_format_args(args...));
+        line.push_back('\n');
+        Append_(line.data(), line.size());
     }
     void flush();
 
+    /* 调用点的快速判断：只读一个原子变量，不加锁 */
+    static bool Enabled(int level, int module)
+    {
+        return level >= effectiveLevel_[module].load(memory_order_relaxed);
+    }
     int GetLevel();
     void SetLevel(int level);
+    /* level < 0 表示跟随全局级别 */
+    void SetModuleLevel(int module, int level);
+    int GetModuleLevel(int module);
+    static int ModuleByName(const string &name);
     bool IsOpen() { return isOpen_; }
 
 private:
     Log();
-    void AppendLogLevelTitle_(int level);
+    static void AppendLogLevelTitle_(fmt::memory_buffer &line, int level);
+    static fmt::memory_buffer &LineBuffer_();
     ~Log();
+    LogRing *LocalRing_();
+    void Append_(const char *line, size_t len);
     void AsyncWrite_();
+    size_t CollectRings_(Buffer &block);
+    void SyncFormats_();
+    void WriteBlock_(const char *data, size_t len);
+    string FileName_(const string &tail) const;
+    bool IsOwnFile_(const string &name) const;
+    void RotateIfNeeded_(size_t incoming);
+    void AsyncCompress_();
+    bool Compress_(const string &file);
+    void EnforceQuota_();
+    void UpdateEffectiveLevels_();
 
 private:
     static const int LOG_PATH_LEN = 256;
     static const int LOG_NAME_LEN = 256;
-    static const int MAX_LINES = 50000;
+    static const int LINE_RESERVE = 256;
+    static const size_t FLUSH_BYTES = 1 << 20;
+    static constexpr chrono::milliseconds FLUSH_INTERVAL{1000};
 
     const char *path_;
     const char *suffix_;
 
-    int lineCount_;
+    size_t fileBytes_; // 当前文件已写入的字节数，只在写线程访问
+    int fileIndex_;
     int toDay_;
+    string fileName_; // 当前文件，压缩线程清理时跳过
+
+    atomic<size_t> maxFileBytes_;
+    atomic<size_t> maxTotalBytes_;
+    atomic<bool> compress_;
+
+    atomic<bool> isOpen_;
 
-    bool isOpen_;
+    atomic<int> level_;
+    atomic<int> moduleLevel_[LOG_MOD_COUNT];
+    static atomic<int> effectiveLevel_[LOG_MOD_COUNT]; // 关闭时为LOG_LEVEL_OFF
+    int mode_;
+    size_t ringCapacity_;
 
-    Buffer buff_;
-    int level_;
+    vector<logrecord::FormatInfo> formats_; // 所有已注册的格式串
+    mutex formatsMtx_;
+    vector<logrecord::FormatInfo> known_; // 写线程持有的副本，只在写线程访问
+    fmt::memory_buffer out_;              // 写线程的格式化输出
 
     FILE *fp_;
-    unique_ptr<BlockDeque<string>> deque_;
+    vector<shared_ptr<LogRing>> rings_;
+    mutex ringMtx_; // 只保护rings_的注册和回收
     unique_ptr<thread> writeThread_;
-    mutex mtx_;
+    BlockDeque<string> compressQue_;
+    unique_ptr<thread> compressThread_;
+    atomic<bool> notified_;
+    atomic<bool> flushRequested_;
+    mutex mtx_; // 写线程的条件变量，以及级别的修改
+    condition_variable cond_;
 };
 
-#define LOG_BASE(level, format, ...)                          \
-    do                                                        \
-    {                                                         \
-        Log *log = Log::Instance();                           \
-        if (log->IsOpen() && log->GetLevel() <= level)        \
-        {                                                     \
-            log->write(level, string(format), ##__VA_ARGS__); \
-            log->flush();                                     \
-        }                                                     \
+/* format必须是字符串字面量：每个调用点的格式串只在第一次执行时注册 */
+#define LOG_BASE(level, format, ...)                                           \
+    do                                                                         \
+    {                                                                          \
+        if ((level) >= LOG_MIN_LEVEL && Log::Enabled(level, LOG_MODULE))       \
+        {                                                                      \
+            static const uint32_t logFmtId =                                   \
+                Log::RegisterFormat(level, format, __FILE__, __LINE__);        \
+            Log::Instance()->write(level, logFmtId, format, ##__VA_ARGS__);    \
+        }                                                                      \
     } while (0);
 
 #define LOG_DEBUG(format, ...)             \
@@ -0,0 +1,79 @@
+#ifndef LOGBUFFER_H
+#define LOGBUFFER_H
+/*
+单生产者单消费者的无锁环形缓冲区
+1. 每个写日志的线程独占一个LogRing，写入时不加锁
+2. 后台写线程是唯一的消费者，把所有线程的LogRing整块取走
+3. 生产者只在整条日志写完后才发布head_，消费者看到的总是完整的行
+*/
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include <assert.h>
+#include "../buffer/buffer.h"
+
+class LogRing {
+public:
+    explicit LogRing(size_t capacity) : buffer_(RoundUp_(capacity)), mask_(buffer_.size() - 1),
+                                        head_(0), tail_(0), detached_(false) {}
+
+    /* 生产者调用：空间不够时整条放弃，返回false */
+    bool Append(const char* data, size_t len) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t tail = tail_.load(std::memory_order_acquire);
+        if (buffer_.size() - (head - tail) < len) {
+            return false;
+        }
+        size_t pos = head & mask_;
+        size_t first = std::min(len, buffer_.size() - pos);
+        std::copy(data, data + first, &buffer_[pos]);
+        std::copy(data + first, data + len, &buffer_[0]);
+        head_.store(head + len, std::memory_order_release);
+        return true;
+    }
+
+    /* 消费者调用：把当前所有可读数据追加到buff中，返回字节数 */
+    size_t DrainTo(Buffer& buff) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t head = head_.load(std::memory_order_acquire);
+        size_t len = head - tail;
+        if (len == 0) {
+            return 0;
+        }
+        size_t pos = tail & mask_;
+        size_t first = std::min(len, buffer_.size() - pos);
+        buff.Append(&buffer_[pos], first);
+        if (len > first) {
+            buff.Append(&buffer_[0], len - first);
+        }
+        tail_.store(head, std::memory_order_release);
+        return len;
+    }
+
+    size_t ReadableBytes() const {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+    size_t Capacity() const { return buffer_.size(); }
+
+    /* 所属线程退出后标记，写线程取空后回收 */
+    void Detach() { detached_.store(true, std::memory_order_release); }
+    bool Detached() const { return detached_.load(std::memory_order_acquire); }
+
+private:
+    static size_t RoundUp_(size_t n) {
+        size_t cap = 4096;
+        while (cap < n) {
+            cap <<= 1;
+        }
+        return cap;
+    }
+
+    std::vector<char> buffer_;
+    const size_t mask_;
+    alignas(64) std::atomic<size_t> head_; // 生产者写入位置
+    alignas(64) std::atomic<size_t> tail_; // 消费者读取位置
+    std::atomic<bool> detached_;
+};
+
+#endif // LOGBUFFER_H
@@ -0,0 +1,349 @@
+#ifndef LOGRECORD_H
+#define LOGRECORD_H
+/*
+延迟格式化日志的二进制记录
+1. 每个调用点的格式串在第一次执行时注册，得到一个静态的fmtId
+2. 调用线程只把 [头部][fmtId][时间戳][参数类型+原始值] 拷贝进LogRing，不做格式化
+3. 写线程(LOG_DEFERRED)或离线工具tools/logdecode(LOG_BINARY)再根据fmtId还原出文本
+
+记录格式(小端，按字节紧凑排列)：
+    uint32 size      整条记录的字节数，含头部
+    uint32 fmtId     格式串编号；DICT_ID表示这是一条格式串字典记录
+    int64  timeNs    system_clock时间戳(纳秒)
+    args...          每个参数 uint8 类型 + 值，字符串为 uint32 长度 + 内容
+字典记录在头部之后依次是 uint32 id, uint8 level, uint32 line, 字符串 file, 字符串 format
+*/
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <type_traits>
+#include <fmt/format.h>
+#include <fmt/args.h>
+#include "../timer/wallclock.h"
+
+namespace logrecord
+{
+static const char FILE_MAGIC[8] = {'W', 'S', 'B', 'L', 'O', 'G', '1', '\n'};
+static const uint32_t DICT_ID = 0xFFFFFFFFu;
+
+enum ArgType : uint8_t
+{
+    ARG_I64 = 1,
+    ARG_U64,
+    ARG_F64,
+    ARG_BOOL,
+    ARG_CHAR,
+    ARG_STR,
+};
+
+struct FormatInfo
+{
+    int level;
+    int line;
+    std::string file;
+    std::string format;
+};
+
+struct Header
+{
+    uint32_t size;
+    uint32_t fmtId;
+    int64_t timeNs;
+};
+
+inline void Put(fmt::memory_buffer &out, const void *data, size_t len)
+{
+    const char *p = static_cast<const char *>(data);
+    out.append(p, p + len);
+}
+
+inline void PutStr(fmt::memory_buffer &out, const char *str, size_t len)
+{
+    uint32_t n = static_cast<uint32_t>(len);
+    Put(out, &n, sizeof(n));
+    Put(out, str, len);
+}
+
+template <typename T>
+inline void PutTyped(fmt::memory_buffer &out, ArgType type, T value)
+{
+    out.push_back(static_cast<char>(type));
+    Put(out, &value, sizeof(value));
+}
+
+/* 各类参数的编码，未知类型退化为在调用点格式化成字符串 */
+inline void Encode(fmt::memory_buffer &out, bool v) { PutTyped(out, ARG_BOOL, static_cast<uint8_t>(v)); }
+inline void Encode(fmt::memory_buffer &out, char v) { PutTyped(out, ARG_CHAR, v); }
+inline void Encode(fmt::memory_buffer &out, const char *v)
+{
+    out.push_back(static_cast<char>(ARG_STR));
+    PutStr(out, v ? v : "(null)", v ? strlen(v) : 6);
+}
+inline void Encode(fmt::memory_buffer &out, const std::string &v)
+{
+    out.push_back(static_cast<char>(ARG_STR));
+    PutStr(out, v.data(), v.size());
+}
+inline void Encode(fmt::memory_buffer &out, fmt::string_view v)
+{
+    out.push_back(static_cast<char>(ARG_STR));
+    PutStr(out, v.data(), v.size());
+}
+template <typename T>
+inline void Encode(fmt::memory_buffer &out, const T &v)
+{
+    using U = typename std::decay<T>::type;
+    if constexpr (std::is_enum<U>::value)
+    {
+        PutTyped(out, ARG_I64, static_cast<int64_t>(v));
+    }
+    else if constexpr (std::is_integral<U>::value && std::is_signed<U>::value)
+    {
+        PutTyped(out, ARG_I64, static_cast<int64_t>(v));
+    }
+    else if constexpr (std::is_integral<U>::value)
+    {
+        PutTyped(out, ARG_U64, static_cast<uint64_t>(v));
+    }
+    else if constexpr (std::is_floating_point<U>::value)
+    {
+        PutTyped(out, ARG_F64, static_cast<double>(v));
+    }
+    else if constexpr (std::is_convertible<U, const char *>::value)
+    {
+        Encode(out, static_cast<const char *>(v));
+    }
+    else
+    {
+        std::string s = fmt::format("{}", v);
+        Encode(out, s);
+    }
+}
+
+/* 在out中生成一条完整记录 */
+template <typename... Args>
+inline void Build(fmt::memory_buffer &out, uint32_t fmtId, int64_t timeNs, const Args &...args)
+{
+    out.clear();
+    Header header{0, fmtId, timeNs};
+    Put(out, &header, sizeof(header));
+    (Encode(out, args), ...);
+    uint32_t size = static_cast<uint32_t>(out.size());
+    memcpy(out.data(), &size, sizeof(size));
+}
+
+inline void BuildDict(fmt::memory_buffer &out, uint32_t id, const FormatInfo &info)
+{
+    out.clear();
+    Header header{0, DICT_ID, 0};
+    Put(out, &header, sizeof(header));
+    Put(out, &id, sizeof(id));
+    uint8_t level = static_cast<uint8_t>(info.level);
+    Put(out, &level, sizeof(level));
+    uint32_t line = static_cast<uint32_t>(info.line);
+    Put(out, &line, sizeof(line));
+    PutStr(out, info.file.data(), info.file.size());
+    PutStr(out, info.format.data(), info.format.size());
+    uint32_t size = static_cast<uint32_t>(out.size());
+    memcpy(out.data(), &size, sizeof(size));
+}
+
+inline const char *LevelTitle(int level)
+{
+    switch (level)
+    {
+    case 0:
+        return "[debug]: ";
+    case 2:
+        return "[warn] : ";
+    case 3:
+        return "[error]: ";
+    default:
+        return "[info] : ";
+    }
+}
+
+class Reader
+{
+public:
+    Reader(const char *begin, const char *end) : p_(begin), end_(end) {}
+    bool Get(void *data, size_t len)
+    {
+        if (static_cast<size_t>(end_ - p_) < len)
+        {
+            return false;
+        }
+        memcpy(data, p_, len);
+        p_ += len;
+        return true;
+    }
+    bool GetStr(std::string &str)
+    {
+        uint32_t n = 0;
+        if (!Get(&n, sizeof(n)) || static_cast<size_t>(end_ - p_) < n)
+        {
+            return false;
+        }
+        str.assign(p_, n);
+        p_ += n;
+        return true;
+    }
+    bool Done() const { return p_ >= end_; }
+
+private:
+    const char *p_;
+    const char *end_;
+};
+
+/* 解析字典记录，rec指向记录头部 */
+inline bool DecodeDict(const char *rec, uint32_t size, uint32_t &id, FormatInfo &info)
+{
+    Reader r(rec + sizeof(Header), rec + size);
+    uint8_t level = 0;
+    uint32_t line = 0;
+    if (!r.Get(&id, sizeof(id)) || !r.Get(&level, sizeof(level)) || !r.Get(&line, sizeof(line)) ||
+        !r.GetStr(info.file) || !r.GetStr(info.format))
+    {
+        return false;
+    }
+    info.level = level;
+    info.line = static_cast<int>(line);
+    return true;
+}
+
+/* 按格式串还原消息正文，追加到out；不含时间与级别前缀 */
+inline bool FormatMessage(const char *rec, uint32_t size, const FormatInfo &info, fmt::memory_buffer &out)
+{
+    Reader r(rec + sizeof(Header), rec + size);
+    fmt::dynamic_format_arg_store<fmt::format_context> store;
+    while (!r.Done())
+    {
+        uint8_t type = 0;
+        r.Get(&type, sizeof(type));
+        switch (type)
+        {
+        case ARG_I64:
+        {
+            int64_t v = 0;
+            r.Get(&v, sizeof(v));
+            store.push_back(v);
+            break;
+        }
+        case ARG_U64:
+        {
+            uint64_t v = 0;
+            r.Get(&v, sizeof(v));
+            store.push_back(v);
+            break;
+        }
+        case ARG_F64:
+        {
+            double v = 0;
+            r.Get(&v, sizeof(v));
+            store.push_back(v);
+            break;
+        }
+        case ARG_BOOL:
+        {
+            uint8_t v = 0;
+            r.Get(&v, sizeof(v));
+            store.push_back(v != 0);
+            break;
+        }
+        case ARG_CHAR:
+        {
+            char v = 0;
+            r.Get(&v, sizeof(v));
+            store.push_back(v);
+            break;
+        }
+        case ARG_STR:
+        {
+            std::string v;
+            if (!r.GetStr(v))
+            {
+                return false;
+            }
+            store.push_back(std::move(v));
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+    try
+    {
+        fmt::vformat_to(fmt::appender(out), info.format, store);
+    }
+    catch (const fmt::format_error &e)
+    {
+        fmt::format_to(fmt::appender(out), "<bad format \"{}\": {}>", info.format, e.what());
+    }
+    return true;
+}
+
+/* 还原整个二进制日志文件(tools/logdecode)：每一行连同'\n'交给sink(const char *, size_t)。
+   输出格式与文本日志一致；遇到截断的记录返回false，badOffset为它在文件中的偏移 */
+template <typename Sink>
+inline bool DecodeFile(const char *data, size_t len, Sink &&sink, size_t &badOffset)
+{
+    std::unordered_map<uint32_t, FormatInfo> formats;
+    fmt::memory_buffer out;
+    const char *p = data;
+    const char *end = data + len;
+    while (p < end)
+    {
+        /* 进程重启后同一个文件里会再出现文件头，之后的编号重新分配 */
+        if (static_cast<size_t>(end - p) >= sizeof(FILE_MAGIC) && memcmp(p, FILE_MAGIC, sizeof(FILE_MAGIC)) == 0)
+        {
+            formats.clear();
+            p += sizeof(FILE_MAGIC);
+            continue;
+        }
+        Header header;
+        if (static_cast<size_t>(end - p) < sizeof(header))
+        {
+            break;
+        }
+        memcpy(&header, p, sizeof(header));
+        if (header.size < sizeof(header) || header.size > static_cast<size_t>(end - p))
+        {
+            badOffset = static_cast<size_t>(p - data);
+            return false;
+        }
+        if (header.fmtId == DICT_ID)
+        {
+            uint32_t id = 0;
+            FormatInfo info;
+            if (DecodeDict(p, header.size, id, info))
+            {
+                formats[id] = std::move(info);
+            }
+        }
+        else
+        {
+            auto it = formats.find(header.fmtId);
+            out.clear();
+            out.append(WallClock::LogPrefix(header.timeNs));
+            if (it == formats.end())
+            {
+                fmt::format_to(fmt::appender(out), "<unknown format id {}>", header.fmtId);
+            }
+            else
+            {
+                out.append(fmt::string_view(LevelTitle(it->second.level)));
+                FormatMessage(p, header.size, it->second, out);
+            }
+            out.push_back('\n');
+            sink(out.data(), out.size());
+        }
+        p += header.size;
+    }
+    return true;
+}
+
+} // namespace logrecord
+
+#endif // LOGRECORD_H
@@ -1,15 +1,35 @@
+#include <stdio.h>
 #include <unistd.h>
 #include "server/webserver.h"
+#include "server/master.h"
 
-int main() {
+int main(int argc, char* argv[]) {
     /* 守护进程 后台运行 */
-    //daemon(1, 0); 
+    //daemon(1, 0);
 
-    WebServer server(
-        1316, 3, 60000, false,             /* 端口 ET模式 timeoutMs 优雅退出  */
-        3306, "root", "root", "webserver1", /* Mysql配置 */
-        12, 6, true, 1, 1024);             /* 连接池数量 线程池数量 日志开关 日志等级 日志异步队列容量 */
+    /* 默认值见 config/config.h，可由 ./webserver.conf、-c 指定的文件或 --key=value 覆盖 */
+    ServerConfig config;
+    std::string error;
+    bool help = false;
+    if (!ParseCommandLine(argc, argv, config, error, help)) {
+        if (help) {
+            fputs(ConfigUsage(argv[0]).c_str(), stdout);
+            return 0;
+        }
+        fprintf(stderr, "%s\n%s", error.c_str(), ConfigUsage(argv[0]).c_str());
+        return 1;
+    }
 
+    /* workers > 0：master绑定端口并fork出worker进程，见 server/master.h */
+    if (config.workers > 0) {
+        Master master(config, argc, argv);
+        return master.Run();
+    }
+
+    /* kill -HUP 重新读取配置；kill -USR2 启动新的可执行文件接管监听socket，本进程排空后退出
+       kill -TERM/Ctrl-C 停止accept，处理完已有请求后退出，再发一次立即退出 */
+    WebServer server(config);
+    server.SetCommandLine(argc, argv);
     server.Start();
-    return 0;} 
-  
\ No newline at end of file
+    return 0;
+}
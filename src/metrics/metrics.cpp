@@ -0,0 +1,179 @@
+#include "metrics.h"
+#include <assert.h>
+#include <fmt/format.h>
+using namespace std;
+
+size_t MetricShard()
+{
+    static atomic<size_t> next(0);
+    thread_local size_t shard = next++ % Counter::SHARDS;
+    return shard;
+}
+
+uint64_t Counter::Value() const
+{
+    uint64_t total = 0;
+    for (auto& cell : cells_) {
+        total += cell.value.load(memory_order_relaxed);
+    }
+    return total;
+}
+
+Histogram::Snapshot Histogram::Snap() const
+{
+    Snapshot snap;
+    snap.counts.assign(BUCKETS, 0);
+    for (size_t i = 0; i < SHARDS; i++) {
+        const Shard& shard = shards_[i];
+        for (size_t j = 0; j < BUCKETS; j++) {
+            snap.counts[j] += shard.counts[j].load(memory_order_relaxed);
+        }
+        snap.count += shard.count.load(memory_order_relaxed);
+        snap.sum += shard.sum.load(memory_order_relaxed);
+    }
+    return snap;
+}
+
+uint64_t Histogram::Snapshot::Percentile(double q) const
+{
+    uint64_t total = 0;
+    for (uint64_t c : counts) {
+        total += c;
+    }
+    if (total == 0) {
+        return 0;
+    }
+    /* 第rank个样本(从1开始)所在的桶 */
+    uint64_t rank = static_cast<uint64_t>(q * total + 0.5);
+    rank = rank < 1 ? 1 : (rank > total ? total : rank);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); i++) {
+        seen += counts[i];
+        if (seen >= rank) {
+            uint64_t lower = BucketLower(i);
+            uint64_t upper = i + 1 < BUCKETS ? BucketLower(i + 1) : UINT64_MAX;
+            return lower + (upper - lower) / 2;
+        }
+    }
+    return BucketLower(counts.size() - 1);
+}
+
+Metrics* Metrics::Instance()
+{
+    static Metrics metrics;
+    return &metrics;
+}
+
+Metrics::Entry* Metrics::Find_(const string& name, const string& labels)
+{
+    for (auto& entry : entries_) {
+        if (entry->name == name && entry->labels == labels) {
+            return entry.get();
+        }
+    }
+    return nullptr;
+}
+
+Counter* Metrics::NewCounter(const string& name, const string& help, const string& labels)
+{
+    lock_guard<mutex> locker(mtx_);
+    Entry* entry = Find_(name, labels);
+    if (!entry) {
+        entries_.emplace_back(new Entry{name, help, "counter", labels, make_unique<Counter>(), nullptr, nullptr});
+        entry = entries_.back().get();
+    }
+    assert(entry->counter);
+    return entry->counter.get();
+}
+
+Histogram* Metrics::NewHistogram(const string& name, const string& help, const string& labels)
+{
+    lock_guard<mutex> locker(mtx_);
+    Entry* entry = Find_(name, labels);
+    if (!entry) {
+        entries_.emplace_back(new Entry{name, help, "histogram", labels, nullptr, make_unique<Histogram>(), nullptr});
+        entry = entries_.back().get();
+    }
+    assert(entry->histogram);
+    return entry->histogram.get();
+}
+
+void Metrics::NewCallback(const string& name, const string& help, const char* type,
+                          function<double()> fn, const string& labels, const void* owner)
+{
+    lock_guard<mutex> locker(mtx_);
+    Entry* entry = Find_(name, labels);
+    if (!entry) {
+        entries_.emplace_back(new Entry{name, help, type, labels, nullptr, nullptr, nullptr});
+        entry = entries_.back().get();
+    }
+    assert(!entry->counter && !entry->histogram);
+    entry->fn = std::move(fn);
+    entry->owner = owner;
+}
+
+void Metrics::Unregister(const void* owner)
+{
+    assert(owner);
+    lock_guard<mutex> locker(mtx_);
+    for (auto it = entries_.begin(); it != entries_.end();) {
+        it = (*it)->fn && (*it)->owner == owner ? entries_.erase(it) : next(it);
+    }
+}
+
+/* 把le标签拼到已有标签后面 */
+static string WithLe(const string& labels, const string& le)
+{
+    return "{" + labels + (labels.empty() ? "" : ",") + "le=\"" + le + "\"}";
+}
+
+string Metrics::Prometheus()
+{
+    /* le桶边界：16us ~ 16.7s，都是2的幂，恰好落在Histogram的桶边界上 */
+    static const int LE_MIN_EXP = 4;
+    static const int LE_MAX_EXP = 24;
+
+    lock_guard<mutex> locker(mtx_);
+    fmt::memory_buffer out;
+    vector<bool> done(entries_.size(), false);
+    for (size_t i = 0; i < entries_.size(); i++) {
+        if (done[i]) {
+            continue;
+        }
+        const Entry& head = *entries_[i];
+        fmt::format_to(back_inserter(out), "# HELP {} {}\n# TYPE {} {}\n", head.name, head.help, head.name, head.type);
+        for (size_t j = i; j < entries_.size(); j++) {
+            const Entry& e = *entries_[j];
+            if (done[j] || e.name != head.name) {
+                continue;
+            }
+            done[j] = true;
+            string labels = e.labels.empty() ? "" : "{" + e.labels + "}";
+            if (e.counter) {
+                fmt::format_to(back_inserter(out), "{}{} {}\n", e.name, labels, e.counter->Value());
+            } else if (e.fn) {
+                fmt::format_to(back_inserter(out), "{}{} {}\n", e.name, labels, e.fn());
+            } else if (e.histogram) {
+                Histogram::Snapshot snap = e.histogram->Snap();
+                uint64_t cumulative = 0;
+                size_t bucket = 0;
+                for (int exp = LE_MIN_EXP; exp <= LE_MAX_EXP; exp++) {
+                    size_t end = Histogram::BucketIndex(1ull << exp);
+                    for (; bucket < end; bucket++) {
+                        cumulative += snap.counts[bucket];
+                    }
+                    fmt::format_to(back_inserter(out), "{}_bucket{} {}\n",
+                                   e.name, WithLe(e.labels, fmt::format("{}", (1ull << exp) / 1e6)), cumulative);
+                }
+                /* 分片是逐个读的，count用各桶之和，保证+Inf不小于前面的桶 */
+                for (; bucket < Histogram::BUCKETS; bucket++) {
+                    cumulative += snap.counts[bucket];
+                }
+                fmt::format_to(back_inserter(out), "{}_bucket{} {}\n", e.name, WithLe(e.labels, "+Inf"), cumulative);
+                fmt::format_to(back_inserter(out), "{}_sum{} {}\n", e.name, labels, snap.sum / 1e6);
+                fmt::format_to(back_inserter(out), "{}_count{} {}\n", e.name, labels, cumulative);
+            }
+        }
+    }
+    return fmt::to_string(out);
+}
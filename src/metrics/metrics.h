@@ -0,0 +1,129 @@
+#ifndef METRICS_H
+#define METRICS_H
+/*
+进程内运行指标，抓取时汇总，按Prometheus文本格式输出(/metrics)
+1. Counter：按线程分片的计数器。每个线程固定使用一个缓存行对齐的分片，
+   热路径上只有一次relaxed的fetch_add，线程之间不争抢同一缓存行
+2. Histogram：HDR风格的对数-线性分桶，[2^e, 2^(e+1)) 再均分为 2^SUB_BITS 个子桶，
+   相对误差不超过 1/2^SUB_BITS；同样按线程分片，抓取时合并
+   输出时在2的幂(微秒)边界上累加成Prometheus的le桶，边界与子桶对齐，没有插值误差
+3. 回调指标：连接数、队列长度等本来就有的状态量，抓取时调用回调读取
+指标在启动阶段注册，注册返回的指针在进程生命周期内有效；同名同标签重复注册返回同一个对象
+*/
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/* 当前线程使用的分片号，线程首次调用时按顺序分配 */
+size_t MetricShard();
+
+class Counter {
+public:
+    static constexpr size_t SHARDS = 16;
+
+    void Add(uint64_t n = 1) {
+        cells_[MetricShard()].value.fetch_add(n, std::memory_order_relaxed);
+    }
+    uint64_t Value() const;
+
+private:
+    struct alignas(64) Cell {
+        std::atomic<uint64_t> value{0};
+    };
+    Cell cells_[SHARDS];
+};
+
+class Histogram {
+public:
+    static constexpr size_t SHARDS = 16;
+    static constexpr int SUB_BITS = 3;
+    static constexpr size_t SUB_COUNT = 1 << SUB_BITS;
+    static constexpr size_t BUCKETS = (64 - SUB_BITS + 1) * SUB_COUNT;
+
+    /* 合并所有分片后的结果 */
+    struct Snapshot {
+        std::vector<uint64_t> counts;
+        uint64_t count = 0;
+        uint64_t sum = 0;
+        /* q取[0,1]，返回所在桶的中点；没有样本返回0 */
+        uint64_t Percentile(double q) const;
+    };
+
+    Histogram() : shards_(new Shard[SHARDS]) {}
+
+    /* value的单位由使用方决定，server里统一为微秒 */
+    void Observe(uint64_t value) {
+        Shard& shard = shards_[MetricShard()];
+        shard.counts[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+        shard.count.fetch_add(1, std::memory_order_relaxed);
+        shard.sum.fetch_add(value, std::memory_order_relaxed);
+    }
+    Snapshot Snap() const;
+
+    static size_t BucketIndex(uint64_t value) {
+        if (value < SUB_COUNT) {
+            return value;
+        }
+        int exp = 63 - __builtin_clzll(value);
+        size_t sub = (value >> (exp - SUB_BITS)) & (SUB_COUNT - 1);
+        return (exp - SUB_BITS + 1) * SUB_COUNT + sub;
+    }
+    /* 桶的取值范围 [BucketLower(i), BucketLower(i + 1)) */
+    static uint64_t BucketLower(size_t idx) {
+        if (idx < SUB_COUNT) {
+            return idx;
+        }
+        int exp = idx / SUB_COUNT + SUB_BITS - 1;
+        return (SUB_COUNT + idx % SUB_COUNT) << (exp - SUB_BITS);
+    }
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> counts[BUCKETS] = {};
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> sum{0};
+    };
+    std::unique_ptr<Shard[]> shards_;
+};
+
+class Metrics {
+public:
+    static Metrics* Instance();
+
+    /* labels形如 code="200",method="GET"，可为空 */
+    Counter* NewCounter(const std::string& name, const std::string& help, const std::string& labels = "");
+    /* 输出为 name_bucket/_sum/_count，观测值按微秒记录，输出时换算成秒 */
+    Histogram* NewHistogram(const std::string& name, const std::string& help, const std::string& labels = "");
+    /* 抓取时调用fn取值，type为"counter"或"gauge"；同名同标签再次注册会替换旧的回调
+       owner用于Unregister：回调捕获了对象指针时，对象析构前必须注销 */
+    void NewCallback(const std::string& name, const std::string& help, const char* type,
+                     std::function<double()> fn, const std::string& labels = "", const void* owner = nullptr);
+    void Unregister(const void* owner);
+
+    /* Prometheus文本格式(version 0.0.4)，同名指标归在一组HELP/TYPE下 */
+    std::string Prometheus();
+
+private:
+    Metrics() = default;
+
+    struct Entry {
+        std::string name;
+        std::string help;
+        std::string type;
+        std::string labels;
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Histogram> histogram;
+        std::function<double()> fn;
+        const void* owner = nullptr;
+    };
+    Entry* Find_(const std::string& name, const std::string& labels);
+
+    std::mutex mtx_;
+    std::vector<std::unique_ptr<Entry>> entries_;
+};
+
+#endif // METRICS_H
@@ -0,0 +1,42 @@
+#ifndef PROBES_H
+#define PROBES_H
+/*
+USDT(SystemTap/DTrace风格)静态探针，provider为webserver
+有<sys/sdt.h>(systemtap-sdt-dev)时编译成一条nop指令加ELF note，不挂载时没有额外开销；
+没有该头文件或定义了NO_USDT时为空宏，参数不求值
+列出探针：   bpftrace -l 'usdt:./main:webserver:*'
+例如统计SQL连接的持有时间：
+    bpftrace -e 'usdt:./main:webserver:sql_acquire { @t[arg0] = nsecs; }
+                 usdt:./main:webserver:sql_release /@t[arg0]/ { @hold = hist(nsecs - @t[arg0]); delete(@t[arg0]); }'
+
+探针                参数
+conn_accept         fd, ip(网络字节序)
+conn_close          fd
+request_parsed      fd, method, path
+response_ready      fd, status, bytes
+task_enqueue        pool                    提交线程上触发
+task_dequeue        pool                    工作线程取出任务、开始执行前
+task_done           pool                    与task_dequeue在同一线程，按tid配对即执行耗时
+sql_acquire         MYSQL*, wait_us         拿不到连接时MYSQL*为0
+sql_release         MYSQL*
+timer_fire          id(fd)
+*/
+
+#if !defined(NO_USDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define HAVE_USDT 1
+#endif
+#endif
+
+#ifdef HAVE_USDT
+#define USDT_PROBE1(name, a) DTRACE_PROBE1(webserver, name, a)
+#define USDT_PROBE2(name, a, b) DTRACE_PROBE2(webserver, name, a, b)
+#define USDT_PROBE3(name, a, b, c) DTRACE_PROBE3(webserver, name, a, b, c)
+#else
+#define USDT_PROBE1(name, a) do { (void)sizeof(a); } while (0)
+#define USDT_PROBE2(name, a, b) do { (void)sizeof(a); (void)sizeof(b); } while (0)
+#define USDT_PROBE3(name, a, b, c) do { (void)sizeof(a); (void)sizeof(b); (void)sizeof(c); } while (0)
+#endif
+
+#endif // PROBES_H
@@ -0,0 +1,109 @@
+#ifndef REQTRACE_H
+#define REQTRACE_H
+/*
+单个请求的阶段时间戳，用TSC记录，打点只是一次rdtsc，不做换算
+换算成微秒推迟到真正需要输出(慢请求日志)的时候，tick频率在首次使用时用steady_clock校准
+非x86平台退化为steady_clock的纳秒数
+*/
+#include <stdint.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+class Tsc {
+public:
+    static uint64_t Now() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    /* 首次调用会阻塞约10ms做校准，应在启动阶段先调用一次 */
+    static double TicksPerUs() {
+        static const double ticks = Calibrate_();
+        return ticks;
+    }
+
+    static double ToUs(uint64_t ticks) { return ticks / TicksPerUs(); }
+
+private:
+    static double Calibrate_() {
+#if defined(__x86_64__) || defined(__i386__)
+        auto t0 = std::chrono::steady_clock::now();
+        uint64_t c0 = Now();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        auto t1 = std::chrono::steady_clock::now();
+        uint64_t c1 = Now();
+        double us = std::chrono::duration<double, std::micro>(t1 - t0).count();
+        return us > 0 && c1 > c0 ? (c1 - c0) / us : 1000.0;
+#else
+        return 1000.0;
+#endif
+    }
+};
+
+/*
+一个请求从读到写完的各个阶段，值为0表示该阶段没有发生(例如没有挂起的请求就没有WORK_*)
+ACCEPT属于连接，keep-alive上的后续请求沿用；其余阶段在请求写完后由Next清零
+*/
+struct RequestTrace {
+    enum Stage {
+        ACCEPT = 0,
+        READ_QUEUED,    // Reactor把读事件交给io池
+        FIRST_READ,     // 读到请求的第一批字节
+        PARSED,
+        WORK_QUEUED,    // 挂起的处理交给cpu/db池
+        WORK_START,
+        WORK_DONE,
+        HANDLED,        // 响应就绪
+        WRITE_QUEUED,   // Reactor把写事件交给io池
+        FIRST_WRITE,
+        LAST_WRITE,
+        STAGE_COUNT,
+    };
+
+    uint64_t tsc[STAGE_COUNT];
+
+    RequestTrace() { Reset(); }
+
+    void Reset() { memset(tsc, 0, sizeof(tsc)); }
+    void Next() { memset(tsc + READ_QUEUED, 0, sizeof(tsc) - sizeof(tsc[0]) * READ_QUEUED); }
+
+    void Mark(Stage stage) { tsc[stage] = Tsc::Now(); }
+    void MarkOnce(Stage stage) {
+        if (tsc[stage] == 0) {
+            Mark(stage);
+        }
+    }
+
+    /* 请求开始的时刻：流水线上的后续请求没有读阶段，从解析完成算起 */
+    uint64_t Begin() const {
+        for (int s = READ_QUEUED; s <= PARSED; s++) {
+            if (tsc[s] != 0) {
+                return tsc[s];
+            }
+        }
+        return 0;
+    }
+
+    double TotalUs() const {
+        uint64_t begin = Begin();
+        return begin && tsc[LAST_WRITE] > begin ? Tsc::ToUs(tsc[LAST_WRITE] - begin) : 0;
+    }
+
+    static const char* StageName(int stage) {
+        static const char* NAMES[STAGE_COUNT] = {
+            "accept", "read_queued", "first_read", "parsed", "work_queued", "work_start",
+            "work_done", "handled", "write_queued", "first_write", "last_write",
+        };
+        return stage >= 0 && stage < STAGE_COUNT ? NAMES[stage] : "unknown";
+    }
+};
+
+#endif // REQTRACE_H
@@ -0,0 +1,88 @@
+#include "sharedstats.h"
+#include <sys/mman.h>
+#include <new>
+#include <fmt/format.h>
+using namespace std;
+
+const char* const SharedStats::FIELD_NAMES[STAT_COUNT] = {
+    "accepted_connections", "refused_connections", "responses", "received_bytes", "sent_bytes"
+};
+
+SharedStats* SharedStats::Create(int workers)
+{
+    if (workers <= 0) {
+        return nullptr;
+    }
+    size_t bytes = sizeof(SharedStats) + sizeof(WorkerStats) * workers;
+    void* mem = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        return nullptr;
+    }
+    /* 匿名映射已清零，atomic无需再初始化 */
+    SharedStats* stats = new (mem) SharedStats(workers);
+    stats->bytes_ = bytes;
+    for (int i = 0; i < workers; i++) {
+        new (&stats->Slots_()[i]) WorkerStats();
+    }
+    return stats;
+}
+
+void SharedStats::Destroy(SharedStats* stats)
+{
+    if (stats) {
+        munmap(stats, stats->bytes_);
+    }
+}
+
+void SharedStats::Retire(int id)
+{
+    WorkerStats& slot = Slot(id);
+    for (int i = 0; i < STAT_COUNT; i++) {
+        retired_.counters[i] += slot.counters[i].exchange(0);
+    }
+    slot.connections = 0;
+    slot.pid = 0;
+}
+
+uint64_t SharedStats::Total(StatField field) const
+{
+    uint64_t total = retired_.counters[field].load(memory_order_relaxed);
+    for (int i = 0; i < workers_; i++) {
+        total += Slots_()[i].counters[field].load(memory_order_relaxed);
+    }
+    return total;
+}
+
+int64_t SharedStats::Connections() const
+{
+    int64_t total = 0;
+    for (int i = 0; i < workers_; i++) {
+        total += Slots_()[i].connections.load(memory_order_relaxed);
+    }
+    return total;
+}
+
+uint64_t SharedStats::Restarts() const
+{
+    uint64_t total = 0;
+    for (int i = 0; i < workers_; i++) {
+        total += Slots_()[i].restarts.load(memory_order_relaxed);
+    }
+    return total;
+}
+
+int SharedStats::Alive() const
+{
+    int alive = 0;
+    for (int i = 0; i < workers_; i++) {
+        alive += Slots_()[i].pid.load(memory_order_relaxed) != 0;
+    }
+    return alive;
+}
+
+string SharedStats::Summary() const
+{
+    return fmt::format("workers {}/{}, restarts {}, connections {}, accepted {}, refused {}, responses {}, in {}B, out {}B",
+                       Alive(), workers_, Restarts(), Connections(), Total(STAT_ACCEPTED), Total(STAT_REFUSED),
+                       Total(STAT_RESPONSES), Total(STAT_BYTES_IN), Total(STAT_BYTES_OUT));
+}
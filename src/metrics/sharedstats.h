@@ -0,0 +1,65 @@
+#ifndef SHAREDSTATS_H
+#define SHAREDSTATS_H
+/*
+prefork模式下各worker进程的计数，放在master于fork之前创建的匿名共享内存(MAP_SHARED)里
+1. 每个worker独占一个缓存行对齐的槽位，只有它自己写，master和其他worker只读
+2. worker在事件循环里每隔PUBLISH_INTERVAL_MS把进程内Metrics的计数拷贝进槽位，请求处理的热路径不变
+3. 槽位按worker编号固定；worker退出后master把它的计数并入retired再清零，重启的worker从0开始，总数不回退
+std::atomic的64位整数是lock-free的，跨进程读写与线程间一样安全
+*/
+#include <stdint.h>
+#include <sys/types.h>
+#include <atomic>
+#include <string>
+
+enum StatField {
+    STAT_ACCEPTED,
+    STAT_REFUSED,
+    STAT_RESPONSES,
+    STAT_BYTES_IN,
+    STAT_BYTES_OUT,
+    STAT_COUNT
+};
+
+struct alignas(64) WorkerStats {
+    std::atomic<int32_t> pid;           // 0为当前没有进程
+    std::atomic<uint64_t> restarts;     // 不含第一次启动
+    std::atomic<int64_t> connections;
+    std::atomic<uint64_t> counters[STAT_COUNT];
+};
+
+class alignas(64) SharedStats {
+public:
+    static const int PUBLISH_INTERVAL_MS = 1000;
+    /* 指标名中的部分，如 webserver_cluster_accepted_connections_total */
+    static const char* const FIELD_NAMES[STAT_COUNT];
+
+    /* 须在fork之前调用，失败返回nullptr */
+    static SharedStats* Create(int workers);
+    static void Destroy(SharedStats* stats);
+
+    int Workers() const { return workers_; }
+    WorkerStats& Slot(int id) { return Slots_()[id]; }
+
+    /* worker进程已回收后由master调用 */
+    void Retire(int id);
+
+    /* 所有worker加上已退出的部分 */
+    uint64_t Total(StatField field) const;
+    int64_t Connections() const;
+    uint64_t Restarts() const;
+    int Alive() const;
+    /* 一行汇总，master定期输出 */
+    std::string Summary() const;
+
+private:
+    explicit SharedStats(int workers) : workers_(workers) {}
+    WorkerStats* Slots_() { return reinterpret_cast<WorkerStats*>(this + 1); }
+    const WorkerStats* Slots_() const { return reinterpret_cast<const WorkerStats*>(this + 1); }
+
+    int workers_;
+    size_t bytes_;
+    WorkerStats retired_;
+};
+
+#endif // SHAREDSTATS_H
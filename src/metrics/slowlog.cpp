@@ -0,0 +1,134 @@
+#include "slowlog.h"
+#include <string.h>
+#include <sys/stat.h> // mkdir
+#include <algorithm>
+#include "../timer/wallclock.h"
+using namespace std;
+
+SlowLog::SlowLog(const string& path, int thresholdMs, size_t capacity)
+    : path_(path), file_(nullptr), thresholdMs_(thresholdMs), thresholdUs_(thresholdMs * 1000.0),
+      queue_(capacity), dropped_(0), notified_(false), isClose_(false)
+{
+    if (thresholdMs_ <= 0) {
+        return;
+    }
+    file_ = fopen(path_.c_str(), "a");
+    if (!file_) {
+        size_t slash = path_.find_last_of('/');
+        if (slash != string::npos) {
+            mkdir(path_.substr(0, slash).c_str(), 0777);
+            file_ = fopen(path_.c_str(), "a");
+        }
+    }
+    if (file_) {
+        /* 校准放在启动阶段，不让第一个慢请求等10ms */
+        Tsc::TicksPerUs();
+        writeThread_ = make_unique<thread>([this] { AsyncWrite_(); });
+    }
+}
+
+SlowLog::~SlowLog()
+{
+    if (writeThread_) {
+        {
+            lock_guard<mutex> locker(mtx_);
+            isClose_ = true;
+        }
+        cond_.notify_one();
+        writeThread_->join();
+    }
+    if (file_) {
+        fclose(file_);
+    }
+}
+
+bool SlowLog::Check(const RequestTrace& trace, const sockaddr_in& addr, const string& method,
+                    const string& path, int status, size_t bytes)
+{
+    if (!file_ || trace.TotalUs() < thresholdUs_) {
+        return false;
+    }
+    Record rec;
+    rec.timeNs = WallClock::NowNs();
+    rec.ip = addr.sin_addr.s_addr;
+    rec.port = addr.sin_port;
+    rec.status = static_cast<uint16_t>(status);
+    rec.bytes = bytes;
+    size_t n = min(method.size(), sizeof(rec.method) - 1);
+    memcpy(rec.method, method.data(), n);
+    rec.method[n] = '\0';
+    n = min(path.size(), sizeof(rec.path) - 1);
+    memcpy(rec.path, path.data(), n);
+    rec.path[n] = '\0';
+    memcpy(rec.tsc, trace.tsc, sizeof(rec.tsc));
+    if (!queue_.TryPush(rec)) {
+        dropped_++;
+        return false;
+    }
+    /* 慢请求本来就少，每条都唤醒写线程 */
+    if (!notified_.exchange(true)) {
+        cond_.notify_one();
+    }
+    return true;
+}
+
+static void AppendUs(fmt::memory_buffer& out, double us)
+{
+    if (us >= 1000) {
+        fmt::format_to(fmt::appender(out), "{:.1f}ms", us / 1000);
+    } else {
+        fmt::format_to(fmt::appender(out), "{:.0f}us", us);
+    }
+}
+
+void SlowLog::Format_(fmt::memory_buffer& out, const Record& rec)
+{
+    RequestTrace trace;
+    memcpy(trace.tsc, rec.tsc, sizeof(trace.tsc));
+    out.append(WallClock::LogPrefix(rec.timeNs));
+    fmt::format_to(fmt::appender(out), "{}.{}.{}.{}:{} {} {} {} {}B total=",
+                   rec.ip & 0xFF, (rec.ip >> 8) & 0xFF, (rec.ip >> 16) & 0xFF, (rec.ip >> 24) & 0xFF,
+                   ntohs(rec.port), rec.method, rec.path, rec.status, rec.bytes);
+    AppendUs(out, trace.TotalUs());
+    uint64_t begin = trace.Begin();
+    if (trace.tsc[RequestTrace::ACCEPT] && begin > trace.tsc[RequestTrace::ACCEPT]) {
+        out.append(fmt::string_view(" conn_age="));
+        AppendUs(out, Tsc::ToUs(begin - trace.tsc[RequestTrace::ACCEPT]));
+    }
+    /* 相邻两个已发生阶段之间的耗时 */
+    uint64_t prev = begin;
+    for (int s = RequestTrace::READ_QUEUED; s < RequestTrace::STAGE_COUNT; s++) {
+        if (rec.tsc[s] == 0 || rec.tsc[s] < begin) {
+            continue;
+        }
+        fmt::format_to(fmt::appender(out), " {}+", RequestTrace::StageName(s));
+        AppendUs(out, Tsc::ToUs(rec.tsc[s] - prev));
+        prev = rec.tsc[s];
+    }
+    out.push_back('\n');
+}
+
+void SlowLog::AsyncWrite_()
+{
+    fmt::memory_buffer batch;
+    while (true) {
+        {
+            unique_lock<mutex> locker(mtx_);
+            cond_.wait_for(locker, chrono::seconds(1), [this] { return notified_ || isClose_; });
+        }
+        notified_ = false;
+        bool closing = isClose_;
+        Record rec;
+        while (queue_.TryPop(rec)) {
+            Format_(batch, rec);
+        }
+        if (batch.size() > 0) {
+            fwrite(batch.data(), 1, batch.size(), file_);
+            fflush(file_);
+            batch.clear();
+        }
+        if (closing) {
+            return;
+        }
+    }
+}
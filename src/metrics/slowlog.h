@@ -0,0 +1,65 @@
+#ifndef SLOWLOG_H
+#define SLOWLOG_H
+/*
+慢请求日志：总耗时超过阈值的请求把完整的阶段时间戳写到单独的文件里
+每行按阶段顺序给出相邻两个阶段之间的耗时，一眼能看出时间花在了
+io池排队(read_queued->first_read)、cpu/db池排队(work_queued->work_start)、
+数据库或计算(work_start->work_done)还是写socket(first_write->last_write)上
+记录压入无锁队列，由后台线程格式化和写文件，队列满时丢弃并计数
+*/
+#include <stdint.h>
+#include <netinet/in.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <fmt/format.h>
+#include "reqtrace.h"
+#include "../log/lockfreeQueue.h"
+
+class SlowLog {
+public:
+    /* thresholdMs <= 0 表示关闭 */
+    SlowLog(const std::string& path, int thresholdMs, size_t capacity = 1024);
+    ~SlowLog();
+
+    /* 请求写完后调用；超过阈值并成功入队返回true */
+    bool Check(const RequestTrace& trace, const sockaddr_in& addr, const std::string& method,
+               const std::string& path, int status, size_t bytes);
+
+    int ThresholdMs() const { return thresholdMs_; }
+    size_t Dropped() const { return dropped_; }
+
+private:
+    struct Record {
+        int64_t timeNs;
+        uint32_t ip;        // 网络字节序
+        uint16_t port;      // 网络字节序
+        uint16_t status;
+        uint64_t bytes;
+        char method[8];
+        char path[96];
+        uint64_t tsc[RequestTrace::STAGE_COUNT];
+    };
+
+    void AsyncWrite_();
+    static void Format_(fmt::memory_buffer& out, const Record& rec);
+
+    std::string path_;
+    FILE* file_;
+    const int thresholdMs_;
+    double thresholdUs_;
+
+    LockFreeQueue<Record> queue_;
+    std::atomic<size_t> dropped_;
+    std::atomic<bool> notified_;
+    std::atomic<bool> isClose_;
+    std::mutex mtx_;
+    std::condition_variable cond_;
+    std::unique_ptr<std::thread> writeThread_;
+};
+
+#endif // SLOWLOG_H
@@ -0,0 +1,65 @@
+#ifndef EXECUTORS_H
+#define EXECUTORS_H
+/*
+按名字区分的线程池集合，不同性质的任务互不排队
+    io  ：读写socket、解析请求、发送静态文件
+    cpu ：计算密集的处理(密码哈希等)，线程数不超过核数
+    db  ：会阻塞在数据库上的任务，线程数与连接池上限相当
+每个池有自己的线程数和队列上限，队列满时TryCommit立即失败，不会把压力传回io线程
+*/
+#include <chrono>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "threadpool.h"
+
+class Executors {
+public:
+    Executors() = default;
+    ~Executors() {
+        /* 后加入的池先停，与创建顺序相反 */
+        while (!pools_.empty()) {
+            pools_.pop_back();
+        }
+    }
+
+    ThreadPool* Add(const std::string& name, size_t threadNum, size_t queCapacity) {
+        pools_.emplace_back(std::make_unique<ThreadPool>(threadNum, queCapacity, name));
+        return pools_.back().get();
+    }
+
+    /* 没有该名字的池返回nullptr */
+    ThreadPool* Get(const std::string& name) const {
+        for (auto& pool : pools_) {
+            if (pool->Name() == name) {
+                return pool.get();
+            }
+        }
+        return nullptr;
+    }
+
+    /* 按创建顺序等待各池空闲(io上的任务可能再提交到cpu/db)，总时长不超过timeoutMs */
+    bool WaitIdle(int timeoutMs) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+        for (auto& pool : pools_) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now()).count();
+            if (!pool->WaitIdle(left > 0 ? int(left) : 0)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void StartAll() {
+        for (auto& pool : pools_) {
+            pool->start();
+        }
+    }
+
+private:
+    std::vector<std::unique_ptr<ThreadPool>> pools_;
+};
+
+#endif // EXECUTORS_H
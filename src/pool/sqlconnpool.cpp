@@ -1,65 +1,469 @@
 #include "sqlconnpool.h"
+#include <mysql/errmsg.h>
+#include <mysql/mysqld_error.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#undef LOG_MODULE
+#define LOG_MODULE LOG_MOD_POOL
+
 using namespace std;
 
+const char *SqlConnPool::STMT_SQL[STMT_COUNT] = {
+    "SELECT password FROM user WHERE username = ? LIMIT 1",
+    "INSERT INTO user(username, password) VALUES(?, ?)",
+};
+
 SqlConnPool *SqlConnPool::Instance()
 {
     static SqlConnPool connPool;
     return &connPool;
 }
 
+SqlConnPool::SqlConnPool()
+    : port_(0), minConn_(0), maxConn_(0), acquireTimeoutMs_(500), healthIntervalMs_(5000),
+      total_(0), isClose_(true), downUntilUs_(0), pingAll_(false), peakInUse_(0),
+      acquires_(0), waits_(0), timeouts_(0), waitUsTotal_(0), waitUsMax_(0),
+      reconnects_(0), connectFailures_(0),
+      waitHist_(Metrics::Instance()->NewHistogram("sqlpool_acquire_wait_seconds",
+                                                  "Time spent acquiring a MySQL connection from the pool"))
+{
+}
+
+int64_t SqlConnPool::NowUs_()
+{
+    return chrono::duration_cast<chrono::microseconds>(
+        chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
 void SqlConnPool::Init(const char *host, int port,
                        const char *user, const char *pwd, const char *dbName,
-                       int connSize = 10)
+                       int connSize, int maxConn, int acquireTimeoutMs, int healthIntervalMs)
 {
     assert(connSize > 0);
+    host_ = host;
+    port_ = port;
+    user_ = user;
+    pwd_ = pwd;
+    dbName_ = dbName;
+    minConn_ = connSize;
+    maxConn_ = max(maxConn, connSize);
+    acquireTimeoutMs_ = acquireTimeoutMs;
+    healthIntervalMs_ = max(healthIntervalMs, 100);
+    {
+        lock_guard<mutex> locker(mtx_);
+        isClose_ = false;
+        pingAll_ = false;
+    }
+    /* 建不起来的连接不再放入池中，由健康检查线程稍后补足 */
     for (int i = 0; i < connSize; i++)
     {
-        MYSQL *sql = nullptr;
-        sql = mysql_init(sql);
-        if (!sql)
-        {
-            LOG_ERROR("MySql init error!");
-            assert(sql);
-        }
-        sql = mysql_real_connect(sql, host,
-                                 user, pwd,
-                                 dbName, port, nullptr, 0);
+        MYSQL *sql = Connect_();
         if (!sql)
         {
-            LOG_ERROR("MySql Connect error:{} ", mysql_error(sql));
+            break;
         }
-        connQue_.push_back(sql);
+        lock_guard<mutex> locker(mtx_);
+        total_++;
+        idle_.push_back({sql, NowUs_()});
+    }
+    LOG_INFO("SqlConnPool: {} connections established, min {}, max {}", total_, minConn_, maxConn_);
+    healthThread_ = thread(&SqlConnPool::HealthCheck_, this);
+}
+
+MYSQL *SqlConnPool::Connect_()
+{
+    MYSQL *sql = mysql_init(nullptr);
+    if (!sql)
+    {
+        LOG_ERROR("MySql init error!");
+        return nullptr;
+    }
+    unsigned int connectTimeout = CONNECT_TIMEOUT_SEC;
+    unsigned int ioTimeout = IO_TIMEOUT_SEC;
+    mysql_options(sql, MYSQL_OPT_CONNECT_TIMEOUT, &connectTimeout);
+    mysql_options(sql, MYSQL_OPT_READ_TIMEOUT, &ioTimeout);
+    mysql_options(sql, MYSQL_OPT_WRITE_TIMEOUT, &ioTimeout);
+    if (!mysql_real_connect(sql, host_.c_str(), user_.c_str(), pwd_.c_str(),
+                            dbName_.c_str(), port_, nullptr, 0))
+    {
+        LOG_ERROR("MySql Connect error:{} ", mysql_error(sql));
+        mysql_close(sql);
+        lock_guard<mutex> locker(mtx_);
+        connectFailures_++;
+        downUntilUs_ = NowUs_() + RETRY_BACKOFF_MS * 1000;
+        return nullptr;
+    }
+    {
+        lock_guard<mutex> locker(cacheMtx_);
+        stmtCache_[sql] = StmtCache();
+    }
+    lock_guard<mutex> locker(mtx_);
+    downUntilUs_ = 0;
+    return sql;
+}
+
+void SqlConnPool::Destroy_(MYSQL *sql)
+{
+    InvalidateStmts(sql);
+    {
+        lock_guard<mutex> locker(cacheMtx_);
+        stmtCache_.erase(sql);
+    }
+    mysql_close(sql);
+}
+
+bool SqlConnPool::MarkBroken_(MYSQL *sql, unsigned int err)
+{
+    if (err != CR_SERVER_GONE_ERROR && err != CR_SERVER_LOST)
+    {
+        return false;
     }
-    MAX_CONN_ = connSize;
+    StmtCache *cache = Cache_(sql);
+    if (cache)
+    {
+        cache->broken = true;
+    }
+    return true;
 }
 
-MYSQL *SqlConnPool::GetConn()
+bool SqlConnPool::IsBroken_(MYSQL *sql)
 {
-    MYSQL *sql = nullptr;
-    connQue_.pop(sql);
+    lock_guard<mutex> locker(cacheMtx_);
+    auto it = stmtCache_.find(sql);
+    return it != stmtCache_.end() && it->second.broken;
+}
+
+MYSQL *SqlConnPool::GetConn(int timeoutMs)
+{
+    int64_t start = NowUs_();
+    MYSQL *sql = Acquire_(timeoutMs < 0 ? acquireTimeoutMs_ : timeoutMs);
+    uint64_t waited = NowUs_() - start;
+    waitHist_->Observe(waited);
+    USDT_PROBE2(sql_acquire, sql, waited);
+    return sql;
+}
+
+MYSQL *SqlConnPool::TryGetConn()
+{
+    MYSQL *sql = Acquire_(0);
+    USDT_PROBE2(sql_acquire, sql, 0);
+    return sql;
+}
+
+MYSQL *SqlConnPool::Acquire_(int timeoutMs)
+{
+    unique_lock<mutex> locker(mtx_);
+    if (isClose_)
+    {
+        return nullptr;
+    }
+    acquires_++;
+    bool dbDown = NowUs_() < downUntilUs_;
+    if (idle_.empty() && total_ < maxConn_ && !dbDown)
+    {
+        /* 先占位再在锁外建连，避免并发扩容超过上限 */
+        total_++;
+        locker.unlock();
+        MYSQL *sql = Connect_();
+        locker.lock();
+        if (sql)
+        {
+            peakInUse_ = max(peakInUse_, total_ - static_cast<int>(idle_.size()));
+            return sql;
+        }
+        total_--;
+        dbDown = true;
+    }
+    if (idle_.empty())
+    {
+        /* 数据库不可用且池中一个连接都没有，等待不会有结果 */
+        if (timeoutMs == 0 || (dbDown && total_ == 0))
+        {
+            timeouts_++;
+            return nullptr;
+        }
+        int64_t start = NowUs_();
+        bool ok = cond_.wait_for(locker, chrono::milliseconds(timeoutMs),
+                                 [this] { return !idle_.empty() || isClose_; });
+        uint64_t waited = NowUs_() - start;
+        waits_++;
+        waitUsTotal_ += waited;
+        waitUsMax_ = max(waitUsMax_, waited);
+        if (!ok || isClose_)
+        {
+            timeouts_++;
+            LOG_WARN("Acquire MySQL connection timeout after {}ms, inUse {}", timeoutMs, total_ - idle_.size());
+            return nullptr;
+        }
+    }
+    /* 后进先出：常用的连接保持热，多余的连接会在队头空闲下来被回收 */
+    MYSQL *sql = idle_.back().sql;
+    idle_.pop_back();
+    peakInUse_ = max(peakInUse_, total_ - static_cast<int>(idle_.size()));
     return sql;
 }
 
 void SqlConnPool::FreeConn(MYSQL *sql)
 {
     assert(sql);
-    connQue_.push_back(sql);
+    USDT_PROBE1(sql_release, sql);
+    unique_lock<mutex> locker(mtx_);
+    if (isClose_)
+    {
+        total_--;
+        locker.unlock();
+        Destroy_(sql);
+        return;
+    }
+    if (IsBroken_(sql))
+    {
+        /* 死连接不再放回池中，锁外关闭并建一个新的顶上 */
+        bool dbDown = NowUs_() < downUntilUs_;
+        locker.unlock();
+        LOG_WARN("MySQL connection lost, replacing it");
+        Destroy_(sql);
+        sql = dbDown ? nullptr : Connect_();
+        locker.lock();
+        /* 数据库重启时其余空闲连接多半也断了，让健康检查线程马上挨个ping */
+        pingAll_ = true;
+        healthCond_.notify_one();
+        if (!sql)
+        {
+            total_--;
+            return;
+        }
+        reconnects_++;
+        if (isClose_)
+        {
+            total_--;
+            locker.unlock();
+            Destroy_(sql);
+            return;
+        }
+    }
+    idle_.push_back({sql, NowUs_()});
+    locker.unlock();
+    cond_.notify_one();
+}
+
+void SqlConnPool::HealthCheck_()
+{
+    unique_lock<mutex> locker(mtx_);
+    while (true)
+    {
+        healthCond_.wait_for(locker, chrono::milliseconds(healthIntervalMs_), [this] { return isClose_ || pingAll_; });
+        if (isClose_)
+        {
+            return;
+        }
+        /* 队头是最久没用过的连接；刚用过的连接不必ping，除非刚发现过断连 */
+        int64_t now = NowUs_();
+        bool pingAll = pingAll_;
+        pingAll_ = false;
+        vector<IdleConn> check;
+        while (!idle_.empty() && (pingAll || now - idle_.front().lastUsedUs >= healthIntervalMs_ * 1000LL))
+        {
+            check.push_back(idle_.front());
+            idle_.pop_front();
+        }
+        int total = total_;
+        locker.unlock();
+
+        vector<IdleConn> alive;
+        int closed = 0;
+        for (IdleConn &conn : check)
+        {
+            if (now - conn.lastUsedUs >= IDLE_TIMEOUT_MS * 1000LL && total - closed > minConn_)
+            {
+                Destroy_(conn.sql);
+                closed++;
+                continue;
+            }
+            if (mysql_ping(conn.sql) == 0)
+            {
+                alive.push_back(conn);
+                continue;
+            }
+            LOG_WARN("MySQL connection lost:{}, reconnecting", mysql_error(conn.sql));
+            Destroy_(conn.sql);
+            MYSQL *sql = Connect_();
+            if (sql)
+            {
+                alive.push_back({sql, NowUs_()});
+                lock_guard<mutex> guard(mtx_);
+                reconnects_++;
+            }
+            else
+            {
+                closed++;
+            }
+        }
+
+        locker.lock();
+        total_ -= closed;
+        idle_.insert(idle_.begin(), alive.begin(), alive.end());
+        /* 补足到最小连接数 */
+        while (!isClose_ && total_ < minConn_)
+        {
+            total_++;
+            locker.unlock();
+            MYSQL *sql = Connect_();
+            locker.lock();
+            if (!sql)
+            {
+                total_--;
+                break;
+            }
+            idle_.push_back({sql, NowUs_()});
+        }
+        if (!idle_.empty())
+        {
+            cond_.notify_all();
+        }
+        LOG_DEBUG("SqlConnPool total:{} idle:{} acquires:{} waits:{} timeouts:{} reconnects:{}",
+                  total_, idle_.size(), acquires_, waits_, timeouts_, reconnects_);
+    }
+}
+
+SqlConnPool::Stats SqlConnPool::GetStats()
+{
+    lock_guard<mutex> locker(mtx_);
+    Stats stats;
+    stats.total = total_;
+    stats.idle = static_cast<int>(idle_.size());
+    stats.inUse = total_ - stats.idle;
+    stats.peakInUse = peakInUse_;
+    stats.minConn = minConn_;
+    stats.maxConn = maxConn_;
+    stats.acquires = acquires_;
+    stats.waits = waits_;
+    stats.timeouts = timeouts_;
+    stats.waitUsTotal = waitUsTotal_;
+    stats.waitUsMax = waitUsMax_;
+    stats.reconnects = reconnects_;
+    stats.connectFailures = connectFailures_;
+    peakInUse_ = stats.inUse;
+    return stats;
+}
+
+SqlConnPool::StmtCache *SqlConnPool::Cache_(MYSQL *sql)
+{
+    lock_guard<mutex> locker(cacheMtx_);
+    auto it = stmtCache_.find(sql);
+    return it == stmtCache_.end() ? nullptr : &it->second;
+}
+
+MYSQL_STMT *SqlConnPool::GetStmt(MYSQL *sql, SqlStmt id)
+{
+    assert(sql && id < STMT_COUNT);
+    StmtCache *cache = Cache_(sql);
+    if (!cache)
+    {
+        return nullptr;
+    }
+    if (cache->stmts[id])
+    {
+        return cache->stmts[id];
+    }
+    MYSQL_STMT *stmt = mysql_stmt_init(sql);
+    if (!stmt)
+    {
+        LOG_ERROR("mysql_stmt_init error:{}", mysql_error(sql));
+        return nullptr;
+    }
+    if (mysql_stmt_prepare(stmt, STMT_SQL[id], strlen(STMT_SQL[id])))
+    {
+        LOG_ERROR("Prepare [{}] error:{}", STMT_SQL[id], mysql_stmt_error(stmt));
+        MarkBroken_(sql, mysql_stmt_errno(stmt));
+        mysql_stmt_close(stmt);
+        return nullptr;
+    }
+    LOG_DEBUG("Prepared [{}] on connection {}", STMT_SQL[id], mysql_thread_id(sql));
+    cache->stmts[id] = stmt;
+    return stmt;
+}
+
+MYSQL_STMT *SqlConnPool::Execute(MYSQL *sql, SqlStmt id, MYSQL_BIND *params)
+{
+    for (int attempt = 0; attempt < 2; attempt++)
+    {
+        MYSQL_STMT *stmt = GetStmt(sql, id);
+        if (!stmt)
+        {
+            return nullptr;
+        }
+        if (!mysql_stmt_bind_param(stmt, params) && !mysql_stmt_execute(stmt))
+        {
+            return stmt;
+        }
+        unsigned int err = mysql_stmt_errno(stmt);
+        LOG_WARN("Execute [{}] error {}:{}", STMT_SQL[id], err, mysql_stmt_error(stmt));
+        if (MarkBroken_(sql, err))
+        {
+            /* 在同一个死连接上重试没有意义，归还时换新连接 */
+            return nullptr;
+        }
+        if (err != ER_UNKNOWN_STMT_HANDLER && err != ER_NEED_REPREPARE)
+        {
+            return nullptr;
+        }
+        InvalidateStmts(sql);
+    }
+    return nullptr;
+}
+
+void SqlConnPool::InvalidateStmts(MYSQL *sql)
+{
+    StmtCache *cache = Cache_(sql);
+    if (!cache)
+    {
+        return;
+    }
+    for (MYSQL_STMT *&stmt : cache->stmts)
+    {
+        if (stmt)
+        {
+            mysql_stmt_close(stmt);
+            stmt = nullptr;
+        }
+    }
 }
 
 void SqlConnPool::ClosePool()
 {
-    while (!connQue_.empty())
+    deque<IdleConn> idle;
     {
-        auto sql = GetConn();
-        mysql_close(sql);
+        lock_guard<mutex> locker(mtx_);
+        if (isClose_)
+        {
+            return;
+        }
+        isClose_ = true;
+        idle.swap(idle_);
+        total_ -= static_cast<int>(idle.size());
+    }
+    healthCond_.notify_all();
+    cond_.notify_all();
+    if (healthThread_.joinable())
+    {
+        healthThread_.join();
+    }
+    /* 正在使用的连接在FreeConn时关闭 */
+    for (IdleConn &conn : idle)
+    {
+        Destroy_(conn.sql);
     }
-    connQue_.Close();
     mysql_library_end();
 }
 
 int SqlConnPool::GetFreeConnCount()
 {
-    return connQue_.size();
+    lock_guard<mutex> locker(mtx_);
+    return static_cast<int>(idle_.size());
 }
 
 SqlConnPool::~SqlConnPool()
@@ -1,34 +1,140 @@
- #ifndef SQLCONNPOOL_H
+#ifndef SQLCONNPOOL_H
 #define SQLCONNPOOL_H
 
 #include <mysql/mysql.h>
 #include <string>
-#include <queue>
+#include <deque>
 #include <mutex>
-#include <semaphore.h>
+#include <condition_variable>
 #include <thread>
+#include <unordered_map>
 #include "../log/log.h"
-#include "../log/blockQueue.h"
+#include "../metrics/metrics.h"
+#include "../metrics/probes.h"
+
+/* 预编译语句编号，SQL文本见 sqlconnpool.cpp 中的 STMT_SQL */
+enum SqlStmt {
+    STMT_USER_SELECT = 0,   // SELECT password FROM user WHERE username = ?
+    STMT_USER_INSERT,       // INSERT INTO user(username, password) VALUES(?, ?)
+    STMT_COUNT,
+};
+
+/*
+MySQL连接池
+1. 连接数在 [minConn, maxConn] 之间伸缩：没有空闲连接且未达上限时当场新建，
+   空闲超过 IDLE_TIMEOUT_MS 的多余连接由健康检查线程关闭
+2. 获取连接最多等待 acquireTimeoutMs，超时返回nullptr；数据库不可用(一个连接都建不起来)时立即失败
+3. 健康检查线程定期ping空闲连接，失败的连接关闭后重连，并把连接数补足到minConn
+4. 执行中遇到连接断开(CR_SERVER_LOST/CR_SERVER_GONE_ERROR)的连接被标记为broken，
+   FreeConn归还时直接关闭并新建一个补上，同时让健康检查线程立即ping其余空闲连接(数据库重启时它们大概率也断了)
+   重连得到的是新的MYSQL句柄，预编译语句缓存随之重建
+*/
 class SqlConnPool {
 public:
+    struct Stats {
+        int total;              // 已建立的连接数
+        int idle;
+        int inUse;
+        int peakInUse;          // 上次GetStats以来的峰值
+        int minConn;
+        int maxConn;
+        uint64_t acquires;
+        uint64_t waits;         // 需要等待的获取次数
+        uint64_t timeouts;
+        uint64_t waitUsTotal;   // 等待耗时之和(微秒)
+        uint64_t waitUsMax;
+        uint64_t reconnects;
+        uint64_t connectFailures;
+    };
+
     static SqlConnPool *Instance();
 
-    MYSQL *GetConn();
+    /* timeoutMs < 0 时使用Init中设置的默认超时；拿不到连接返回nullptr */
+    MYSQL *GetConn(int timeoutMs = -1);
+    /* 不等待：没有空闲连接且不能扩容时立即返回nullptr */
+    MYSQL *TryGetConn();
     void FreeConn(MYSQL * conn);
     int GetFreeConnCount();
+    Stats GetStats();
 
+    /* connSize为最小连接数；maxConn为0时取connSize */
     void Init(const char* host, int port,
-              const char* user,const char* pwd, 
-              const char* dbName, int connSize);
+              const char* user,const char* pwd,
+              const char* dbName, int connSize,
+              int maxConn = 0, int acquireTimeoutMs = 500, int healthIntervalMs = 5000);
     void ClosePool();
 
+    /*
+    每个连接各自缓存一份预编译语句，首次使用时prepare
+    缓存跟着MYSQL句柄走：重连时旧句柄连同缓存一起销毁，新句柄从空缓存开始
+    调用方必须持有该连接(GetConn之后、FreeConn之前)，因此缓存条目本身无需加锁
+    */
+    MYSQL_STMT *GetStmt(MYSQL *sql, SqlStmt id);
+    /*
+    绑定参数并执行，失败返回nullptr
+    语句句柄失效(ER_UNKNOWN_STMT_HANDLER/ER_NEED_REPREPARE)时在同一连接上重新prepare并重试一次；
+    连接断开时不在死连接上重试，只标记broken，由FreeConn换新连接
+    */
+    MYSQL_STMT *Execute(MYSQL *sql, SqlStmt id, MYSQL_BIND *params);
+    void InvalidateStmts(MYSQL *sql);
+
 private:
+    SqlConnPool();
     ~SqlConnPool();
 
-    int MAX_CONN_;
+    struct StmtCache {
+        bool broken = false;    // 连接已断开，归还时关闭重连
+        MYSQL_STMT *stmts[STMT_COUNT] = {};
+    };
+    struct IdleConn {
+        MYSQL *sql;
+        int64_t lastUsedUs;
+    };
+    static const char *STMT_SQL[STMT_COUNT];
+    static const int CONNECT_TIMEOUT_SEC = 2;
+    static const int IO_TIMEOUT_SEC = 5;       // 单条查询的读写超时，慢库不会无限拖住DB线程
+    static const int IDLE_TIMEOUT_MS = 60000;
+    static const int RETRY_BACKOFF_MS = 1000;  // 建连失败后，这段时间内获取连接不再当场重试
+
+    MYSQL *Acquire_(int timeoutMs);
+    MYSQL *Connect_();
+    void Destroy_(MYSQL *sql);
+    bool MarkBroken_(MYSQL *sql, unsigned int err);
+    bool IsBroken_(MYSQL *sql);
+    StmtCache *Cache_(MYSQL *sql);
+    void HealthCheck_();
+    static int64_t NowUs_();
+
+    std::string host_, user_, pwd_, dbName_;
+    int port_;
+    int minConn_;
+    int maxConn_;
+    int acquireTimeoutMs_;
+    int healthIntervalMs_;
+
+    std::mutex mtx_;
+    std::condition_variable cond_;        // 有连接归还
+    std::condition_variable healthCond_;  // 用于关闭或发现断连时唤醒健康检查线程
+    std::deque<IdleConn> idle_;           // 尾部是最近归还的连接，获取时从尾部取
+    int total_;                           // 已建立和正在建立的连接数
+    bool isClose_;
+    int64_t downUntilUs_;
+    bool pingAll_;                        // 下一轮健康检查ping所有空闲连接，不论最近是否用过
+    std::thread healthThread_;
+
+    int peakInUse_;
+    uint64_t acquires_;
+    uint64_t waits_;
+    uint64_t timeouts_;
+    uint64_t waitUsTotal_;
+    uint64_t waitUsMax_;
+    uint64_t reconnects_;
+    uint64_t connectFailures_;
+    Histogram *waitHist_;                 // 每次GetConn的等待耗时，含当场建连
 
-    BlockDeque<MYSQL *> connQue_;
+    std::mutex cacheMtx_;                                // 只保护stmtCache_的增删查
+    std::unordered_map<MYSQL *, StmtCache> stmtCache_;   // 条目只被持有该连接的线程访问
 };
 
 
-#endif // SQLCONNPOOL_H
\ No newline at end of file
+#endif // SQLCONNPOOL_H
@@ -1,8 +1,13 @@
 #ifndef THREADPOOLH
 #define THREADPOOLH
 #include "../log/blockQueue.h" // Include BlockDeque
+#include "../log/log.h"
+#include "../metrics/probes.h"
+#include <atomic>
 #include <functional>
 #include <future>
+#include <pthread.h>
+#include <string>
 #include <thread>
 #include <vector>
 
@@ -15,12 +20,21 @@ private:
     BlockDeque<Task> taskQueue_; // Using BlockDeque instead of queue
     vector<thread> workers_;
     bool isClosed_;
+    string name_;
+    atomic<size_t> rejected_{0};
+    atomic<size_t> pending_{0}; // 已提交还没执行完的任务数(排队+执行中)
+    vector<int> cpus_; // 非空时第i个线程绑定到cpus_[i % size]
 
 public:
     ThreadPool()
         : threadNum_(thread::hardware_concurrency())
         , taskQueue_(1000) // Initialize BlockDeque with capacity
         , isClosed_(false) { };
+    ThreadPool(size_t threadNum, size_t queCapacity, const string& name = "")
+        : threadNum_(threadNum > 0 ? threadNum : 1)
+        , taskQueue_(queCapacity)
+        , isClosed_(false)
+        , name_(name) { };
     ~ThreadPool()
     {
         isClosed_ = true;
@@ -41,14 +55,48 @@ public:
         
         // Use emplace_back instead of push_back with move
         // 使用lambda表达式消除出参
+        pending_++;
         taskQueue_.emplace_back([task]() { (*task)(); });
+        USDT_PROBE1(task_enqueue, name_.c_str());
         
         future<RetType> res = task->get_future();
         return res;
     }
+    /* 队列满时不阻塞调用线程，直接返回false并计数，由调用方决定降级方式 */
+    template <class F>
+    bool TryCommit(F&& f)
+    {
+        pending_++;
+        if (!taskQueue_.try_push_back(Task(forward<F>(f)))) {
+            pending_--;
+            rejected_++;
+            return false;
+        }
+        USDT_PROBE1(task_enqueue, name_.c_str());
+        return true;
+    }
+    const string& Name() const { return name_; }
+    size_t ThreadNum() const { return threadNum_; }
+    size_t QueueSize() { return taskQueue_.size(); }
+    size_t Rejected() const { return rejected_; }
+    /* 等待队列取空且没有任务在执行，超时返回false；不影响之后继续提交 */
+    bool WaitIdle(int timeoutMs)
+    {
+        auto deadline = chrono::steady_clock::now() + chrono::milliseconds(timeoutMs);
+        while (pending_ > 0) {
+            if (chrono::steady_clock::now() >= deadline) {
+                return false;
+            }
+            this_thread::sleep_for(chrono::milliseconds(5));
+        }
+        return true;
+    }
+    /* 须在start之前调用 */
+    void SetAffinity(const vector<int>& cpus) { cpus_ = cpus; }
+
     void start()
     {
-        LOG_INFO("ThreadPool start");
+        LOG_INFO("ThreadPool {} start, {} threads", name_, threadNum_);
         for (size_t i = 0; i < threadNum_; i++) {
             workers_.emplace_back(
                 thread([this]() {
@@ -60,8 +108,20 @@ public:
                     if(!success) { // If queue is closed or operation failed
                         return;
                     }
+                    USDT_PROBE1(task_dequeue, name_.c_str());
                     task();
+                    USDT_PROBE1(task_done, name_.c_str());
+                    pending_--;
                 } }));
+            if (!cpus_.empty()) {
+                int cpu = cpus_[i % cpus_.size()];
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                CPU_SET(cpu, &set);
+                if (pthread_setaffinity_np(workers_.back().native_handle(), sizeof(set), &set) != 0) {
+                    LOG_WARN("ThreadPool {} pin thread {} to CPU {} failed", name_, i, cpu);
+                }
+            }
         }
     };
 };
@@ -0,0 +1,242 @@
+#include "master.h"
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <chrono>
+#include <fmt/format.h>
+#include "webserver.h"
+using namespace std;
+
+static int64_t NowMs()
+{
+    return chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* master不使用Log，带时间和pid写到stderr */
+template <typename... Args>
+static void Print(const char* format, const Args&... args)
+{
+    time_t now = time(nullptr);
+    struct tm t;
+    localtime_r(&now, &t);
+    string line = fmt::format("{:04}-{:02}-{:02} {:02}:{:02}:{:02} [master {}] ", t.tm_year + 1900, t.tm_mon + 1,
+                              t.tm_mday, t.tm_hour, t.tm_min, t.tm_sec, getpid());
+    line += fmt::vformat(format, fmt::make_format_args(args...));
+    line += '\n';
+    fputs(line.c_str(), stderr);
+}
+
+static string DescribeStatus(int status)
+{
+    if (WIFEXITED(status)) {
+        return fmt::format("exited with code {}", WEXITSTATUS(status));
+    }
+    if (WIFSIGNALED(status)) {
+        return fmt::format("killed by signal {} ({})", WTERMSIG(status), strsignal(WTERMSIG(status)));
+    }
+    return fmt::format("status {}", status);
+}
+
+Master::Master(const ServerConfig& config, int argc, char* argv[])
+    : config_(config)
+    , argc_(argc)
+    , argv_(argv)
+    , port_(config.port)
+    , masterPid_(getpid())
+    , workers_(config.workers)
+    , stats_(nullptr)
+    , stopping_(false)
+{
+    sigemptyset(&signals_);
+    for (int sig : { SIGCHLD, SIGTERM, SIGINT, SIGHUP, SIGUSR2 }) {
+        sigaddset(&signals_, sig);
+    }
+}
+
+Master::~Master()
+{
+    for (auto& worker : workers_) {
+        if (worker.listenFd >= 0) {
+            close(worker.listenFd);
+        }
+    }
+    SharedStats::Destroy(stats_);
+}
+
+bool Master::Listen_()
+{
+    /* 每个worker一个socket，port为0时第一个socket拿到的端口给其余的复用 */
+    ServerConfig listenConfig = config_;
+    listenConfig.reusePort = true;
+    for (auto& worker : workers_) {
+        worker.listenFd = WebServer::CreateListenSocket(listenConfig, port_);
+        if (worker.listenFd < 0) {
+            Print("listen on port {} failed: {}", port_, strerror(errno));
+            return false;
+        }
+    }
+    return true;
+}
+
+int Master::Run()
+{
+    if (!Listen_()) {
+        return 1;
+    }
+    stats_ = SharedStats::Create(config_.workers);
+    if (!stats_) {
+        Print("create shared stats failed: {}", strerror(errno));
+        return 1;
+    }
+    /* 信号都阻塞，由sigtimedwait同步处理；worker在fork后解除 */
+    sigprocmask(SIG_BLOCK, &signals_, nullptr);
+    Print("port {}, {} workers", port_, config_.workers);
+    for (int i = 0; i < config_.workers; i++) {
+        Spawn_(i);
+    }
+
+    int64_t killAtMs = 0;
+    int64_t reportAtMs = NowMs() + REPORT_INTERVAL_MS;
+    while (true) {
+        struct timespec wait = { 0, 100 * 1000 * 1000 };
+        int sig = sigtimedwait(&signals_, nullptr, &wait);
+        if (sig == SIGCHLD) {
+            Reap_();
+        } else if (sig == SIGTERM || sig == SIGINT) {
+            if (!stopping_) {
+                Print("received {}, stopping workers", strsignal(sig));
+                stopping_ = true;
+                killAtMs = NowMs() + config_.drainTimeoutMs + KILL_GRACE_MS;
+            } else {
+                Print("received {} again, workers exit without draining", strsignal(sig));
+            }
+            Broadcast_(SIGTERM);
+        } else if (sig == SIGHUP) {
+            Print("reloading workers");
+            Broadcast_(SIGHUP);
+        } else if (sig == SIGUSR2) {
+            Print("SIGUSR2 ignored: upgrade is not supported with workers > 0");
+        }
+
+        int64_t now = NowMs();
+        if (stopping_) {
+            /* 子进程退出时SIGCHLD可能已被合并，这里再回收一次 */
+            Reap_();
+            if (stats_->Alive() == 0) {
+                break;
+            }
+            if (killAtMs > 0 && now >= killAtMs) {
+                Print("{} workers still running after drain timeout, killing", stats_->Alive());
+                Broadcast_(SIGKILL);
+                killAtMs = 0;
+            }
+            continue;
+        }
+        for (int i = 0; i < config_.workers; i++) {
+            if (workers_[i].pid < 0 && now >= workers_[i].respawnAtMs) {
+                Spawn_(i);
+            }
+        }
+        if (now >= reportAtMs) {
+            Print("{}", stats_->Summary());
+            reportAtMs = now + REPORT_INTERVAL_MS;
+        }
+    }
+    Print("all workers exited: {}", stats_->Summary());
+    return 0;
+}
+
+bool Master::Spawn_(int id)
+{
+    Worker& worker = workers_[id];
+    pid_t pid = fork();
+    if (pid == 0) {
+        RunWorker_(id);
+    }
+    if (pid < 0) {
+        Print("fork worker {} failed: {}", id, strerror(errno));
+        worker.respawnAtMs = NowMs() + RESPAWN_DELAY_MS;
+        return false;
+    }
+    WorkerStats& slot = stats_->Slot(id);
+    slot.pid = pid;
+    if (worker.started) {
+        slot.restarts++;
+    }
+    worker.pid = pid;
+    worker.startMs = NowMs();
+    worker.started = true;
+    Print("worker {} started, pid {}", id, pid);
+    return true;
+}
+
+void Master::RunWorker_(int id)
+{
+    /* master退出(包括被kill -9)后worker收到SIGTERM，排空后退出 */
+    prctl(PR_SET_PDEATHSIG, SIGTERM);
+    if (getppid() != masterPid_) {
+        _exit(0);
+    }
+    /* 终端的Ctrl-C只发给master，由master转发一次，worker不会因为收到两次而跳过排空 */
+    setpgid(0, 0);
+    sigprocmask(SIG_UNBLOCK, &signals_, nullptr);
+    for (int i = 0; i < int(workers_.size()); i++) {
+        if (i != id) {
+            close(workers_[i].listenFd);
+        }
+    }
+    WorkerContext context;
+    context.id = id;
+    context.listenFd = workers_[id].listenFd;
+    context.stats = stats_;
+    int code = 0;
+    {
+        WebServer server(config_, context);
+        if (server.IsClosed()) {
+            code = 1; // 初始化失败，原因见worker自己的日志
+        } else {
+            server.SetCommandLine(argc_, argv_);
+            server.Start();
+        }
+    }
+    /* exit而不是_exit：Log等单例析构时把缓冲区写出 */
+    exit(code);
+}
+
+void Master::Reap_()
+{
+    int status;
+    pid_t pid;
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        for (int id = 0; id < int(workers_.size()); id++) {
+            Worker& worker = workers_[id];
+            if (worker.pid != pid) {
+                continue;
+            }
+            worker.pid = -1;
+            stats_->Retire(id);
+            if (stopping_) {
+                Print("worker {} (pid {}) {}", id, pid, DescribeStatus(status));
+                break;
+            }
+            int64_t now = NowMs();
+            bool crashLoop = now - worker.startMs < MIN_UPTIME_MS;
+            worker.respawnAtMs = crashLoop ? now + RESPAWN_DELAY_MS : now;
+            Print("worker {} (pid {}) {}, respawn in {}ms", id, pid, DescribeStatus(status),
+                  worker.respawnAtMs - now);
+            break;
+        }
+    }
+}
+
+void Master::Broadcast_(int sig)
+{
+    for (auto& worker : workers_) {
+        if (worker.pid > 0) {
+            kill(worker.pid, sig);
+        }
+    }
+}
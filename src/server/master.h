@@ -0,0 +1,62 @@
+/*
+prefork多进程模式(workers > 0)
+1. master为每个worker创建一个绑定同一端口的SO_REUSEPORT监听socket，由内核按四元组在它们之间分配新连接。
+   socket由master持有，worker崩溃后新的worker接手同一个socket，已在它accept队列里的连接不会丢
+2. 每个worker是fork出来的独立进程，运行完整的WebServer，有自己的线程池、日志、连接池和堆，
+   进程之间没有共享的锁，一个worker崩溃不影响其他worker
+3. worker退出后master重新fork；启动不到MIN_UPTIME_MS就退出的延迟RESPAWN_DELAY_MS再拉起，避免循环崩溃
+4. SIGTERM/SIGINT转发给所有worker，各自排空后退出，超过drain_timeout_ms仍未退出的SIGKILL；
+   再收到一次则再转发一次，worker立即退出。SIGHUP转发给所有worker各自重新读取配置。SIGUSR2不支持
+5. 日志写线程不能跨fork，master本身不初始化Log，只往stderr输出进程级事件和定期的汇总(SharedStats)
+*/
+#ifndef MASTER_H
+#define MASTER_H
+
+#include <signal.h>
+#include <sys/types.h>
+#include <stdint.h>
+#include <vector>
+
+#include "../config/config.h"
+#include "../metrics/sharedstats.h"
+
+class Master {
+public:
+    Master(const ServerConfig& config, int argc, char* argv[]);
+    ~Master();
+
+    /* 返回进程退出码 */
+    int Run();
+
+private:
+    bool Listen_();
+    bool Spawn_(int id);
+    [[noreturn]] void RunWorker_(int id);
+    void Reap_();
+    void Broadcast_(int sig);
+
+    static const int MIN_UPTIME_MS = 1000;
+    static const int RESPAWN_DELAY_MS = 1000;
+    static const int KILL_GRACE_MS = 5000;      // drain_timeout_ms之外再等待的时间
+    static const int REPORT_INTERVAL_MS = 60000;
+
+    struct Worker {
+        pid_t pid = -1;
+        int listenFd = -1;
+        int64_t startMs = 0;
+        int64_t respawnAtMs = 0;
+        bool started = false;
+    };
+
+    ServerConfig config_;
+    int argc_;
+    char** argv_;
+    int port_;
+    pid_t masterPid_;
+    sigset_t signals_;
+    std::vector<Worker> workers_;
+    SharedStats* stats_;
+    bool stopping_;
+};
+
+#endif // MASTER_H
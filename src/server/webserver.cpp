@@ -1,60 +1,491 @@
 #include <memory>
+#include <sys/syscall.h>
+#include <sys/wait.h>
 using namespace std;
 #include "webserver.h"
+#include "../store/cachedstore.h"
 
-WebServer::WebServer(
-    int port, int trigMode, int timeoutMS, bool OptLinger,
-    int sqlPort, const char* sqlUser, const char* sqlPwd,
-    const char* dbName, int connPoolNum, int threadNum,
-    bool openLog, int logLevel, int logQueSize)
-    : port_(port)
-    , openLinger_(OptLinger)
-    , timeoutMS_(timeoutMS)
+#undef LOG_MODULE
+#define LOG_MODULE LOG_MOD_SERVER
+
+/* 平滑升级时旧进程传给新进程的环境变量 */
+static const char LISTEN_FD_ENV[] = "WEBSERVER_LISTEN_FD";
+static const char READY_FD_ENV[] = "WEBSERVER_READY_FD";
+
+std::atomic<int> WebServer::pendingSignals_;
+int WebServer::signalWakeFd_ = -1;
+
+static int64_t NowMs()
+{
+    return chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* prefork模式下每个worker写自己的文件：./log/slow.log -> ./log/slow.w0.log */
+static string WorkerPath(const string& path, const WorkerContext& worker)
+{
+    if (worker.id < 0) {
+        return path;
+    }
+    size_t dot = path.rfind('.');
+    size_t slash = path.rfind('/');
+    if (dot == string::npos || (slash != string::npos && dot < slash)) {
+        dot = path.size();
+    }
+    return fmt::format("{}.w{}{}", path.substr(0, dot), worker.id, path.substr(dot));
+}
+
+/* Log只保存suffix指针，须在整个进程内有效 */
+static string logSuffix;
+
+static void ApplyLogRotation(const ServerConfig& config)
+{
+    Log::Instance()->SetRotation(size_t(config.logFileMb) << 20, size_t(config.logTotalMb) << 20, config.logCompress);
+}
+
+/* log_levels里没列出的模块恢复为跟随全局级别 */
+static void ApplyLogLevels(const string& spec)
+{
+    vector<pair<string, int>> levels;
+    ParseLogLevels(spec, levels);
+    for (int module = 0; module < LOG_MOD_COUNT; module++) {
+        Log::Instance()->SetModuleLevel(module, -1);
+    }
+    for (auto& item : levels) {
+        int module = Log::ModuleByName(item.first);
+        if (module < 0) {
+            LOG_WARN("log_levels: unknown module '{}'", item.first);
+            continue;
+        }
+        Log::Instance()->SetModuleLevel(module, item.second);
+    }
+}
+
+WebServer::WebServer(const ServerConfig& config, const WorkerContext& worker)
+    : config_(config)
+    , worker_(worker)
+    , port_(config.port)
+    , openLinger_(config.linger)
+    , timeoutMS_(config.timeoutMs)
     , isClose_(false)
+    , listenFd_(worker.listenFd)
+    , wakeFd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+    , upgradePid_(-1)
+    , upgradeFd_(-1)
+    , readyFd_(-1)
+    , draining_(false)
+    , shutdownRequested_(false)
+    , drainDeadlineMs_(0)
     , timer_(new HeapTimer())
-    , threadpool_(new ThreadPool())
     , epoller_(new Epoller())
-    , iplist_(make_unique<iplist>("./iplist/ip.log"))
+    , iplist_(make_unique<iplist>(WorkerPath("./iplist/ip.log", worker)))
+    , limiter_(make_unique<IpLimiter>(65536, config.maxConnPerIp, config.ipRate, config.ipBurst))
+    , acl_(make_unique<IpAcl>("./iplist/acl.conf"))
+    , analytics_(make_unique<Analytics>())
+    , slowLog_(make_unique<SlowLog>(WorkerPath("./log/slow.log", worker), config.slowRequestMs))
+    , executors_(make_unique<Executors>())
 {
-    const int PATH_MAX = 128; 
-    char buff[PATH_MAX];
-    if (getcwd(buff, PATH_MAX) != nullptr) {
-        srcDir_ = std::string(buff) + "/resources";
+    if (!config.srcDir.empty()) {
+        srcDir_ = config.srcDir;
     } else {
-        // 处理错误情况
-        srcDir_ = "./resources"; // 使用相对路径作为备选
-        LOG_WARN("Failed to get current directory, using relative path");
+        const int PATH_MAX = 128;
+        char buff[PATH_MAX];
+        if (getcwd(buff, PATH_MAX) != nullptr) {
+            srcDir_ = std::string(buff) + "/resources";
+        } else {
+            // 处理错误情况
+            srcDir_ = "./resources"; // 使用相对路径作为备选
+            LOG_WARN("Failed to get current directory, using relative path");
+        }
     }
-    LOG_INFO("srcDir: {}", srcDir_.c_str());
     HttpConn::userCount = 0;
     HttpConn::srcDir = srcDir_;
-    InitEventMode_(trigMode);
+    HttpConn::readBufferSize = config.readBuffer;
+    HttpConn::writeBufferSize = config.writeBuffer;
+    HttpRequest::maxHeaderBytes = config.maxHeaderBytes;
+    HttpRequest::maxBodyBytes = config.maxBodyBytes;
+    HttpConn::RegisterHandler("/stats", [this](const HttpRequest&, string& body, string& contentType) {
+        body = analytics_->Json();
+        contentType = "application/json";
+    });
+    InitEventMode_(config.trigMode);
     if (!InitSocket_()) {
         isClose_ = true;
+    } else {
+        InitSignals_();
     }
-    if (openLog) {
-        Log::Instance()->init(logLevel, "./log", ".log", logQueSize);
+    if (config.log) {
+        logSuffix = WorkerPath(".log", worker);
+        ApplyLogRotation(config);
+        Log::Instance()->init(config.logLevel, "./log", logSuffix.c_str(), config.logQueue, config.logMode);
+        ApplyLogLevels(config.logLevels);
         if (isClose_) {
             LOG_ERROR("========== Server init error!==========");
         } else {
             LOG_INFO("========== Server init ==========");
-            LOG_INFO("Port:{}, OpenLinger: {}", port_, OptLinger ? "true" : "false");
+            if (worker.id >= 0) {
+                LOG_INFO("Worker {} of {}, pid {}", worker.id, config.workers, getpid());
+            }
+            LOG_INFO("Port:{}, OpenLinger: {}", port_, openLinger_ ? "true" : "false");
             LOG_INFO("Listen Mode: {}, OpenConn Mode: {}",
                 (listenEvent_ & EPOLLET ? "ET" : "LT"),
                 (connEvent_ & EPOLLET ? "ET" : "LT"));
-            LOG_INFO("LogSys level: {}", logLevel);
+            LOG_INFO("LogSys level: {}, mode: {}", config.logLevel, config.logMode);
             LOG_INFO("srcDir: {}", HttpConn::srcDir);
-            LOG_INFO("SqlConnPool num: {}, ThreadPool num: {}", connPoolNum, threadNum);
+            LOG_INFO("SqlConnPool num: {}, ThreadPool num: {}", config.connPool, config.ioThreads);
         }
     }
-    SqlConnPool::Instance()->Init("localhost", sqlPort, sqlUser, sqlPwd, dbName, connPoolNum);
-    threadpool_->start();
+    int connPoolMax = config.connPoolMax > 0 ? config.connPoolMax : config.connPool * 2;
+    StoreConfig storeConfig;
+    storeConfig.host = config.sqlHost;
+    storeConfig.port = config.sqlPort;
+    storeConfig.user = config.sqlUser;
+    storeConfig.pwd = config.sqlPassword;
+    storeConfig.dbName = config.sqlDb;
+    storeConfig.connPoolNum = config.connPool;
+    storeConfig.connPoolMax = connPoolMax;
+    storeConfig.acquireTimeoutMs = config.connAcquireTimeoutMs;
+    storeConfig.healthIntervalMs = config.connHealthIntervalMs;
+    storeConfig.cacheTtlMs = config.authCacheTtlMs;
+    storeConfig.negativeTtlMs = config.authCacheNegativeTtlMs;
+    storeConfig.cacheCapacity = config.authCacheSize;
+    if (!ParseStoreSpec(config.userStore, storeConfig) || !(store_ = NewUserStore(storeConfig))) {
+        LOG_ERROR("UserStore {} init error!", config.userStore);
+        isClose_ = true;
+    } else {
+        LOG_INFO("UserStore: {}", store_->Name());
+        InitAuth_();
+    }
+    size_t cores = max(thread::hardware_concurrency(), 1u);
+    size_t ioThreads = config.ioThreads > 0 ? config.ioThreads : cores;
+    size_t cpuThreads = config.cpuThreads > 0 ? config.cpuThreads : max<size_t>(cores / 2, 1);
+    size_t dbThreads = config.dbThreads > 0 ? config.dbThreads : connPoolMax;
+    ioPool_ = executors_->Add("io", ioThreads, config.ioQueue);
+    executors_->Add("cpu", cpuThreads, config.cpuQueue);
+    executors_->Add("db", dbThreads, config.dbQueue);
+    vector<int> cpus;
+    if (!config.cpuAffinity.empty() && ParseCpuList(config.cpuAffinity, cpus)) {
+        ioPool_->SetAffinity(cpus);
+    }
+    InitMetrics_();
+    executors_->StartAll();
 }
+
 WebServer::~WebServer()
 {
+    Metrics::Instance()->Unregister(this);
     close(listenFd_);
+    close(wakeFd_);
+    if (upgradeFd_ >= 0) {
+        close(upgradeFd_);
+    }
+    if (signalWakeFd_ == wakeFd_) {
+        signalWakeFd_ = -1;
+    }
     isClose_ = true;
-    SqlConnPool::Instance()->ClosePool();
+}
+
+void WebServer::Stop()
+{
+    isClose_ = true;
+    uint64_t one = 1;
+    if (write(wakeFd_, &one, sizeof(one)) < 0) {
+        LOG_WARN("Wake event loop error!");
+    }
+}
+
+void WebServer::SetIpLimits(int maxConnPerIp, double ratePerSec, double burst)
+{
+    limiter_->SetLimits(maxConnPerIp, ratePerSec, burst);
+}
+
+void WebServer::SetCommandLine(int argc, char* argv[])
+{
+    args_.assign(argv, argv + argc);
+    char path[4096];
+    ssize_t len = readlink("/proc/self/exe", path, sizeof(path) - 1);
+    if (len > 0) {
+        path[len] = '\0';
+        exePath_ = path;
+    } else if (argc > 0) {
+        exePath_ = argv[0];
+    }
+}
+
+void WebServer::InitSignals_()
+{
+    signalWakeFd_ = wakeFd_;
+    struct sigaction act = {};
+    act.sa_handler = &WebServer::OnSignal_;
+    act.sa_flags = SA_RESTART;
+    sigemptyset(&act.sa_mask);
+    for (int sig : { SIGHUP, SIGUSR2, SIGTERM, SIGINT }) {
+        sigaction(sig, &act, nullptr);
+    }
+    /* 对端已关闭时写socket返回EPIPE，不能让SIGPIPE杀掉进程 */
+    signal(SIGPIPE, SIG_IGN);
+}
+
+void WebServer::OnSignal_(int sig)
+{
+    /* 只做异步信号安全的操作 */
+    pendingSignals_.fetch_or(1 << sig);
+    if (signalWakeFd_ >= 0) {
+        uint64_t one = 1;
+        ssize_t ret = write(signalWakeFd_, &one, sizeof(one));
+        (void)ret;
+    }
+}
+
+void WebServer::HandleSignals_()
+{
+    int sigs = pendingSignals_.exchange(0);
+    if (sigs & (1 << SIGHUP)) {
+        Reload_();
+    }
+    if (sigs & (1 << SIGUSR2)) {
+        Upgrade_();
+    }
+    if (sigs & ((1 << SIGTERM) | (1 << SIGINT))) {
+        if (shutdownRequested_) {
+            LOG_WARN("Second stop signal, exit without waiting");
+            drainDeadlineMs_ = NowMs();
+            isClose_ = true;
+            return;
+        }
+        shutdownRequested_ = true;
+        LOG_INFO("========== Server shutting down ==========");
+        BeginDrain_();
+    }
+}
+
+void WebServer::Reload_()
+{
+    if (args_.empty()) {
+        LOG_WARN("SIGHUP ignored: command line unknown");
+        return;
+    }
+    vector<char*> argv;
+    for (auto& arg : args_) {
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    ServerConfig fresh;
+    string error;
+    bool help;
+    if (!ParseCommandLine(int(argv.size()), argv.data(), fresh, error, help)) {
+        LOG_ERROR("Reload failed, keep current config: {}", error);
+        return;
+    }
+    /* 只接收可在线修改的项，其余需要重启(SIGUSR2平滑升级)才生效 */
+    ServerConfig applied = config_;
+    applied.timeoutMs = fresh.timeoutMs;
+    applied.maxConnections = fresh.maxConnections;
+    applied.drainTimeoutMs = fresh.drainTimeoutMs;
+    applied.drainIdleMs = fresh.drainIdleMs;
+    applied.maxConnPerIp = fresh.maxConnPerIp;
+    applied.ipRate = fresh.ipRate;
+    applied.ipBurst = fresh.ipBurst;
+    applied.authCacheTtlMs = fresh.authCacheTtlMs;
+    applied.authCacheNegativeTtlMs = fresh.authCacheNegativeTtlMs;
+    applied.authCacheSize = fresh.authCacheSize;
+    applied.logLevel = fresh.logLevel;
+    applied.logLevels = fresh.logLevels;
+    applied.logFileMb = fresh.logFileMb;
+    applied.logTotalMb = fresh.logTotalMb;
+    applied.logCompress = fresh.logCompress;
+
+    Log::Instance()->SetLevel(applied.logLevel);
+    ApplyLogLevels(applied.logLevels);
+    ApplyLogRotation(applied);
+    limiter_->SetLimits(applied.maxConnPerIp, applied.ipRate, applied.ipBurst);
+    if (auto cached = dynamic_cast<CachedUserStore*>(store_.get())) {
+        cached->SetLimits(applied.authCacheTtlMs, applied.authCacheNegativeTtlMs, applied.authCacheSize);
+    }
+    /* 已有连接的定时器在下一次读写时按新的超时重置 */
+    timeoutMS_ = applied.timeoutMs;
+    acl_->Load();
+    if (DumpConfig(applied) != DumpConfig(fresh)) {
+        LOG_WARN("Reload: some changed options only take effect after restart/upgrade");
+    }
+    config_ = applied;
+    LOG_INFO("Config reloaded");
+}
+
+bool WebServer::InheritListenFd_()
+{
+    const char* env = getenv(LISTEN_FD_ENV);
+    if (!env) {
+        return false;
+    }
+    int fd = atoi(env);
+    int accepting = 0;
+    socklen_t len = sizeof(accepting);
+    unsetenv(LISTEN_FD_ENV);
+    if (fd <= 2 || getsockopt(fd, SOL_SOCKET, SO_ACCEPTCONN, &accepting, &len) < 0 || !accepting) {
+        LOG_ERROR("Inherited listen fd {} is invalid, create a new one", env);
+        return false;
+    }
+    struct sockaddr_in addr;
+    len = sizeof(addr);
+    if (getsockname(fd, (struct sockaddr*)&addr, &len) == 0) {
+        port_ = ntohs(addr.sin_port);
+    }
+    listenFd_ = fd;
+    if (const char* ready = getenv(READY_FD_ENV)) {
+        readyFd_ = atoi(ready);
+        fcntl(readyFd_, F_SETFD, FD_CLOEXEC);
+        unsetenv(READY_FD_ENV);
+    }
+    LOG_INFO("Inherited listen fd {} from the old process, port {}", fd, port_);
+    return true;
+}
+
+void WebServer::Upgrade_()
+{
+    if (draining_ || upgradePid_ > 0) {
+        LOG_WARN("Upgrade already in progress");
+        return;
+    }
+    if (worker_.id >= 0) {
+        LOG_WARN("SIGUSR2 ignored in worker process, restart the master to upgrade");
+        return;
+    }
+    if (exePath_.empty()) {
+        LOG_WARN("SIGUSR2 ignored: command line unknown");
+        return;
+    }
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) < 0) {
+        LOG_ERROR("Upgrade: create pipe error!");
+        return;
+    }
+    /* fork之后子进程只能调用异步信号安全的函数，参数和环境变量都先准备好 */
+    vector<string> env;
+    for (char** e = environ; *e; e++) {
+        if (strncmp(*e, LISTEN_FD_ENV, sizeof(LISTEN_FD_ENV) - 1) != 0 &&
+            strncmp(*e, READY_FD_ENV, sizeof(READY_FD_ENV) - 1) != 0) {
+            env.push_back(*e);
+        }
+    }
+    env.push_back(fmt::format("{}={}", LISTEN_FD_ENV, listenFd_));
+    env.push_back(fmt::format("{}={}", READY_FD_ENV, fds[1]));
+    vector<char*> argv, envp;
+    for (auto& arg : args_) {
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+    for (auto& e : env) {
+        envp.push_back(const_cast<char*>(e.c_str()));
+    }
+    envp.push_back(nullptr);
+    int keepLo = min(listenFd_, fds[1]);
+    int keepHi = max(listenFd_, fds[1]);
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        /* 除了监听fd和管道写端，其余fd(客户端连接、epoll等)都不能带进新进程，
+           否则旧进程关闭连接后客户端收不到FIN */
+        fcntl(listenFd_, F_SETFD, 0);
+        fcntl(fds[1], F_SETFD, 0);
+        for (int fd = 3; fd < keepLo; fd++) {
+            close(fd);
+        }
+        for (int fd = keepLo + 1; fd < keepHi; fd++) {
+            close(fd);
+        }
+#ifdef SYS_close_range
+        if (syscall(SYS_close_range, keepHi + 1, ~0U, 0) < 0)
+#endif
+        {
+            for (int fd = keepHi + 1; fd < MAX_UPGRADE_FD; fd++) {
+                close(fd);
+            }
+        }
+        execve(exePath_.c_str(), argv.data(), envp.data());
+        _exit(127);
+    }
+    close(fds[1]);
+    if (pid < 0) {
+        LOG_ERROR("Upgrade: fork error!");
+        close(fds[0]);
+        return;
+    }
+    upgradePid_ = pid;
+    upgradeFd_ = fds[0];
+    epoller_->AddFd(upgradeFd_, EPOLLIN);
+    LOG_INFO("Upgrade: started {} as pid {}, waiting for it to be ready", exePath_, pid);
+}
+
+void WebServer::OnUpgradeReady_()
+{
+    char byte;
+    ssize_t n = read(upgradeFd_, &byte, 1);
+    epoller_->DelFd(upgradeFd_);
+    close(upgradeFd_);
+    upgradeFd_ = -1;
+    if (n == 1) {
+        LOG_INFO("Upgrade: pid {} is ready, stop accepting and drain", upgradePid_);
+        BeginDrain_();
+        return;
+    }
+    /* 管道被关闭而没有收到就绪字节：新进程初始化失败，继续由本进程服务 */
+    int status = 0;
+    waitpid(upgradePid_, &status, WNOHANG);
+    LOG_ERROR("Upgrade: pid {} exited before ready, keep serving", upgradePid_);
+    upgradePid_ = -1;
+}
+
+void WebServer::Shutdown_()
+{
+    /* 事件循环已退出：等工作线程把手上的任务做完，再关掉超时仍未结束的连接 */
+    int64_t deadline = draining_ ? drainDeadlineMs_ : NowMs() + config_.drainTimeoutMs;
+    if (!executors_->WaitIdle(int(max<int64_t>(deadline - NowMs(), 0)))) {
+        LOG_WARN("Executors still busy at shutdown deadline");
+    }
+    size_t left = 0;
+    for (auto& kv : users_) {
+        if (!kv.second.IsClosed()) {
+            CloseConn_(&kv.second);
+            left++;
+        }
+    }
+    if (left > 0) {
+        LOG_WARN("Closed {} connections at shutdown deadline", left);
+    }
+    if (worker_.stats) {
+        PublishStats_();
+    }
+    LOG_INFO("========== Server stop ==========");
+    /* 日志线程在Log析构时把缓冲区全部写出 */
+    Log::Instance()->flush();
+}
+
+void WebServer::BeginDrain_()
+{
+    if (draining_) {
+        return;
+    }
+    draining_ = true;
+    HttpConn::draining = true;
+    drainDeadlineMs_ = NowMs() + config_.drainTimeoutMs;
+    if (listenFd_ >= 0) {
+        epoller_->DelFd(listenFd_);
+        close(listenFd_);
+        listenFd_ = -1;
+    }
+    /* 空闲的keep-alive连接在drain_idle_ms后关闭；有请求在处理(包括挂起在db/cpu线程池上的登录)或
+       响应还没发完的连接不受这个超时限制，发完带Connection: close的响应后自己关闭，最迟到排空期限 */
+    for (auto& kv : users_) {
+        HttpConn* client = &kv.second;
+        if (!client->IsClosed()) {
+            timer_->del(kv.first);
+            timer_->add(kv.first, config_.drainIdleMs, make_shared<function<void()>>([this, client]() {
+                if (!client->IsBusy()) {
+                    CloseConn_(client);
+                }
+            }));
+        }
+    }
+    LOG_INFO("Draining {} connections, deadline {}ms", HttpConn::userCount.load(), config_.drainTimeoutMs);
 }
 
 void WebServer::SendError_(int fd, const char* info)
@@ -96,13 +527,48 @@ void WebServer::InitEventMode_(int trigMode)
 void WebServer::Start()
 {
     int timeMS = -1; /* epoll wait timeout == -1 无事件将阻塞 */
-    if (!isClose_) {
+    bool started = !isClose_;
+    int64_t nextPublishMs = 0;
+    if (started) {
         LOG_INFO("========== Server start ==========");
     }
+    if (config_.reactorCpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(config_.reactorCpu, &set);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+            LOG_WARN("Pin event loop to CPU {} failed", config_.reactorCpu);
+        }
+    }
+    if (readyFd_ >= 0) {
+        /* 平滑升级：通知旧进程本进程已就绪 */
+        if (!isClose_ && write(readyFd_, "1", 1) != 1) {
+            LOG_WARN("Notify old process error!");
+        }
+        close(readyFd_);
+        readyFd_ = -1;
+    }
     while (!isClose_) {
-        if (timeoutMS_ > 0) {
+        if (timeoutMS_ > 0 || draining_) {
             timeMS = timer_->GetNextTimeout();
         }
+        if (draining_) {
+            if (HttpConn::userCount == 0 || NowMs() >= drainDeadlineMs_) {
+                LOG_INFO("Drain finished, {} connections left", HttpConn::userCount.load());
+                break;
+            }
+            /* 排空期间定期检查是否结束 */
+            timeMS = (timeMS < 0 || timeMS > 100) ? 100 : timeMS;
+        }
+        if (worker_.stats) {
+            int64_t now = NowMs();
+            if (now >= nextPublishMs) {
+                PublishStats_();
+                nextPublishMs = now + SharedStats::PUBLISH_INTERVAL_MS;
+            }
+            int wait = int(nextPublishMs - now);
+            timeMS = (timeMS < 0 || timeMS > wait) ? wait : timeMS;
+        }
         int eventCnt = epoller_->Wait(timeMS);
         for (int i = 0; i < eventCnt; i++) {
             /* 处理事件 */
@@ -110,6 +576,12 @@ void WebServer::Start()
             uint32_t events = epoller_->GetEvents(i);
             if (fd == listenFd_) {
                 DealListen_();
+            } else if (fd == wakeFd_) {
+                uint64_t cnt;
+                while (read(wakeFd_, &cnt, sizeof(cnt)) > 0) {}
+                HandleSignals_();
+            } else if (fd == upgradeFd_) {
+                OnUpgradeReady_();
             } else if (events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
                 assert(users_.count(fd) > 0);
                 CloseConn_(&users_[fd]);
@@ -126,22 +598,41 @@ void WebServer::Start()
             }
         }
     }
+    if (started) {
+        Shutdown_();
+    }
 }
 
 void WebServer::DealListen_()
 {
     struct sockaddr_in addr;
     socklen_t len = sizeof(addr);
+    acl_->MaybeReload();
     do {
         int fd = accept(listenFd_, (struct sockaddr*)&addr, &len);
         if (fd <= 0) {
             return;
-        } else if (HttpConn::userCount >= MAX_FD) {
+        } else if (!acl_->Allowed(addr.sin_addr.s_addr)) {
+            /* 命中拒绝规则：直接关闭，不回复也不占用HttpConn */
+            close(fd);
+            refusedAcl_->Add();
+            LOG_DEBUG("Client {} denied by ACL", inet_ntoa(addr.sin_addr));
+            continue;
+        }
+        analytics_->RecordClient(addr.sin_addr.s_addr);
+        if (HttpConn::userCount >= config_.maxConnections) {
             SendError_(fd, "Server busy!");
+            refusedFull_->Add();
             LOG_WARN("Clients is full!");
             return;
+        } else if (!limiter_->Acquire(addr.sin_addr.s_addr)) {
+            SendError_(fd, "Too many connections!");
+            refusedLimit_->Add();
+            LOG_WARN("Client {} exceeds connection limit", inet_ntoa(addr.sin_addr));
+            continue;
         }
         iplist_->insert(addr);
+        accepted_->Add();
         AddClient_(fd, addr);
     } while (listenEvent_ & EPOLLET);
 }
@@ -149,12 +640,17 @@ void WebServer::DealListen_()
 void WebServer::AddClient_(int fd, sockaddr_in addr)
 {
     assert(fd > 0);
+    USDT_PROBE2(conn_accept, fd, addr.sin_addr.s_addr);
     users_[fd].init(fd, addr);
     if (timeoutMS_ > 0) {
         timer_->add(fd, timeoutMS_, make_shared<function<void()>>(bind(&WebServer::CloseConn_, this, &users_[fd])));
     }
     epoller_->AddFd(fd, EPOLLIN | connEvent_);
     SetFdNonblock(fd);
+    if (config_.tcpNoDelay) {
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    }
     LOG_INFO("Client[{}] in!", users_[fd].GetFd());
 }
 
@@ -163,27 +659,53 @@ void WebServer::CloseConn_(HttpConn* client)
     assert(client);
     LOG_INFO("Client[{}] quit!", client->GetFd());
     epoller_->DelFd(client->GetFd());
-    client->Close();
+    if (client->Close()) {
+        limiter_->Release(client->GetAddr().sin_addr.s_addr);
+    }
+}
+
+void WebServer::SendReject_(HttpConn* client, int code)
+{
+    assert(client);
+    static const char TOO_MANY[] = "HTTP/1.1 429 Too Many Requests\r\n"
+                                   "Connection: close\r\n"
+                                   "Retry-After: 1\r\n"
+                                   "Content-length: 0\r\n\r\n";
+    static const char BUSY[] = "HTTP/1.1 503 Service Unavailable\r\n"
+                               "Connection: close\r\n"
+                               "Retry-After: 1\r\n"
+                               "Content-length: 0\r\n\r\n";
+    CountStatus_(code);
+    const char* response = code == 429 ? TOO_MANY : BUSY;
+    size_t len = code == 429 ? sizeof(TOO_MANY) - 1 : sizeof(BUSY) - 1;
+    if (send(client->GetFd(), response, len, MSG_NOSIGNAL) < 0) {
+        LOG_WARN("send {} to client[{}] error!", code, client->GetFd());
+    }
+    CloseConn_(client);
 }
 
 void WebServer::DealRead_(HttpConn* client)
 {
     assert(client);
     ExtentTime_(client);
-    threadpool_->commit([this, client]() { WebServer::OnRead_(client); });
+    client->Trace().MarkOnce(RequestTrace::READ_QUEUED);
+    ioPool_->commit([this, client]() { WebServer::OnRead_(client); });
 }
 
 void WebServer::DealWrite_(HttpConn* client)
 {
     assert(client);
     ExtentTime_(client);
-    threadpool_->commit([this, client]() { WebServer::OnWrite_(client); });
+    client->Trace().MarkOnce(RequestTrace::WRITE_QUEUED);
+    ioPool_->commit([this, client]() { WebServer::OnWrite_(client); });
 }
 
 void WebServer::ExtentTime_(HttpConn* client)
 {
     assert(client);
-    if (timeoutMS_ > 0) {
+    if (draining_) {
+        timer_->reset(client->GetFd(), config_.drainIdleMs);
+    } else if (timeoutMS_ > 0) {
         timer_->reset(client->GetFd(), timeoutMS_);
     }
 }
@@ -194,6 +716,10 @@ void WebServer::OnRead_(HttpConn* client)
     int ret = -1;
     int readErrno = 0;
     ret = client->read(&readErrno);
+    bytesIn_->Add(client->ReadBytes());
+    if (client->ReadBytes() > 0) {
+        client->Trace().MarkOnce(RequestTrace::FIRST_READ);
+    }
     if (ret <= 0 && readErrno != EAGAIN) {
         CloseConn_(client);
         return;
@@ -206,9 +732,27 @@ void WebServer::OnWrite_(HttpConn* client)
     assert(client);
     int ret = -1;
     int writeErrno = 0;
+    RequestTrace& trace = client->Trace();
+    trace.MarkOnce(RequestTrace::FIRST_WRITE);
     ret = client->write(&writeErrno);
     if (client->ToWriteBytes() == 0) {
         /* 传输完成 */
+        trace.Mark(RequestTrace::LAST_WRITE);
+        if (slowLog_->Check(trace, client->GetAddr(), client->GetRequest().method(), client->GetRequest().path(),
+                            client->StatusCode(), client->ResponseBytes())) {
+            slowTotal_->Add();
+        }
+        trace.Next();
+        int64_t nowUs = HttpConn::NowUs();
+        iplist_->access(client->GetAddr(), client->GetRequest().method(), client->GetRequest().path(),
+            client->StatusCode(), client->ResponseBytes(), nowUs - client->RequestStartUs());
+        parseLatency_->Observe(client->ParseUs());
+        handleLatency_->Observe(client->HandleUs());
+        writeLatency_->Observe(nowUs - client->ReadyUs());
+        requestLatency_->Observe(nowUs - client->RequestStartUs());
+        bytesOut_->Add(client->ResponseBytes());
+        CountStatus_(client->StatusCode());
+        analytics_->RecordRequest(client->GetAddr().sin_addr.s_addr, client->GetRequest().path());
         if (client->IsKeepAlive()) {
             OnProcess(client);
             return;
@@ -225,83 +769,290 @@ void WebServer::OnWrite_(HttpConn* client)
 
 void WebServer::OnProcess(HttpConn* client)
 {
+    /* 按请求而不是按读事件扣令牌：keep-alive的后续请求和流水线上的请求也要经过限速 */
+    if (client->HasRequest() && !limiter_->AllowRequest(client->GetAddr().sin_addr.s_addr)) {
+        LOG_WARN("Client[{}]({}) exceeds request rate", client->GetFd(), client->GetIP());
+        SendReject_(client, 429);
+        return;
+    }
     if (client->process()) {
+        if (client->IsPending()) {
+            Offload_(client);
+            return;
+        }
         epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLOUT);
+    } else if (HttpConn::draining && !client->IsBusy()) {
+        /* 排空中：排空前发出的keep-alive响应已经写完，不再等下一个请求 */
+        CloseConn_(client);
     } else {
         epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLIN);
     }
 }
 
+void WebServer::Offload_(HttpConn* client)
+{
+    /* 连接在此期间不注册任何事件，相当于挂起；Work完成后由Resume重新注册EPOLLOUT */
+    string poolName;
+    HttpConn::Work work = client->TakeWork(poolName);
+    uint64_t generation = client->Generation();
+    auto task = [this, client, generation, work]() {
+        uint64_t startTsc = Tsc::Now();
+        HttpConn::Finish finish = work();
+        uint64_t doneTsc = Tsc::Now();
+        bool resumed = client->Resume(generation, finish, [this, client, startTsc, doneTsc]() {
+            /* 在连接锁内且已确认仍是同一个连接，才能写它的trace */
+            client->Trace().tsc[RequestTrace::WORK_START] = startTsc;
+            client->Trace().tsc[RequestTrace::WORK_DONE] = doneTsc;
+            epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLOUT);
+        });
+        if (!resumed) {
+            LOG_DEBUG("Client closed before offloaded work finished, result dropped");
+        }
+    };
+    client->Trace().Mark(RequestTrace::WORK_QUEUED);
+    ThreadPool* pool = poolName.empty() ? nullptr : executors_->Get(poolName);
+    if (!pool) {
+        task();
+    } else if (!pool->TryCommit(task)) {
+        LOG_WARN("Executor {} is full, reject client[{}]", poolName, client->GetFd());
+        SendReject_(client, 503);
+    }
+}
+
+void WebServer::InitAuth_()
+{
+    /* 登录/注册：只有表单POST才挂起，GET登录页仍按静态文件处理 */
+    HttpConn::AsyncHandler auth = [this](const HttpRequest& request) -> HttpConn::Work {
+        if (!request.AuthPending()) {
+            return nullptr;
+        }
+        string name = request.GetPost("username");
+        string pwd = request.GetPost("password");
+        bool isLogin = request.AuthIsLogin();
+        return [this, name, pwd, isLogin]() -> HttpConn::Finish {
+            AuthResult result = AuthResult::NO_USER;
+            if (!name.empty() && !pwd.empty()) {
+                result = isLogin ? store_->Login(name, pwd) : store_->Register(name, pwd);
+            }
+            LOG_DEBUG("{} {}: {}", isLogin ? "Login" : "Register", name, AuthResultName(result));
+            bool ok = result == AuthResult::OK;
+            return [ok](HttpRequest& request, string&, string&) {
+                request.FinishAuth(ok);
+                return false;
+            };
+        };
+    };
+    /* 会阻塞在数据库上的后端放db池，其余(哈希校验等纯计算)放cpu池，都不占用io线程 */
+    const char* pool = store_->Blocking() ? "db" : "cpu";
+    HttpConn::RegisterHandler("/login.html", pool, auth);
+    HttpConn::RegisterHandler("/register.html", pool, auth);
+}
+
+void WebServer::InitMetrics_()
+{
+    Metrics* m = Metrics::Instance();
+    accepted_ = m->NewCounter("webserver_accepted_connections_total", "Accepted client connections");
+    const char* refusedHelp = "Connections closed right after accept";
+    refusedAcl_ = m->NewCounter("webserver_refused_connections_total", refusedHelp, "reason=\"acl\"");
+    refusedLimit_ = m->NewCounter("webserver_refused_connections_total", refusedHelp, "reason=\"ip_limit\"");
+    refusedFull_ = m->NewCounter("webserver_refused_connections_total", refusedHelp, "reason=\"max_fd\"");
+    bytesIn_ = m->NewCounter("webserver_received_bytes_total", "Bytes read from client sockets");
+    bytesOut_ = m->NewCounter("webserver_sent_bytes_total", "Bytes of completed responses");
+    const char* statusHelp = "Responses by HTTP status code";
+    for (int code : { 200, 400, 403, 404, 413, 429, 431, 503 }) {
+        statusTotal_[code] = m->NewCounter("webserver_responses_total", statusHelp, fmt::format("code=\"{}\"", code));
+    }
+    statusOther_ = m->NewCounter("webserver_responses_total", statusHelp, "code=\"other\"");
+    slowTotal_ = m->NewCounter("webserver_slow_requests_total", "Requests slower than the slow-log threshold");
+    const char* stageHelp = "Request latency by stage: parse, handle (incl. offload queueing), write";
+    parseLatency_ = m->NewHistogram("webserver_stage_seconds", stageHelp, "stage=\"parse\"");
+    handleLatency_ = m->NewHistogram("webserver_stage_seconds", stageHelp, "stage=\"handle\"");
+    writeLatency_ = m->NewHistogram("webserver_stage_seconds", stageHelp, "stage=\"write\"");
+    requestLatency_ = m->NewHistogram("webserver_request_seconds", "First request byte to last response byte");
+
+    /* 已有的状态量用回调在抓取时读取 */
+    m->NewCallback("webserver_active_connections", "Open client connections", "gauge",
+        []() { return double(HttpConn::userCount); }, "", this);
+    m->NewCallback("webserver_timer_expired_total", "Idle connections closed by the timer", "counter",
+        [this]() { return double(timer_->Expired()); }, "", this);
+    for (const char* name : { "io", "cpu", "db" }) {
+        ThreadPool* pool = executors_->Get(name);
+        string label = fmt::format("pool=\"{}\"", name);
+        m->NewCallback("executor_threads", "Worker threads per executor", "gauge",
+            [pool]() { return double(pool->ThreadNum()); }, label, this);
+        m->NewCallback("executor_queue_depth", "Tasks waiting in the executor queue", "gauge",
+            [pool]() { return double(pool->QueueSize()); }, label, this);
+        m->NewCallback("executor_rejected_total", "Tasks rejected because the queue was full", "counter",
+            [pool]() { return double(pool->Rejected()); }, label, this);
+    }
+    /* 连接池的指标由MysqlUserStore自己注册 */
+    if (auto cached = dynamic_cast<CachedUserStore*>(store_.get())) {
+        m->NewCallback("auth_cache_requests_total", "Auth cache lookups", "counter",
+            [cached]() { return double(cached->Hits()); }, "result=\"hit\"", this);
+        m->NewCallback("auth_cache_requests_total", "Auth cache lookups", "counter",
+            [cached]() { return double(cached->Misses()); }, "result=\"miss\"", this);
+    }
+    /* prefork模式下从共享内存读取所有worker的汇总，抓取任意一个worker即可看到整体 */
+    if (SharedStats* stats = worker_.stats) {
+        string label = fmt::format("worker=\"{}\"", worker_.id);
+        m->NewCallback("webserver_worker_info", "Worker id of the process serving this scrape", "gauge",
+            []() { return 1.0; }, label, this);
+        m->NewCallback("webserver_cluster_workers", "Live worker processes", "gauge",
+            [stats]() { return double(stats->Alive()); }, "", this);
+        m->NewCallback("webserver_cluster_worker_restarts_total", "Workers respawned by the master", "counter",
+            [stats]() { return double(stats->Restarts()); }, "", this);
+        m->NewCallback("webserver_cluster_active_connections", "Open connections over all workers", "gauge",
+            [stats]() { return double(stats->Connections()); }, "", this);
+        for (int i = 0; i < STAT_COUNT; i++) {
+            m->NewCallback(fmt::format("webserver_cluster_{}_total", SharedStats::FIELD_NAMES[i]),
+                "Sum over all worker processes, published every second", "counter",
+                [stats, i]() { return double(stats->Total(StatField(i))); }, "", this);
+        }
+    }
+    HttpConn::RegisterHandler("/metrics", [](const HttpRequest&, string& body, string& contentType) {
+        body = Metrics::Instance()->Prometheus();
+        contentType = "text/plain; version=0.0.4";
+    });
+}
+
+void WebServer::PublishStats_()
+{
+    WorkerStats& slot = worker_.stats->Slot(worker_.id);
+    uint64_t responses = statusOther_->Value();
+    for (auto& kv : statusTotal_) {
+        responses += kv.second->Value();
+    }
+    slot.counters[STAT_ACCEPTED] = accepted_->Value();
+    slot.counters[STAT_REFUSED] = refusedAcl_->Value() + refusedLimit_->Value() + refusedFull_->Value();
+    slot.counters[STAT_RESPONSES] = responses;
+    slot.counters[STAT_BYTES_IN] = bytesIn_->Value();
+    slot.counters[STAT_BYTES_OUT] = bytesOut_->Value();
+    slot.connections = HttpConn::userCount.load();
+}
+
+void WebServer::CountStatus_(int code)
+{
+    auto it = statusTotal_.find(code);
+    (it != statusTotal_.end() ? it->second : statusOther_)->Add();
+}
+
 /* Create listenFd */
-bool WebServer::InitSocket_()
+int WebServer::CreateListenSocket(const ServerConfig& config, int& port)
 {
     int ret;
     struct sockaddr_in addr;
-    if (port_ > 65535 || port_ < 1024) {
-        LOG_ERROR("Port:{} error!", port_);
-        return false;
+    /* 0由内核分配临时端口，bind后再取回实际端口 */
+    if (port != 0 && (port > 65535 || port < 1024)) {
+        LOG_ERROR("Port:{} error!", port);
+        return -1;
     }
     addr.sin_family = AF_INET;
     addr.sin_addr.s_addr = htonl(INADDR_ANY);
-    addr.sin_port = htons(port_);
+    addr.sin_port = htons(port);
     struct linger optLinger = { 0 };
-    if (openLinger_) {
+    if (config.linger) {
         /* 优雅关闭: 直到所剩数据发送完毕或超时 */
         optLinger.l_onoff = 1;
         optLinger.l_linger = 1;
     }
 
-    listenFd_ = socket(AF_INET, SOCK_STREAM, 0);
-    if (listenFd_ < 0) {
-        LOG_ERROR("Create socket error! port={}", port_);
-        return false;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        LOG_ERROR("Create socket error! port={}", port);
+        return -1;
     }
 
-    ret = setsockopt(listenFd_, SOL_SOCKET, SO_LINGER, &optLinger, sizeof(optLinger));
+    ret = setsockopt(fd, SOL_SOCKET, SO_LINGER, &optLinger, sizeof(optLinger));
     if (ret < 0) {
-        close(listenFd_);
-        LOG_ERROR("Init linger error! port={}", port_);
-        return false;
+        close(fd);
+        LOG_ERROR("Init linger error! port={}", port);
+        return -1;
     }
 
     int optval = 1;
     /* 端口复用 */
     /* 只有最后一个套接字会正常接收数据。 */
-    ret = setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, (const void*)&optval, sizeof(int));
+    ret = setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, (const void*)&optval, sizeof(int));
     if (ret == -1) {
         LOG_ERROR("set socket setsockopt error !");
-        close(listenFd_);
-        return false;
+        close(fd);
+        return -1;
+    }
+
+    if (config.reusePort) {
+        ret = setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &optval, sizeof(int));
+        if (ret == -1) {
+            LOG_ERROR("set socket SO_REUSEPORT error !");
+            close(fd);
+            return -1;
+        }
+    }
+    /* 缓冲区大小在listen之前设置，accept得到的连接会继承 */
+    if (config.sndBuf > 0) {
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &config.sndBuf, sizeof(int));
+    }
+    if (config.rcvBuf > 0) {
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &config.rcvBuf, sizeof(int));
     }
 
     int keep_alive = 1;
-    ret = setsockopt(listenFd_, SOL_SOCKET, SO_KEEPALIVE, &keep_alive, sizeof(int));
+    ret = setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &keep_alive, sizeof(int));
     if (ret == -1) {
         LOG_ERROR("set socket keep_alive error !");
-        close(listenFd_);
-        return false;
+        close(fd);
+        return -1;
     }
 
-    ret = bind(listenFd_, (struct sockaddr*)&addr, sizeof(addr));
+    ret = bind(fd, (struct sockaddr*)&addr, sizeof(addr));
     if (ret < 0) {
-        LOG_ERROR("Bind Port:{} error!", port_);
-        close(listenFd_);
-        return false;
+        LOG_ERROR("Bind Port:{} error!", port);
+        close(fd);
+        return -1;
+    }
+    if (port == 0) {
+        socklen_t len = sizeof(addr);
+        getsockname(fd, (struct sockaddr*)&addr, &len);
+        port = ntohs(addr.sin_port);
     }
 
-    ret = listen(listenFd_, 6);
+    ret = listen(fd, config.backlog);
     if (ret < 0) {
-        LOG_ERROR("Listen port:{} error!", port_);
-        close(listenFd_);
+        LOG_ERROR("Listen port:{} error!", port);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool WebServer::CreateListenFd_()
+{
+    listenFd_ = CreateListenSocket(config_, port_);
+    return listenFd_ >= 0;
+}
+
+bool WebServer::InitSocket_()
+{
+    if (listenFd_ >= 0) {
+        /* prefork模式：master已经创建好 */
+        struct sockaddr_in addr;
+        socklen_t len = sizeof(addr);
+        if (getsockname(listenFd_, (struct sockaddr*)&addr, &len) == 0) {
+            port_ = ntohs(addr.sin_port);
+        }
+    } else if (!InheritListenFd_() && !CreateListenFd_()) {
         return false;
     }
-    ret = epoller_->AddFd(listenFd_, listenEvent_ | EPOLLIN);
-    if (ret == 0) {
+    if (!epoller_->AddFd(listenFd_, listenEvent_ | EPOLLIN)) {
         LOG_ERROR("Add listen error!");
         close(listenFd_);
         return false;
     }
     SetFdNonblock(listenFd_);
+    if (wakeFd_ < 0 || !epoller_->AddFd(wakeFd_, EPOLLIN)) {
+        LOG_ERROR("Create wake fd error!");
+        close(listenFd_);
+        return false;
+    }
     LOG_INFO("Server port:{}", port_);
     return true;
 }
@@ -17,35 +17,66 @@
 #include <unordered_map>
 #include <fcntl.h>       // fcntl()
 #include <unistd.h>      // close()
+#include <sys/eventfd.h>
+#include <signal.h>
+#include <atomic>
+#include <string>
+#include <vector>
 #include <assert.h>
 #include <errno.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
 #include <arpa/inet.h>
 #include <filesystem>
 
 #include "epoller.h"
+#include "../config/config.h"
 #include "../log/log.h"
 #include "../timer/heaptimer.h"
-#include "../pool/sqlconnpool.h"
-#include "../pool/threadpool.h"
-#include "../pool/sqlconnRAII.h"
+#include "../pool/executors.h"
+#include "../store/userstore.h"
 #include "../http/httpconn.h"
 #include "../iplist/iplist.h"
+#include "../iplist/iplimiter.h"
+#include "../iplist/ipacl.h"
+#include "../iplist/analytics.h"
+#include "../metrics/metrics.h"
+#include "../metrics/slowlog.h"
+#include "../metrics/probes.h"
+#include "../metrics/sharedstats.h"
+
+/* prefork模式下由Master传给每个worker进程 */
+struct WorkerContext {
+    int id = -1;                    // -1为单进程模式
+    int listenFd = -1;              // master创建的SO_REUSEPORT监听socket
+    SharedStats* stats = nullptr;   // 定期把本进程的计数写入stats->Slot(id)
+};
 
 class WebServer {
 public:
-    WebServer(
-        int port, int trigMode, int timeoutMS, bool OptLinger, 
-        int sqlPort, const char* sqlUser, const  char* sqlPwd, 
-        const char* dbName, int connPoolNum, int threadNum,
-        bool openLog, int logLevel, int logQueSize);
+    explicit WebServer(const ServerConfig& config, const WorkerContext& worker = WorkerContext());
 
     ~WebServer();
     void Start();
+    void Stop(); // 可在其他线程调用，Start返回后才能析构
+
+    int Port() const { return port_; } // 构造时port为0则是内核分配的端口
+    bool IsClosed() const { return isClose_; }
+    void SetIpLimits(int maxConnPerIp, double ratePerSec, double burst); // 0为不限制
+
+    /* 处理SIGHUP(重新读取配置)和SIGUSR2(平滑升级)，需要原始命令行：
+       重载时重新解析，升级时用同样的参数exec当前可执行文件
+       SIGTERM/SIGINT不依赖命令行：停止accept，已有请求处理完(响应带Connection: close)后退出 */
+    void SetCommandLine(int argc, char* argv[]);
+
+    /* 按config创建并listen，port为0时写回内核分配的端口；失败返回-1。Master也用它创建监听socket */
+    static int CreateListenSocket(const ServerConfig& config, int& port);
 
 private:
     bool InitSocket_(); 
+    bool CreateListenFd_();
     void InitEventMode_(int trigMode);
     void AddClient_(int fd, sockaddr_in addr);
   
@@ -54,32 +85,86 @@ private:
     void DealRead_(HttpConn* client);
 
     void SendError_(int fd, const char*info);
+    void SendReject_(HttpConn* client, int code); // 429 / 503，发送后关闭连接
     void ExtentTime_(HttpConn* client);
     void CloseConn_(HttpConn* client);
 
     void OnRead_(HttpConn* client);
     void OnWrite_(HttpConn* client);
     void OnProcess(HttpConn* client);
+    void Offload_(HttpConn* client);
+    void InitAuth_();
+    void InitMetrics_(); // 注册/metrics及各项指标，须在store_和executors_创建之后调用
+    void CountStatus_(int code);
+    void PublishStats_(); // prefork模式下把计数写入共享内存
+
+    /* 信号处理函数只记下信号并写wakeFd_，实际处理在事件循环里 */
+    void InitSignals_();
+    static void OnSignal_(int sig);
+    void HandleSignals_();
+    void Reload_();
+    void Upgrade_();
+    void OnUpgradeReady_();
+    void BeginDrain_();
+    void Shutdown_();
+    bool InheritListenFd_();
 
-    static const int MAX_FD = 65536;
+    static const int MAX_UPGRADE_FD = 65536 + 1024; // 不支持close_range时逐个关闭的上限
 
     static int SetFdNonblock(int fd);
 
+    ServerConfig config_;
+    WorkerContext worker_;
     int port_;
     bool openLinger_;
     int timeoutMS_;  /* 毫秒MS */
-    bool isClose_;
+    std::atomic<bool> isClose_;
     int listenFd_;
+    int wakeFd_;     /* Stop和信号处理函数写入以唤醒epoll_wait */
+
+    /* 平滑升级：旧进程把监听fd和一个管道的写端交给新进程，新进程初始化完成后写一个字节，
+       旧进程随即停止accept并排空已有连接后退出 */
+    std::vector<std::string> args_;
+    std::string exePath_;
+    pid_t upgradePid_;
+    int upgradeFd_;  /* 旧进程：管道读端 */
+    int readyFd_;    /* 新进程：继承来的管道写端 */
+    bool draining_;
+    bool shutdownRequested_; /* 收到过SIGTERM/SIGINT，再收到一次则不再等待 */
+    int64_t drainDeadlineMs_;
+    static std::atomic<int> pendingSignals_;
+    static int signalWakeFd_;
     string srcDir_;
     
     uint32_t listenEvent_;
     uint32_t connEvent_;
    
     std::unique_ptr<HeapTimer> timer_;
-    std::unique_ptr<ThreadPool> threadpool_;
     std::unique_ptr<Epoller> epoller_;
     std::unordered_map<int, HttpConn> users_;
     std::unique_ptr<iplist> iplist_;
+    std::unique_ptr<IpLimiter> limiter_;
+    std::unique_ptr<IpAcl> acl_;
+    std::unique_ptr<Analytics> analytics_;
+    std::unique_ptr<SlowLog> slowLog_;
+    std::unique_ptr<UserStore> store_;
+    std::unique_ptr<Executors> executors_; // io/cpu/db线程池，放在最后使其最先析构
+    ThreadPool* ioPool_;
+
+    /* 指标对象归Metrics所有，进程内一直有效 */
+    Counter* accepted_;
+    Counter* refusedAcl_;
+    Counter* refusedLimit_;
+    Counter* refusedFull_;
+    Counter* bytesIn_;
+    Counter* bytesOut_;
+    Counter* statusOther_;
+    Counter* slowTotal_;
+    std::unordered_map<int, Counter*> statusTotal_; // 初始化后只读
+    Histogram* parseLatency_;
+    Histogram* handleLatency_;
+    Histogram* writeLatency_;
+    Histogram* requestLatency_;
 };
 
 
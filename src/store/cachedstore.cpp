@@ -0,0 +1,156 @@
+#include "cachedstore.h"
+#include <assert.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <random>
+using namespace std;
+
+CachedUserStore::CachedUserStore(unique_ptr<UserStore> backend, int ttlMs, int negativeTtlMs, size_t capacity)
+    : backend_(std::move(backend))
+    , ttlUs_(ttlMs * 1000LL)
+    , negativeTtlUs_(negativeTtlMs * 1000LL)
+    , capacityPerShard_(max<size_t>(capacity / SHARD_NUM, 1))
+    , shards_(new Shard[SHARD_NUM])
+    , hits_(0)
+    , misses_(0)
+{
+    assert(backend_);
+}
+
+int64_t CachedUserStore::NowUs_()
+{
+    return chrono::duration_cast<chrono::microseconds>(
+        chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+CachedUserStore::Shard& CachedUserStore::ShardOf_(const string& name)
+{
+    return shards_[hash<string>()(name) % SHARD_NUM];
+}
+
+CachedUserStore::Entry* CachedUserStore::Find_(Shard& shard, const string& name, int64_t nowUs)
+{
+    auto it = shard.entries.find(name);
+    if (it == shard.entries.end()) {
+        return nullptr;
+    }
+    if (it->second.expireUs <= nowUs) {
+        shard.entries.erase(it);
+        return nullptr;
+    }
+    return &it->second;
+}
+
+void CachedUserStore::Digest_(const uint8_t* salt, const string& pwd, uint8_t* out)
+{
+    Sha256 sha;
+    sha.Update(salt, SALT_LEN);
+    sha.Update(pwd.data(), pwd.size());
+    sha.Final(out);
+}
+
+/* 比较耗时与第一个不同字节的位置无关 */
+bool CachedUserStore::Equal_(const uint8_t* a, const uint8_t* b, size_t len)
+{
+    uint8_t diff = 0;
+    for (size_t i = 0; i < len; i++) {
+        diff |= a[i] ^ b[i];
+    }
+    return diff == 0;
+}
+
+void CachedUserStore::Put_(const string& name, bool exists, const string* pwd)
+{
+    int64_t nowUs = NowUs_();
+    Entry entry;
+    entry.exists = exists;
+    entry.hasDigest = pwd != nullptr;
+    entry.expireUs = nowUs + (exists ? ttlUs_ : negativeTtlUs_);
+    if (pwd) {
+        thread_local mt19937_64 rng(random_device{}());
+        for (size_t i = 0; i < SALT_LEN; i += 8) {
+            uint64_t r = rng();
+            memcpy(entry.salt + i, &r, 8);
+        }
+        Digest_(entry.salt, *pwd, entry.digest);
+    }
+    Shard& shard = ShardOf_(name);
+    lock_guard<mutex> locker(shard.mtx);
+    size_t capacity = capacityPerShard_;
+    if (shard.entries.size() >= capacity && !shard.entries.count(name)) {
+        for (auto it = shard.entries.begin(); it != shard.entries.end();) {
+            it = it->second.expireUs <= nowUs ? shard.entries.erase(it) : next(it);
+        }
+        while (shard.entries.size() >= capacity) {
+            shard.entries.erase(shard.entries.begin());
+        }
+    }
+    shard.entries[name] = entry;
+}
+
+void CachedUserStore::SetLimits(int ttlMs, int negativeTtlMs, size_t capacity)
+{
+    ttlUs_ = ttlMs * 1000LL;
+    negativeTtlUs_ = negativeTtlMs * 1000LL;
+    capacityPerShard_ = max<size_t>(capacity / SHARD_NUM, 1);
+}
+
+void CachedUserStore::Invalidate(const string& name)
+{
+    Shard& shard = ShardOf_(name);
+    lock_guard<mutex> locker(shard.mtx);
+    shard.entries.erase(name);
+}
+
+AuthResult CachedUserStore::Login(const string& name, const string& pwd)
+{
+    {
+        Shard& shard = ShardOf_(name);
+        lock_guard<mutex> locker(shard.mtx);
+        Entry* entry = Find_(shard, name, NowUs_());
+        if (entry && !entry->exists) {
+            hits_++;
+            return AuthResult::NO_USER;
+        }
+        if (entry && entry->hasDigest) {
+            hits_++;
+            uint8_t digest[Sha256::DIGEST_LEN];
+            Digest_(entry->salt, pwd, digest);
+            return Equal_(digest, entry->digest, sizeof(digest)) ? AuthResult::OK : AuthResult::BAD_PASSWORD;
+        }
+    }
+    misses_++;
+    AuthResult ret = backend_->Login(name, pwd);
+    if (ret == AuthResult::OK) {
+        Put_(name, true, &pwd);
+    } else if (ret == AuthResult::NO_USER) {
+        Put_(name, false, nullptr);
+    }
+    return ret;
+}
+
+AuthResult CachedUserStore::Register(const string& name, const string& pwd)
+{
+    {
+        Shard& shard = ShardOf_(name);
+        lock_guard<mutex> locker(shard.mtx);
+        Entry* entry = Find_(shard, name, NowUs_());
+        if (entry && entry->exists) {
+            hits_++;
+            return AuthResult::USER_EXISTS;
+        }
+    }
+    misses_++;
+    AuthResult ret = backend_->Register(name, pwd);
+    if (ret == AuthResult::OK) {
+        /* 覆盖之前"用户不存在"的负缓存 */
+        Put_(name, true, &pwd);
+    } else if (ret == AuthResult::USER_EXISTS) {
+        Put_(name, true, nullptr);
+    } else {
+        Invalidate(name);
+    }
+    return ret;
+}
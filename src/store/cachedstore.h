@@ -0,0 +1,74 @@
+#ifndef CACHEDSTORE_H
+#define CACHEDSTORE_H
+/*
+认证结果的读穿透缓存，包在任意UserStore外面
+1. 登录成功后缓存 SHA-256(salt + password)，每个条目各自一份随机salt，内存里不留明文密码
+   之后同一用户在TTL内登录只算一次哈希，不访问后端；摘要不匹配直接判为BAD_PASSWORD
+2. 后端回答"用户不存在"时做负缓存(较短的TTL)，注册时"用户名已被占用"也直接由缓存回答
+3. 注册成功会覆盖该用户名的负缓存条目
+4. UNAVAILABLE 不缓存，后端恢复后立即生效
+按用户名哈希分片加锁；每片条目数有上限，满了先清过期条目，仍满则随意淘汰到低于上限
+*/
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "userstore.h"
+#include "sha256.h"
+
+class CachedUserStore : public UserStore {
+public:
+    explicit CachedUserStore(std::unique_ptr<UserStore> backend,
+                             int ttlMs = 60000, int negativeTtlMs = 5000, size_t capacity = 65536);
+
+    AuthResult Login(const std::string& name, const std::string& pwd) override;
+    AuthResult Register(const std::string& name, const std::string& pwd) override;
+    bool Blocking() const override { return backend_->Blocking(); }
+    const char* Name() const override { return backend_->Name(); }
+
+    /* 移除某个用户的缓存，例如在别处修改了密码之后 */
+    void Invalidate(const std::string& name);
+
+    /* 运行时调整(SIGHUP重载)；已缓存条目保留原有过期时间，容量缩小后在下次插入时逐步淘汰 */
+    void SetLimits(int ttlMs, int negativeTtlMs, size_t capacity);
+
+    uint64_t Hits() const { return hits_; }
+    uint64_t Misses() const { return misses_; }
+
+private:
+    static const size_t SHARD_NUM = 64;
+    static const size_t SALT_LEN = 16;
+
+    struct Entry {
+        bool exists;                        // false 为负缓存：用户不存在
+        bool hasDigest;                     // 只有登录/注册成功过才有摘要
+        uint8_t salt[SALT_LEN];
+        uint8_t digest[Sha256::DIGEST_LEN];
+        int64_t expireUs;
+    };
+
+    struct alignas(64) Shard {
+        std::mutex mtx;
+        std::unordered_map<std::string, Entry> entries;
+    };
+
+    Shard& ShardOf_(const std::string& name);
+    /* 调用方持有shard.mtx；过期条目视为不存在并顺手删除 */
+    Entry* Find_(Shard& shard, const std::string& name, int64_t nowUs);
+    void Put_(const std::string& name, bool exists, const std::string* pwd);
+    static void Digest_(const uint8_t* salt, const std::string& pwd, uint8_t* out);
+    static bool Equal_(const uint8_t* a, const uint8_t* b, size_t len);
+    static int64_t NowUs_();
+
+    std::unique_ptr<UserStore> backend_;
+    std::atomic<int64_t> ttlUs_;
+    std::atomic<int64_t> negativeTtlUs_;
+    std::atomic<size_t> capacityPerShard_;
+    std::unique_ptr<Shard[]> shards_;
+
+    std::atomic<uint64_t> hits_;
+    std::atomic<uint64_t> misses_;
+};
+
+#endif // CACHEDSTORE_H
@@ -0,0 +1,38 @@
+#include "memorystore.h"
+#include <functional>
+using namespace std;
+
+MemoryUserStore::MemoryUserStore() : shards_(new Shard[SHARD_NUM]) {}
+
+MemoryUserStore::Shard& MemoryUserStore::ShardOf_(const string& name)
+{
+    return shards_[hash<string>()(name) % SHARD_NUM];
+}
+
+AuthResult MemoryUserStore::Login(const string& name, const string& pwd)
+{
+    Shard& shard = ShardOf_(name);
+    lock_guard<mutex> locker(shard.mtx);
+    auto it = shard.users.find(name);
+    if (it == shard.users.end()) {
+        return AuthResult::NO_USER;
+    }
+    return it->second == pwd ? AuthResult::OK : AuthResult::BAD_PASSWORD;
+}
+
+AuthResult MemoryUserStore::Register(const string& name, const string& pwd)
+{
+    Shard& shard = ShardOf_(name);
+    lock_guard<mutex> locker(shard.mtx);
+    return shard.users.emplace(name, pwd).second ? AuthResult::OK : AuthResult::USER_EXISTS;
+}
+
+size_t MemoryUserStore::Size()
+{
+    size_t n = 0;
+    for (size_t i = 0; i < SHARD_NUM; i++) {
+        lock_guard<mutex> locker(shards_[i].mtx);
+        n += shards_[i].users.size();
+    }
+    return n;
+}
@@ -0,0 +1,34 @@
+#ifndef MEMORYSTORE_H
+#define MEMORYSTORE_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "userstore.h"
+
+/* 按用户名哈希分片，每片一把锁，不同用户的登录互不竞争 */
+class MemoryUserStore : public UserStore {
+public:
+    MemoryUserStore();
+
+    AuthResult Login(const std::string& name, const std::string& pwd) override;
+    AuthResult Register(const std::string& name, const std::string& pwd) override;
+    bool Blocking() const override { return false; }
+    const char* Name() const override { return "memory"; }
+
+    size_t Size();
+
+private:
+    struct alignas(64) Shard {
+        std::mutex mtx;
+        std::unordered_map<std::string, std::string> users;
+    };
+    static const size_t SHARD_NUM = 64;
+
+    Shard& ShardOf_(const std::string& name);
+
+    std::unique_ptr<Shard[]> shards_;
+};
+
+#endif // MEMORYSTORE_H
@@ -0,0 +1,123 @@
+#include "mysqlstore.h"
+#include <string.h>
+#include "../pool/sqlconnpool.h"
+#include "../pool/sqlconnRAII.h"
+#include "../metrics/metrics.h"
+
+#undef LOG_MODULE
+#define LOG_MODULE LOG_MOD_POOL
+
+using namespace std;
+
+MysqlUserStore::MysqlUserStore(const StoreConfig& config)
+{
+    SqlConnPool::Instance()->Init(config.host.c_str(), config.port, config.user.c_str(), config.pwd.c_str(),
+                                  config.dbName.c_str(), config.connPoolNum,
+                                  config.connPoolMax > 0 ? config.connPoolMax : config.connPoolNum * 2,
+                                  config.acquireTimeoutMs, config.healthIntervalMs);
+    /* 抓取时从GetStats中读出对应字段 */
+    auto stat = [](auto field) {
+        return [field]() { return double(SqlConnPool::Instance()->GetStats().*field); };
+    };
+    Metrics* m = Metrics::Instance();
+    const char* connHelp = "MySQL connections by state";
+    m->NewCallback("sqlpool_connections", connHelp, "gauge", stat(&SqlConnPool::Stats::idle), "state=\"idle\"", this);
+    m->NewCallback("sqlpool_connections", connHelp, "gauge", stat(&SqlConnPool::Stats::inUse), "state=\"in_use\"", this);
+    m->NewCallback("sqlpool_acquire_timeouts_total", "GetConn calls that returned no connection", "counter",
+                   stat(&SqlConnPool::Stats::timeouts), "", this);
+    m->NewCallback("sqlpool_reconnects_total", "Dead connections replaced by a fresh one", "counter",
+                   stat(&SqlConnPool::Stats::reconnects), "", this);
+}
+
+MysqlUserStore::~MysqlUserStore()
+{
+    Metrics::Instance()->Unregister(this);
+    SqlConnPool::Instance()->ClosePool();
+}
+
+static void BindString(MYSQL_BIND& bind, const string& str, unsigned long& len)
+{
+    memset(&bind, 0, sizeof(bind));
+    len = str.size();
+    bind.buffer_type = MYSQL_TYPE_STRING;
+    bind.buffer = const_cast<char*>(str.data());
+    bind.buffer_length = len;
+    bind.length = &len;
+}
+
+/* 查询用户的密码；预编译语句 + 二进制绑定，用户名不会被拼进SQL */
+static AuthResult FetchPassword(MYSQL* sql, const string& name, string& password)
+{
+    MYSQL_BIND param;
+    unsigned long nameLen = 0;
+    BindString(param, name, nameLen);
+    MYSQL_STMT* stmt = SqlConnPool::Instance()->Execute(sql, STMT_USER_SELECT, &param);
+    if (!stmt) {
+        return AuthResult::UNAVAILABLE;
+    }
+    char buff[256] = { 0 };
+    unsigned long len = 0;
+    bool isNull = false;
+    MYSQL_BIND result;
+    memset(&result, 0, sizeof(result));
+    result.buffer_type = MYSQL_TYPE_STRING;
+    result.buffer = buff;
+    result.buffer_length = sizeof(buff);
+    result.length = &len;
+    result.is_null = &isNull;
+
+    AuthResult ret = AuthResult::UNAVAILABLE;
+    if (!mysql_stmt_bind_result(stmt, &result) && !mysql_stmt_store_result(stmt)) {
+        int fetch = mysql_stmt_fetch(stmt);
+        if (fetch == 0 || fetch == MYSQL_DATA_TRUNCATED) {
+            password.assign(buff, isNull ? 0 : min<unsigned long>(len, sizeof(buff)));
+            ret = AuthResult::OK;
+        } else if (fetch == MYSQL_NO_DATA) {
+            ret = AuthResult::NO_USER;
+        }
+    }
+    mysql_stmt_free_result(stmt);
+    return ret;
+}
+
+AuthResult MysqlUserStore::Login(const string& name, const string& pwd)
+{
+    MYSQL* sql;
+    SqlConnRAII guard(&sql, SqlConnPool::Instance());
+    if (!sql) {
+        LOG_WARN("No MySQL connection available, login {} failed", name);
+        return AuthResult::UNAVAILABLE;
+    }
+    string password;
+    AuthResult ret = FetchPassword(sql, name, password);
+    if (ret != AuthResult::OK) {
+        return ret;
+    }
+    return password == pwd ? AuthResult::OK : AuthResult::BAD_PASSWORD;
+}
+
+AuthResult MysqlUserStore::Register(const string& name, const string& pwd)
+{
+    MYSQL* sql;
+    SqlConnRAII guard(&sql, SqlConnPool::Instance());
+    if (!sql) {
+        LOG_WARN("No MySQL connection available, register {} failed", name);
+        return AuthResult::UNAVAILABLE;
+    }
+    string password;
+    AuthResult ret = FetchPassword(sql, name, password);
+    if (ret == AuthResult::OK) {
+        return AuthResult::USER_EXISTS;
+    } else if (ret != AuthResult::NO_USER) {
+        return ret;
+    }
+    MYSQL_BIND params[2];
+    unsigned long nameLen = 0, pwdLen = 0;
+    BindString(params[0], name, nameLen);
+    BindString(params[1], pwd, pwdLen);
+    if (!SqlConnPool::Instance()->Execute(sql, STMT_USER_INSERT, params)) {
+        LOG_WARN("Insert user {} error!", name);
+        return AuthResult::UNAVAILABLE;
+    }
+    return AuthResult::OK;
+}
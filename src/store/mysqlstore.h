@@ -0,0 +1,18 @@
+#ifndef MYSQLSTORE_H
+#define MYSQLSTORE_H
+
+#include "userstore.h"
+
+/* user(username, password) 表，连接与预编译语句由SqlConnPool管理 */
+class MysqlUserStore : public UserStore {
+public:
+    /* 构造时初始化连接池，析构时关闭 */
+    explicit MysqlUserStore(const StoreConfig& config);
+    ~MysqlUserStore() override;
+
+    AuthResult Login(const std::string& name, const std::string& pwd) override;
+    AuthResult Register(const std::string& name, const std::string& pwd) override;
+    const char* Name() const override { return "mysql"; }
+};
+
+#endif // MYSQLSTORE_H
@@ -0,0 +1,127 @@
+#ifndef SHA256_H
+#define SHA256_H
+/*
+SHA-256 (FIPS 180-4)，只用于认证缓存里的加盐密码摘要，不依赖OpenSSL
+*/
+#include <stdint.h>
+#include <string.h>
+#include <stddef.h>
+
+class Sha256 {
+public:
+    static const size_t DIGEST_LEN = 32;
+
+    Sha256() { Reset(); }
+
+    void Reset() {
+        static const uint32_t INIT[8] = {
+            0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+            0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+        };
+        memcpy(state_, INIT, sizeof(state_));
+        len_ = 0;
+        bufLen_ = 0;
+    }
+
+    void Update(const void* data, size_t len) {
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        len_ += len;
+        while (len > 0) {
+            size_t n = len < 64 - bufLen_ ? len : 64 - bufLen_;
+            memcpy(buf_ + bufLen_, p, n);
+            bufLen_ += n;
+            p += n;
+            len -= n;
+            if (bufLen_ == 64) {
+                Transform_(buf_);
+                bufLen_ = 0;
+            }
+        }
+    }
+
+    void Final(uint8_t out[DIGEST_LEN]) {
+        uint64_t bits = len_ * 8;
+        uint8_t pad = 0x80;
+        Update(&pad, 1);
+        pad = 0;
+        while (bufLen_ != 56) {
+            Update(&pad, 1);
+        }
+        uint8_t lenBytes[8];
+        for (int i = 0; i < 8; i++) {
+            lenBytes[i] = static_cast<uint8_t>(bits >> (56 - 8 * i));
+        }
+        Update(lenBytes, 8);
+        for (int i = 0; i < 8; i++) {
+            out[4 * i] = static_cast<uint8_t>(state_[i] >> 24);
+            out[4 * i + 1] = static_cast<uint8_t>(state_[i] >> 16);
+            out[4 * i + 2] = static_cast<uint8_t>(state_[i] >> 8);
+            out[4 * i + 3] = static_cast<uint8_t>(state_[i]);
+        }
+    }
+
+    static void Hash(const void* data, size_t len, uint8_t out[DIGEST_LEN]) {
+        Sha256 sha;
+        sha.Update(data, len);
+        sha.Final(out);
+    }
+
+private:
+    static uint32_t Rotr_(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+    void Transform_(const uint8_t block[64]) {
+        static const uint32_t K[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+        };
+        uint32_t w[64];
+        for (int i = 0; i < 16; i++) {
+            w[i] = (uint32_t(block[4 * i]) << 24) | (uint32_t(block[4 * i + 1]) << 16) |
+                   (uint32_t(block[4 * i + 2]) << 8) | uint32_t(block[4 * i + 3]);
+        }
+        for (int i = 16; i < 64; i++) {
+            uint32_t s0 = Rotr_(w[i - 15], 7) ^ Rotr_(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = Rotr_(w[i - 2], 17) ^ Rotr_(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        uint32_t a = state_[0], b = state_[1], c = state_[2], d = state_[3];
+        uint32_t e = state_[4], f = state_[5], g = state_[6], h = state_[7];
+        for (int i = 0; i < 64; i++) {
+            uint32_t s1 = Rotr_(e, 6) ^ Rotr_(e, 11) ^ Rotr_(e, 25);
+            uint32_t ch = (e & f) ^ (~e & g);
+            uint32_t t1 = h + s1 + ch + K[i] + w[i];
+            uint32_t s0 = Rotr_(a, 2) ^ Rotr_(a, 13) ^ Rotr_(a, 22);
+            uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+            uint32_t t2 = s0 + maj;
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        state_[0] += a;
+        state_[1] += b;
+        state_[2] += c;
+        state_[3] += d;
+        state_[4] += e;
+        state_[5] += f;
+        state_[6] += g;
+        state_[7] += h;
+    }
+
+    uint32_t state_[8];
+    uint64_t len_;
+    uint8_t buf_[64];
+    size_t bufLen_;
+};
+
+#endif // SHA256_H
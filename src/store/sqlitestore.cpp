@@ -0,0 +1,99 @@
+#include "sqlitestore.h"
+#include "../log/log.h"
+
+#undef LOG_MODULE
+#define LOG_MODULE LOG_MOD_POOL
+
+using namespace std;
+
+SqliteUserStore::SqliteUserStore(const string& path)
+    : db_(nullptr), selectStmt_(nullptr), insertStmt_(nullptr)
+{
+    if (sqlite3_open_v2(path.c_str(), &db_, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX,
+                        nullptr) != SQLITE_OK) {
+        LOG_ERROR("Open sqlite {} error:{}", path, db_ ? sqlite3_errmsg(db_) : "out of memory");
+        Close_();
+        return;
+    }
+    sqlite3_busy_timeout(db_, 2000);
+    const char* init = "PRAGMA journal_mode=WAL;"
+                       "PRAGMA synchronous=NORMAL;"
+                       "CREATE TABLE IF NOT EXISTS user("
+                       "username TEXT PRIMARY KEY NOT NULL, password TEXT NOT NULL);";
+    char* err = nullptr;
+    if (sqlite3_exec(db_, init, nullptr, nullptr, &err) != SQLITE_OK ||
+        sqlite3_prepare_v2(db_, "SELECT password FROM user WHERE username = ?", -1, &selectStmt_, nullptr) != SQLITE_OK ||
+        sqlite3_prepare_v2(db_, "INSERT INTO user(username, password) VALUES(?, ?)", -1, &insertStmt_, nullptr) != SQLITE_OK) {
+        LOG_ERROR("Init sqlite {} error:{}", path, err ? err : sqlite3_errmsg(db_));
+        sqlite3_free(err);
+        Close_();
+        return;
+    }
+    LOG_INFO("SqliteUserStore: {}", path);
+}
+
+SqliteUserStore::~SqliteUserStore()
+{
+    Close_();
+}
+
+void SqliteUserStore::Close_()
+{
+    sqlite3_finalize(selectStmt_);
+    sqlite3_finalize(insertStmt_);
+    selectStmt_ = insertStmt_ = nullptr;
+    if (db_) {
+        sqlite3_close(db_);
+        db_ = nullptr;
+    }
+}
+
+AuthResult SqliteUserStore::Login(const string& name, const string& pwd)
+{
+    lock_guard<mutex> locker(mtx_);
+    if (!db_) {
+        return AuthResult::UNAVAILABLE;
+    }
+    sqlite3_reset(selectStmt_);
+    sqlite3_bind_text(selectStmt_, 1, name.data(), static_cast<int>(name.size()), SQLITE_STATIC);
+    int rc = sqlite3_step(selectStmt_);
+    AuthResult ret;
+    if (rc == SQLITE_ROW) {
+        const char* password = reinterpret_cast<const char*>(sqlite3_column_text(selectStmt_, 0));
+        int len = sqlite3_column_bytes(selectStmt_, 0);
+        ret = password && pwd.compare(0, string::npos, password, len) == 0 ? AuthResult::OK : AuthResult::BAD_PASSWORD;
+    } else if (rc == SQLITE_DONE) {
+        ret = AuthResult::NO_USER;
+    } else {
+        LOG_WARN("sqlite select error:{}", sqlite3_errmsg(db_));
+        ret = AuthResult::UNAVAILABLE;
+    }
+    sqlite3_reset(selectStmt_);
+    sqlite3_clear_bindings(selectStmt_);
+    return ret;
+}
+
+AuthResult SqliteUserStore::Register(const string& name, const string& pwd)
+{
+    lock_guard<mutex> locker(mtx_);
+    if (!db_) {
+        return AuthResult::UNAVAILABLE;
+    }
+    sqlite3_reset(insertStmt_);
+    sqlite3_bind_text(insertStmt_, 1, name.data(), static_cast<int>(name.size()), SQLITE_STATIC);
+    sqlite3_bind_text(insertStmt_, 2, pwd.data(), static_cast<int>(pwd.size()), SQLITE_STATIC);
+    int rc = sqlite3_step(insertStmt_);
+    AuthResult ret;
+    if (rc == SQLITE_DONE) {
+        ret = AuthResult::OK;
+    } else if ((rc & 0xFF) == SQLITE_CONSTRAINT) {
+        /* 主键冲突：由数据库保证并发注册同名用户只有一个成功 */
+        ret = AuthResult::USER_EXISTS;
+    } else {
+        LOG_WARN("sqlite insert error:{}", sqlite3_errmsg(db_));
+        ret = AuthResult::UNAVAILABLE;
+    }
+    sqlite3_reset(insertStmt_);
+    sqlite3_clear_bindings(insertStmt_);
+    return ret;
+}
@@ -0,0 +1,34 @@
+#ifndef SQLITESTORE_H
+#define SQLITESTORE_H
+
+#include <mutex>
+#include <sqlite3.h>
+#include "userstore.h"
+
+/*
+嵌入式SQLite后端
+单个连接 + 互斥锁串行访问，两条语句在构造时预编译好，之后只做reset/bind
+WAL模式下读写互不阻塞，busy_timeout兜底其他进程持有写锁的情况
+*/
+class SqliteUserStore : public UserStore {
+public:
+    explicit SqliteUserStore(const std::string& path);
+    ~SqliteUserStore() override;
+
+    /* 数据库打开且建表成功 */
+    bool IsOpen() const { return db_ != nullptr; }
+
+    AuthResult Login(const std::string& name, const std::string& pwd) override;
+    AuthResult Register(const std::string& name, const std::string& pwd) override;
+    const char* Name() const override { return "sqlite"; }
+
+private:
+    void Close_();
+
+    std::mutex mtx_;
+    sqlite3* db_;
+    sqlite3_stmt* selectStmt_;
+    sqlite3_stmt* insertStmt_;
+};
+
+#endif // SQLITESTORE_H
@@ -0,0 +1,66 @@
+#include "userstore.h"
+#include "cachedstore.h"
+#include "memorystore.h"
+#include "mysqlstore.h"
+#include "sqlitestore.h"
+#include "../log/log.h"
+
+#undef LOG_MODULE
+#define LOG_MODULE LOG_MOD_POOL
+
+using namespace std;
+
+const char* AuthResultName(AuthResult result)
+{
+    switch (result) {
+    case AuthResult::OK:
+        return "ok";
+    case AuthResult::BAD_PASSWORD:
+        return "bad password";
+    case AuthResult::NO_USER:
+        return "no user";
+    case AuthResult::USER_EXISTS:
+        return "user exists";
+    default:
+        return "unavailable";
+    }
+}
+
+bool ParseStoreSpec(const string& spec, StoreConfig& config)
+{
+    string::size_type colon = spec.find(':');
+    string type = spec.substr(0, colon);
+    if (type == "sqlite") {
+        config.type = type;
+        config.path = colon == string::npos ? "./users.db" : spec.substr(colon + 1);
+        return true;
+    } else if ((type == "mysql" || type == "memory") && colon == string::npos) {
+        config.type = type;
+        return true;
+    }
+    return false;
+}
+
+unique_ptr<UserStore> NewUserStore(const StoreConfig& config)
+{
+    unique_ptr<UserStore> store;
+    if (config.type == "memory") {
+        return make_unique<MemoryUserStore>();
+    } else if (config.type == "sqlite") {
+        auto sqlite = make_unique<SqliteUserStore>(config.path);
+        if (!sqlite->IsOpen()) {
+            return nullptr;
+        }
+        store = std::move(sqlite);
+    } else if (config.type == "mysql") {
+        store = make_unique<MysqlUserStore>(config);
+    } else {
+        LOG_ERROR("Unknown user store type: {}", config.type);
+        return nullptr;
+    }
+    if (config.cacheTtlMs > 0) {
+        store = make_unique<CachedUserStore>(std::move(store), config.cacheTtlMs, config.negativeTtlMs,
+                                              config.cacheCapacity);
+    }
+    return store;
+}
@@ -0,0 +1,58 @@
+#ifndef USERSTORE_H
+#define USERSTORE_H
+/*
+用户账号存储的抽象，登录/注册只依赖这个接口
+1. MysqlUserStore  ：走SqlConnPool和预编译语句，会阻塞在网络IO上，需要放到DB线程池执行
+2. SqliteUserStore ：嵌入式数据库文件，没有网络往返，适合单机小规模部署
+3. MemoryUserStore ：分片加锁的哈希表，进程退出即丢失，用于测试和压测
+后端由配置串选择，见 NewUserStore
+*/
+#include <memory>
+#include <string>
+
+enum class AuthResult {
+    OK = 0,
+    BAD_PASSWORD,
+    NO_USER,
+    USER_EXISTS,
+    UNAVAILABLE,    // 后端不可用(连接池超时、数据库错误等)
+};
+
+const char* AuthResultName(AuthResult result);
+
+class UserStore {
+public:
+    virtual ~UserStore() = default;
+
+    virtual AuthResult Login(const std::string& name, const std::string& pwd) = 0;
+    virtual AuthResult Register(const std::string& name, const std::string& pwd) = 0;
+
+    /* 调用是否可能长时间阻塞；为false时直接在HTTP工作线程里执行，不必转交DB线程池 */
+    virtual bool Blocking() const { return true; }
+    virtual const char* Name() const = 0;
+};
+
+struct StoreConfig {
+    std::string type = "mysql";     // mysql / sqlite / memory
+    std::string path;               // sqlite数据库文件
+    std::string host = "localhost"; // 以下为mysql参数
+    int port = 3306;
+    std::string user;
+    std::string pwd;
+    std::string dbName;
+    int connPoolNum = 8;            // 最小连接数
+    int connPoolMax = 0;            // 0为connPoolNum的两倍
+    int acquireTimeoutMs = 500;
+    int healthIntervalMs = 5000;
+    int cacheTtlMs = 60000;         // 认证缓存，0表示不启用；memory后端本身就在内存里，不再套缓存
+    int negativeTtlMs = 5000;
+    size_t cacheCapacity = 65536;
+};
+
+/* 未知类型或初始化失败返回nullptr */
+std::unique_ptr<UserStore> NewUserStore(const StoreConfig& config);
+
+/* 把 "mysql"、"memory"、"sqlite:./users.db" 形式的配置串解析进config */
+bool ParseStoreSpec(const std::string& spec, StoreConfig& config);
+
+#endif // USERSTORE_H
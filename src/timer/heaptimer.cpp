@@ -1,5 +1,6 @@
 #include "heaptimer.h"
 #include "../log/log.h"
+#include "../metrics/probes.h"
 #include <algorithm>
 #include <arpa/inet.h>
 #include <assert.h>
@@ -11,6 +12,9 @@
 #include <time.h>
 #include <unordered_map>
 
+#undef LOG_MODULE
+#define LOG_MODULE LOG_MOD_TIMER
+
 void HeapTimer::add(int id, int timeOut, TimeoutCallBack cb)
 {
     // Create a new timer node
@@ -87,7 +91,9 @@ void HeapTimer::tick()
         }
         
         // Execute callback
+        USDT_PROBE1(timer_fire, timer->id_);
         timer->cb_->operator()();
+        expired_.fetch_add(1, std::memory_order_relaxed);
         
         // Remove from set and map
         timers_.erase(it);
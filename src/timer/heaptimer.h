@@ -2,6 +2,7 @@
 #define HEAPTIMERH
 
 #include <algorithm>
+#include <atomic>
 #include <arpa/inet.h>
 #include <assert.h>
 #include <chrono>
@@ -46,6 +47,7 @@ class HeapTimer {
 private:
     std::set<std::shared_ptr<TimerNode>> timers_;
     std::unordered_map<int, std::weak_ptr<TimerNode>> map_; // fd -> weak_ptr to timernode
+    std::atomic<uint64_t> expired_{0}; // tick中到期触发的定时器总数，可在其他线程读取
 
 public:
     ~HeapTimer();
@@ -64,6 +66,8 @@ public:
     void del(int id);
 
     int GetNextTimeout();
+
+    uint64_t Expired() const { return expired_.load(std::memory_order_relaxed); }
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,58 @@
+#include "wallclock.h"
+#include <chrono>
+
+namespace {
+struct CachedSecond {
+    time_t sec = -1;
+    size_t len = 0;
+    char buf[40];
+};
+
+const char* const WEEKDAYS[] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+const char* const MONTHS[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+    "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+}
+
+int64_t WallClock::NowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+fmt::string_view WallClock::LogPrefix()
+{
+    return LogPrefix(NowNs());
+}
+
+fmt::string_view WallClock::LogPrefix(int64_t timeNs)
+{
+    thread_local CachedSecond cache;
+    time_t sec = static_cast<time_t>(timeNs / 1000000000);
+    if (sec != cache.sec) {
+        tm t;
+        localtime_r(&sec, &t);
+        auto res = fmt::format_to_n(cache.buf, sizeof(cache.buf), "{:04}-{:02}-{:02} {:02}:{:02}:{:02} ",
+            t.tm_year + 1900, t.tm_mon + 1, t.tm_mday,
+            t.tm_hour, t.tm_min, t.tm_sec);
+        cache.len = res.size;
+        cache.sec = sec;
+    }
+    return fmt::string_view(cache.buf, cache.len);
+}
+
+fmt::string_view WallClock::HttpDate()
+{
+    thread_local CachedSecond cache;
+    time_t sec = time(nullptr);
+    if (sec != cache.sec) {
+        tm t;
+        gmtime_r(&sec, &t);
+        auto res = fmt::format_to_n(cache.buf, sizeof(cache.buf), "{}, {:02} {} {:04} {:02}:{:02}:{:02} GMT",
+            WEEKDAYS[t.tm_wday], t.tm_mday, MONTHS[t.tm_mon], t.tm_year + 1900,
+            t.tm_hour, t.tm_min, t.tm_sec);
+        cache.len = res.size;
+        cache.sec = sec;
+    }
+    return fmt::string_view(cache.buf, cache.len);
+}
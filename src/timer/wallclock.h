@@ -0,0 +1,26 @@
+#ifndef WALLCLOCK_H
+#define WALLCLOCK_H
+/*
+日志行、访问日志和HTTP Date头共用的墙上时钟
+1. 格式化好的字符串按线程缓存，每秒最多重新生成一次，
+   localtime_r/gmtime_r(以及它们背后glibc的时区锁)不在热路径上
+2. 返回的string_view在同一线程请求另一秒之前一直有效
+*/
+#include <stdint.h>
+#include <time.h>
+#include <fmt/format.h>
+
+class WallClock {
+public:
+    /* system_clock的纳秒时间戳 */
+    static int64_t NowNs();
+
+    /* 本地时间 "YYYY-MM-DD HH:MM:SS "，末尾带一个空格 */
+    static fmt::string_view LogPrefix();
+    static fmt::string_view LogPrefix(int64_t timeNs);
+
+    /* RFC 7231 IMF-fixdate，例如 "Sun, 06 Nov 1994 08:49:37 GMT" */
+    static fmt::string_view HttpDate();
+};
+
+#endif // WALLCLOCK_H
@@ -0,0 +1,112 @@
+
+#include "gtest/gtest.h"
+#include <thread>
+#include "../src/iplist/analytics.cpp"
+
+static uint64_t SplitMix(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+// 测试HyperLogLog的估计误差在几个数量级上都在合理范围内
+TEST(AnalyticsTest, HyperLogLogAccuracy) {
+    for (uint64_t n : {100ull, 10000ull, 1000000ull}) {
+        HyperLogLog hll;
+        for (uint64_t i = 0; i < n; i++) {
+            hll.Add(SplitMix(i));
+            hll.Add(SplitMix(i)); // 重复元素不影响结果
+        }
+        double err = std::abs(static_cast<double>(hll.Estimate()) - n) / n;
+        EXPECT_LT(err, 0.05) << "n = " << n;
+    }
+}
+
+// 测试长尾流量中的热点key能被找出，且计数不会低估
+TEST(AnalyticsTest, HeavyHitters) {
+    HeavyHitters<uint32_t> hh(10);
+    uint64_t x = 1;
+    for (int round = 0; round < 1000; round++) {
+        for (uint32_t hot = 1; hot <= 3; hot++) {
+            for (uint32_t i = 0; i < hot * 10; i++) {
+                hh.Add(hot, SplitMix(hot));
+            }
+        }
+        for (int i = 0; i < 50; i++) {
+            x = x * 6364136223846793005ull + 1442695040888963407ull;
+            uint32_t cold = 1000 + static_cast<uint32_t>(x >> 40);
+            hh.Add(cold, SplitMix(cold));
+        }
+    }
+    auto top = hh.Top();
+    ASSERT_GE(top.size(), 3u);
+    EXPECT_EQ(top[0].key, 3u);
+    EXPECT_EQ(top[1].key, 2u);
+    EXPECT_EQ(top[2].key, 1u);
+    EXPECT_GE(top[0].count, 30000u);
+    EXPECT_LT(top[0].count, 30000u + 1000u);
+}
+
+// 测试JSON输出包含统计结果，路径中的特殊字符被转义
+TEST(AnalyticsTest, Json) {
+    Analytics stats(60, 5);
+    uint32_t ip = htonl(0x7F000001);
+    stats.RecordClient(ip);
+    stats.RecordRequest(ip, "/index.html");
+    stats.RecordRequest(ip, "/a\"b");
+    std::string json = stats.Json();
+    EXPECT_NE(json.find("\"ip\":\"127.0.0.1\",\"count\":2"), std::string::npos) << json;
+    EXPECT_NE(json.find("\"path\":\"/a\\\"b\""), std::string::npos) << json;
+    EXPECT_NE(json.find("\"unique_clients\":{\"current\":1,"), std::string::npos) << json;
+}
+
+// 测试合并两个HeavyHitters：两边都有的key计数相加，只在一边的key也保留
+TEST(AnalyticsTest, HeavyHittersMerge) {
+    HeavyHitters<uint32_t> a(3), b(3);
+    for (int i = 0; i < 100; i++) {
+        a.Add(1, SplitMix(1));
+        b.Add(1, SplitMix(1));
+    }
+    for (int i = 0; i < 150; i++) {
+        b.Add(2, SplitMix(2));
+    }
+    for (int i = 0; i < 10; i++) {
+        a.Add(3, SplitMix(3));
+        b.Add(4, SplitMix(4));
+    }
+    a.Merge(b);
+    auto top = a.Top();
+    ASSERT_EQ(top.size(), 3u);
+    EXPECT_EQ(top[0].key, 1u);
+    EXPECT_EQ(top[0].count, 200u);
+    EXPECT_EQ(top[1].key, 2u);
+    EXPECT_EQ(top[1].count, 150u);
+}
+
+// 测试多个线程写入不同分片，JSON输出是所有分片合并后的结果
+TEST(AnalyticsTest, ShardsMergeInJson) {
+    Analytics stats(60, 5);
+    const int threads = 8;
+    const int perThread = 1000;
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; t++) {
+        pool.emplace_back([&stats, t]() {
+            uint32_t own = htonl(0x0A000000 + t + 1);
+            uint32_t hot = htonl(0x7F000001);
+            stats.RecordClient(own);
+            for (int i = 0; i < perThread; i++) {
+                stats.RecordRequest(i % 2 ? hot : own, "/index.html");
+            }
+        });
+    }
+    for (auto& t : pool) {
+        t.join();
+    }
+    std::string json = stats.Json();
+    EXPECT_NE(json.find("\"requests\":{\"current\":8000,"), std::string::npos) << json;
+    EXPECT_NE(json.find("\"connections\":{\"current\":8,"), std::string::npos) << json;
+    EXPECT_NE(json.find("\"unique_clients\":{\"current\":8,"), std::string::npos) << json;
+    EXPECT_NE(json.find("\"top_ips\":{\"current\":[{\"ip\":\"127.0.0.1\",\"count\":4000}"), std::string::npos) << json;
+    EXPECT_NE(json.find("{\"path\":\"/index.html\",\"count\":8000}"), std::string::npos) << json;
+}
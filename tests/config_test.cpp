@@ -0,0 +1,114 @@
+#include "gtest/gtest.h"
+#include <stdio.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include "../src/config/config.cpp"
+
+static bool Parse(std::vector<const char*> args, ServerConfig& config, std::string& error) {
+    args.insert(args.begin(), "server");
+    bool help = false;
+    return ParseCommandLine(int(args.size()), const_cast<char**>(args.data()), config, error, help);
+}
+
+// 配置文件：注释、空白、名字形式的枚举值
+TEST(ConfigTest, LoadFile) {
+    char path[] = "/tmp/configtestXXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    const char text[] = "# comment\n"
+                        "port = 8080\n"
+                        "  io_threads=4   # trailing comment\n"
+                        "\n"
+                        "log_level = warn\n"
+                        "cpu_affinity = 0-2,5\n"
+                        "tcp_nodelay = on\n"
+                        "user_store = sqlite:./users.db\n"
+                        "conn_pool_max = 32\n"
+                        "log_total_mb = 0\n"
+                        "log_compress = off\n";
+    ASSERT_EQ(write(fd, text, sizeof(text) - 1), ssize_t(sizeof(text) - 1));
+    close(fd);
+
+    ServerConfig config;
+    std::string error;
+    EXPECT_TRUE(LoadConfigFile(path, config, error)) << error;
+    EXPECT_EQ(config.port, 8080);
+    EXPECT_EQ(config.ioThreads, 4);
+    EXPECT_EQ(config.logLevel, 2);
+    EXPECT_TRUE(config.tcpNoDelay);
+    EXPECT_EQ(config.userStore, "sqlite:./users.db");
+    EXPECT_EQ(config.connPoolMax, 32);
+    EXPECT_EQ(config.logFileMb, 64);
+    EXPECT_EQ(config.logTotalMb, 0);
+    EXPECT_FALSE(config.logCompress);
+    std::vector<int> cpus;
+    EXPECT_TRUE(ParseCpuList(config.cpuAffinity, cpus));
+    EXPECT_EQ(cpus, (std::vector<int>{ 0, 1, 2, 5 }));
+
+    // 命令行覆盖文件，与参数顺序无关
+    ServerConfig merged;
+    EXPECT_TRUE(Parse({ "--io-threads=16", "-c", path, "--no-tcp-nodelay", "--linger", "-p", "9000",
+                        "--conn-acquire-timeout-ms", "250", "--conn_health_interval_ms=1000" }, merged, error)) << error;
+    EXPECT_EQ(merged.ioThreads, 16);
+    EXPECT_EQ(merged.port, 9000);
+    EXPECT_FALSE(merged.tcpNoDelay);
+    EXPECT_TRUE(merged.linger);
+    EXPECT_EQ(merged.logLevel, 2);
+    EXPECT_EQ(merged.connPoolMax, 32);
+    EXPECT_EQ(merged.connAcquireTimeoutMs, 250);
+    EXPECT_EQ(merged.connHealthIntervalMs, 1000);
+    unlink(path);
+}
+
+TEST(ConfigTest, RejectsBadInput) {
+    ServerConfig config;
+    std::string error;
+    EXPECT_FALSE(SetConfigValue(config, "port", "70000", error));
+    EXPECT_FALSE(SetConfigValue(config, "io_threads", "4x", error));
+    EXPECT_FALSE(SetConfigValue(config, "no_such_key", "1", error));
+    EXPECT_FALSE(SetConfigValue(config, "cpu_affinity", "3-1", error));
+    EXPECT_FALSE(SetConfigValue(config, "log_mode", "fancy", error));
+    EXPECT_FALSE(SetConfigValue(config, "conn_health_interval_ms", "10", error));
+    EXPECT_FALSE(SetConfigValue(config, "log_file_mb", "0", error));
+    EXPECT_FALSE(Parse({ "--backlog" }, config, error));
+    EXPECT_FALSE(Parse({ "stray" }, config, error));
+    EXPECT_FALSE(Parse({ "-c", "/nonexistent/webserver.conf" }, config, error));
+    EXPECT_EQ(config.port, ServerConfig().port);
+
+    // 输出的配置可以原样读回
+    ServerConfig custom;
+    custom.backlog = 77;
+    custom.ipRate = 12.5;
+    custom.srcDir = "/srv/www";
+    std::string dump = DumpConfig(custom);
+    ServerConfig reloaded;
+    size_t start = 0;
+    while (start < dump.size()) {
+        size_t end = dump.find('\n', start);
+        std::string line = dump.substr(start, end - start);
+        size_t eq = line.find(" = ");
+        EXPECT_TRUE(SetConfigValue(reloaded, line.substr(0, eq), line.substr(eq + 3), error)) << line;
+        start = end + 1;
+    }
+    EXPECT_EQ(reloaded.backlog, 77);
+    EXPECT_EQ(reloaded.ipRate, 12.5);
+    EXPECT_EQ(reloaded.srcDir, "/srv/www");
+}
+
+TEST(ConfigTest, ParseLogLevels) {
+    std::vector<std::pair<std::string, int>> levels;
+    EXPECT_TRUE(ParseLogLevels("", levels));
+    EXPECT_TRUE(levels.empty());
+    EXPECT_TRUE(ParseLogLevels("http=debug, pool = 2,timer=off", levels));
+    EXPECT_EQ(levels, (std::vector<std::pair<std::string, int>>{ { "http", 0 }, { "pool", 2 }, { "timer", 4 } }));
+    EXPECT_FALSE(ParseLogLevels("http", levels));
+    EXPECT_FALSE(ParseLogLevels("http=verbose", levels));
+    EXPECT_FALSE(ParseLogLevels("=warn", levels));
+
+    ServerConfig config;
+    std::string error;
+    EXPECT_TRUE(Parse({ "--log-levels=http=debug,pool=warn" }, config, error)) << error;
+    EXPECT_EQ(config.logLevels, "http=debug,pool=warn");
+    EXPECT_FALSE(SetConfigValue(config, "log_levels", "http:debug", error));
+}
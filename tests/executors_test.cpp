@@ -0,0 +1,70 @@
+#include "gtest/gtest.h"
+#include <atomic>
+#include <chrono>
+#include <future>
+#include "../src/pool/executors.h"
+
+TEST(ExecutorsTest, GetByName) {
+    Executors executors;
+    ThreadPool* io = executors.Add("io", 2, 16);
+    ThreadPool* cpu = executors.Add("cpu", 1, 16);
+    EXPECT_EQ(executors.Get("io"), io);
+    EXPECT_EQ(executors.Get("cpu"), cpu);
+    EXPECT_EQ(executors.Get("db"), nullptr);
+    EXPECT_EQ(cpu->ThreadNum(), 1u);
+}
+
+TEST(ExecutorsTest, TryCommitRejectsWhenFull) {
+    Executors executors;
+    ThreadPool* pool = executors.Add("cpu", 1, 2);
+    executors.StartAll();
+
+    std::promise<void> gate;
+    std::shared_future<void> opened = gate.get_future().share();
+    std::atomic<int> started{0};
+    std::atomic<int> done{0};
+    auto blocked = [&, opened]() {
+        started++;
+        opened.wait();
+        done++;
+    };
+    ASSERT_TRUE(pool->TryCommit(blocked));
+    /* 等唯一的工作线程取走第一个任务，之后队列还能放2个 */
+    while (started == 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_TRUE(pool->TryCommit(blocked));
+    EXPECT_TRUE(pool->TryCommit(blocked));
+    EXPECT_FALSE(pool->TryCommit(blocked));
+    EXPECT_EQ(pool->Rejected(), 1u);
+
+    gate.set_value();
+    while (done < 3) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(pool->QueueSize(), 0u);
+    EXPECT_TRUE(pool->TryCommit([&]() { done++; }));
+}
+
+TEST(ExecutorsTest, WaitIdleWaitsForChainedTasks) {
+    Executors executors;
+    ThreadPool* io = executors.Add("io", 1, 16);
+    ThreadPool* cpu = executors.Add("cpu", 1, 16);
+    executors.StartAll();
+
+    std::promise<void> gate;
+    std::shared_future<void> opened = gate.get_future().share();
+    std::atomic<bool> done{false};
+    /* io上的任务再提交到cpu，WaitIdle须等到两者都完成 */
+    io->commit([&, opened]() {
+        opened.wait();
+        cpu->commit([&]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            done = true;
+        });
+    });
+    EXPECT_FALSE(executors.WaitIdle(30));
+    gate.set_value();
+    EXPECT_TRUE(executors.WaitIdle(2000));
+    EXPECT_TRUE(done);
+}
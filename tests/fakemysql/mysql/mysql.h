@@ -0,0 +1,98 @@
+#ifndef FAKE_MYSQL_H
+#define FAKE_MYSQL_H
+/*
+测试用的libmysqlclient替身，只实现连接池用到的那部分API，不需要真的MySQL服务端
+1. fakemysql::Restart() 模拟服务端重启：之前建立的连接全部变成断开状态，
+   之后在上面prepare/execute返回CR_SERVER_LOST，ping失败
+2. fakemysql::serverUp 为false时mysql_real_connect失败
+用法：编译测试时 -Ifakemysql，让 <mysql/mysql.h> 找到这里
+*/
+#include <atomic>
+#include "errmsg.h"
+
+namespace fakemysql {
+inline std::atomic<bool> serverUp(true);
+inline std::atomic<int> generation(0);      // 服务端"启动"的次数
+inline std::atomic<int> connects(0);        // mysql_real_connect成功的次数
+inline std::atomic<int> prepares(0);        // mysql_stmt_prepare成功的次数
+inline std::atomic<unsigned long> nextThreadId(0);
+
+inline void Restart(bool up = true) {
+    generation++;
+    serverUp = up;
+}
+}
+
+enum enum_field_types { MYSQL_TYPE_LONG = 3, MYSQL_TYPE_STRING = 254 };
+enum mysql_option { MYSQL_OPT_CONNECT_TIMEOUT, MYSQL_OPT_READ_TIMEOUT, MYSQL_OPT_WRITE_TIMEOUT };
+
+struct MYSQL {
+    int generation = -1;        // 建连时服务端的generation，和当前不一致即连接已断
+    unsigned long threadId = 0;
+    const char *error = "";
+};
+
+struct MYSQL_STMT {
+    MYSQL *conn;
+    unsigned int err = 0;
+};
+
+struct MYSQL_BIND {
+    unsigned long *length;
+    bool *is_null;
+    void *buffer;
+    bool *error;
+    enum enum_field_types buffer_type;
+    unsigned long buffer_length;
+};
+
+#define MYSQL_NO_DATA 100
+
+inline bool fake_lost(MYSQL *sql) { return sql->generation != fakemysql::generation; }
+
+inline MYSQL *mysql_init(MYSQL *) { return new MYSQL(); }
+inline int mysql_options(MYSQL *, enum mysql_option, const void *) { return 0; }
+inline MYSQL *mysql_real_connect(MYSQL *sql, const char *, const char *, const char *,
+                                 const char *, unsigned int, const char *, unsigned long) {
+    if (!fakemysql::serverUp) {
+        sql->error = "Can't connect to MySQL server";
+        return nullptr;
+    }
+    sql->generation = fakemysql::generation;
+    sql->threadId = ++fakemysql::nextThreadId;
+    fakemysql::connects++;
+    return sql;
+}
+inline void mysql_close(MYSQL *sql) { delete sql; }
+inline const char *mysql_error(MYSQL *sql) { return sql->error; }
+inline unsigned long mysql_thread_id(MYSQL *sql) { return sql->threadId; }
+inline int mysql_ping(MYSQL *sql) {
+    if (fake_lost(sql)) {
+        sql->error = "Lost connection to MySQL server";
+        return 1;
+    }
+    return 0;
+}
+inline void mysql_library_end() {}
+
+inline MYSQL_STMT *mysql_stmt_init(MYSQL *sql) { return new MYSQL_STMT{sql}; }
+inline bool mysql_stmt_close(MYSQL_STMT *stmt) {
+    delete stmt;
+    return false;
+}
+inline unsigned int mysql_stmt_errno(MYSQL_STMT *stmt) { return stmt->err; }
+inline const char *mysql_stmt_error(MYSQL_STMT *stmt) { return stmt->err ? "Lost connection to MySQL server" : ""; }
+inline int mysql_stmt_prepare(MYSQL_STMT *stmt, const char *, unsigned long) {
+    stmt->err = fake_lost(stmt->conn) ? CR_SERVER_LOST : 0;
+    if (!stmt->err) {
+        fakemysql::prepares++;
+    }
+    return stmt->err ? 1 : 0;
+}
+inline bool mysql_stmt_bind_param(MYSQL_STMT *, MYSQL_BIND *) { return false; }
+inline int mysql_stmt_execute(MYSQL_STMT *stmt) {
+    stmt->err = fake_lost(stmt->conn) ? CR_SERVER_LOST : 0;
+    return stmt->err ? 1 : 0;
+}
+
+#endif // FAKE_MYSQL_H
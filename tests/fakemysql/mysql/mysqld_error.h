@@ -0,0 +1,7 @@
+#ifndef FAKE_MYSQLD_ERROR_H
+#define FAKE_MYSQLD_ERROR_H
+
+#define ER_UNKNOWN_STMT_HANDLER 1243
+#define ER_NEED_REPREPARE 1615
+
+#endif // FAKE_MYSQLD_ERROR_H
@@ -0,0 +1,144 @@
+#include "gtest/gtest.h"
+#include <string>
+#include "../src/http/httprequest.h"
+
+static const std::string LOGIN_POST =
+    "POST /login HTTP/1.1\r\n"
+    "Host: localhost\r\n"
+    "Connection: keep-alive\r\n"
+    "Content-Type: application/x-www-form-urlencoded\r\n"
+    "content-length: 27\r\n"
+    "\r\n"
+    "username=alice&password=pw1";
+
+static const std::string INDEX_GET =
+    "GET / HTTP/1.1\r\n"
+    "Host: localhost\r\n"
+    "Connection: keep-alive\r\n"
+    "\r\n";
+
+// 测试keep-alive连接上POST后面紧跟流水线上的GET：请求体按Content-Length截取，不吞掉下一个请求
+TEST(HttpRequestTest, PipelinedGetAfterKeepAlivePost) {
+    Buffer buff;
+    buff.Append(LOGIN_POST + INDEX_GET);
+    HttpRequest request;
+
+    ASSERT_TRUE(request.parse(buff));
+    EXPECT_EQ(request.method(), "POST");
+    EXPECT_EQ(request.path(), "/login.html");
+    EXPECT_TRUE(request.IsKeepAlive());
+    EXPECT_EQ(request.GetPost("username"), "alice");
+    EXPECT_EQ(request.GetPost("password"), "pw1");
+    EXPECT_TRUE(request.AuthPending());
+    EXPECT_EQ(std::string(buff.Peek(), buff.ReadableBytes()), INDEX_GET);
+
+    request.Init();
+    ASSERT_TRUE(request.parse(buff));
+    EXPECT_EQ(request.method(), "GET");
+    EXPECT_EQ(request.path(), "/index.html");
+    EXPECT_TRUE(request.IsKeepAlive());
+    EXPECT_EQ(buff.ReadableBytes(), 0u);
+}
+
+// 测试请求体分几次到达：没收全时不消费缓冲区，收全后再解析
+TEST(HttpRequestTest, WaitsForTheWholeBody) {
+    Buffer buff;
+    HttpRequest request;
+    size_t split = LOGIN_POST.size() - 10;
+    buff.Append(LOGIN_POST.substr(0, split));
+
+    EXPECT_FALSE(request.parse(buff));
+    EXPECT_TRUE(request.Incomplete());
+    EXPECT_EQ(buff.ReadableBytes(), split);
+
+    buff.Append(LOGIN_POST.substr(split) + INDEX_GET);
+    request.Init();
+    ASSERT_TRUE(request.parse(buff));
+    EXPECT_FALSE(request.Incomplete());
+    EXPECT_EQ(request.GetPost("password"), "pw1");
+    EXPECT_EQ(std::string(buff.Peek(), buff.ReadableBytes()), INDEX_GET);
+}
+
+// 测试头部没有收全
+TEST(HttpRequestTest, WaitsForTheEndOfHeaders) {
+    Buffer buff;
+    HttpRequest request;
+    buff.Append(INDEX_GET.substr(0, INDEX_GET.size() - 2));
+    EXPECT_FALSE(request.parse(buff));
+    EXPECT_TRUE(request.Incomplete());
+
+    buff.Append("\r\n");
+    request.Init();
+    ASSERT_TRUE(request.parse(buff));
+    EXPECT_EQ(request.path(), "/index.html");
+}
+
+// 测试Content-Length头名不区分大小写
+TEST(HttpRequestTest, ContentLengthIsCaseInsensitive) {
+    for (const char* name : { "Content-Length", "content-length", "CONTENT-LENGTH" }) {
+        Buffer buff;
+        HttpRequest request;
+        buff.Append(std::string("POST /echo HTTP/1.1\r\n") + name + ": 5\r\n\r\nhello" + INDEX_GET);
+        ASSERT_TRUE(request.parse(buff)) << name;
+        EXPECT_EQ(std::string(buff.Peek(), buff.ReadableBytes()), INDEX_GET) << name;
+    }
+}
+
+// 测试头部超过上限：还没收到空行时就判定为完整请求并以431拒绝，不再等待更多数据
+TEST(HttpRequestTest, RejectsOversizedHeaders) {
+    size_t saved = HttpRequest::maxHeaderBytes;
+    HttpRequest::maxHeaderBytes = 256;
+    std::string big = "GET / HTTP/1.1\r\nX-Padding: " + std::string(300, 'a');
+
+    Buffer buff;
+    buff.Append(big);
+    EXPECT_TRUE(HttpRequest::IsComplete(buff));
+    HttpRequest request;
+    EXPECT_FALSE(request.parse(buff));
+    EXPECT_FALSE(request.Incomplete());
+    EXPECT_EQ(request.ErrorCode(), 431);
+
+    /* 带空行的完整头部同样按总长度判断 */
+    Buffer full;
+    full.Append(big + "\r\n\r\n");
+    request.Init();
+    EXPECT_FALSE(request.parse(full));
+    EXPECT_EQ(request.ErrorCode(), 431);
+
+    /* 上限以内的不完整头部继续等待 */
+    Buffer partial;
+    partial.Append("GET / HTTP/1.1\r\nHost: localhost\r\n");
+    request.Init();
+    EXPECT_FALSE(HttpRequest::IsComplete(partial));
+    EXPECT_FALSE(request.parse(partial));
+    EXPECT_TRUE(request.Incomplete());
+    HttpRequest::maxHeaderBytes = saved;
+}
+
+// 测试Content-Length超过上限：只看到头部就以413拒绝，不缓存请求体
+TEST(HttpRequestTest, RejectsOversizedBody) {
+    size_t saved = HttpRequest::maxBodyBytes;
+    HttpRequest::maxBodyBytes = 16;
+    Buffer buff;
+    buff.Append("POST /login HTTP/1.1\r\nContent-Length: 17\r\n\r\nusername=a");
+    EXPECT_TRUE(HttpRequest::IsComplete(buff));
+    HttpRequest request;
+    EXPECT_FALSE(request.parse(buff));
+    EXPECT_FALSE(request.Incomplete());
+    EXPECT_EQ(request.ErrorCode(), 413);
+
+    /* 负数被strtoul当成极大值，同样拒绝 */
+    Buffer negative;
+    negative.Append("POST /login HTTP/1.1\r\nContent-Length: -1\r\n\r\n");
+    request.Init();
+    EXPECT_FALSE(request.parse(negative));
+    EXPECT_EQ(request.ErrorCode(), 413);
+
+    /* 恰好等于上限的请求体正常解析 */
+    Buffer exact;
+    exact.Append("POST /login HTTP/1.1\r\nContent-Length: 16\r\n\r\nusername=a&pw=bc");
+    request.Init();
+    EXPECT_TRUE(request.parse(exact));
+    EXPECT_EQ(exact.ReadableBytes(), 0u);
+    HttpRequest::maxBodyBytes = saved;
+}
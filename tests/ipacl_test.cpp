@@ -0,0 +1,72 @@
+
+#include "gtest/gtest.h"
+#include <arpa/inet.h>
+#include "../src/iplist/ipacl.h"
+
+static uint32_t V4(const char* ip) {
+    in_addr addr;
+    inet_pton(AF_INET, ip, &addr);
+    return addr.s_addr;
+}
+
+static in6_addr V6(const char* ip) {
+    in6_addr addr;
+    inet_pton(AF_INET6, ip, &addr);
+    return addr;
+}
+
+// 测试最长前缀匹配：更具体的规则优先，与顺序无关
+TEST(IpAclTest, LongestPrefixWins) {
+    IpAcl acl("");
+    EXPECT_TRUE(acl.AddRule("deny 10.1.2.0/24"));
+    EXPECT_TRUE(acl.AddRule("deny 10.0.0.0/8"));
+    EXPECT_TRUE(acl.AddRule("allow 10.1.0.0/16"));
+    EXPECT_FALSE(acl.Allowed(V4("10.2.3.4")));
+    EXPECT_TRUE(acl.Allowed(V4("10.1.3.4")));
+    EXPECT_FALSE(acl.Allowed(V4("10.1.2.200")));
+    EXPECT_TRUE(acl.Allowed(V4("192.168.0.1")));
+    EXPECT_EQ(acl.RuleCount(), 3u);
+}
+
+// 测试默认拒绝与单个地址
+TEST(IpAclTest, DefaultDenyAndHostRule) {
+    IpAcl acl("");
+    EXPECT_TRUE(acl.AddRule("default deny  # 白名单模式"));
+    EXPECT_TRUE(acl.AddRule("allow 127.0.0.1"));
+    EXPECT_TRUE(acl.Allowed(V4("127.0.0.1")));
+    EXPECT_FALSE(acl.Allowed(V4("127.0.0.2")));
+}
+
+// 测试IPv6规则以及IPv4映射地址
+TEST(IpAclTest, Ipv6) {
+    IpAcl acl("");
+    EXPECT_TRUE(acl.AddRule("deny 2001:db8::/32"));
+    EXPECT_TRUE(acl.AddRule("deny ::ffff:1.2.3.0/120"));
+    EXPECT_FALSE(acl.Allowed(V6("2001:db8:1::1")));
+    EXPECT_TRUE(acl.Allowed(V6("2001:db9::1")));
+    EXPECT_FALSE(acl.Allowed(V4("1.2.3.9")));
+}
+
+// 测试非法规则
+TEST(IpAclTest, InvalidRules) {
+    IpAcl acl("");
+    EXPECT_TRUE(acl.AddRule("   "));
+    EXPECT_FALSE(acl.AddRule("deny 1.2.3.4/33"));
+    EXPECT_FALSE(acl.AddRule("block 1.2.3.4"));
+    EXPECT_FALSE(acl.AddRule("deny not-an-ip"));
+    EXPECT_EQ(acl.RuleCount(), 0u);
+}
+
+TEST(IpAclTest, MalformedPrefixIsNotAHostRule) {
+    IpAcl acl("");
+    /* 不能把非法前缀当成没有前缀，变成 /32 的主机规则 */
+    EXPECT_FALSE(acl.AddRule("deny 10.0.0.0/-5"));
+    EXPECT_FALSE(acl.AddRule("deny 10.0.0.0/+8"));
+    EXPECT_FALSE(acl.AddRule("deny 10.0.0.0/ 8"));
+    EXPECT_FALSE(acl.AddRule("deny 10.0.0.0/"));
+    EXPECT_FALSE(acl.AddRule("deny 2001:db8::/-1"));
+    EXPECT_EQ(acl.RuleCount(), 0u);
+    EXPECT_TRUE(acl.Allowed(V4("10.0.0.0")));
+    EXPECT_TRUE(acl.AddRule("deny 10.0.0.0/0"));
+    EXPECT_FALSE(acl.Allowed(V4("192.168.1.1")));
+}
@@ -0,0 +1,39 @@
+
+#include "gtest/gtest.h"
+#include <thread>
+#include "../src/iplist/iplimiter.cpp"
+
+// 测试并发连接数上限与释放
+TEST(IpLimiterTest, ConnectionLimit) {
+    IpLimiter limiter(1024, 2, 0, 0);
+    EXPECT_TRUE(limiter.Acquire(1));
+    EXPECT_TRUE(limiter.Acquire(1));
+    EXPECT_FALSE(limiter.Acquire(1));
+    EXPECT_TRUE(limiter.Acquire(2));
+    limiter.Release(1);
+    EXPECT_TRUE(limiter.Acquire(1));
+    EXPECT_EQ(limiter.RejectedConns(), 1u);
+}
+
+// 测试令牌桶：突发用完后拒绝，等待后恢复
+TEST(IpLimiterTest, TokenBucket) {
+    IpLimiter limiter(1024, 0, 100, 5);
+    for (int i = 0; i < 5; i++) {
+        EXPECT_TRUE(limiter.AllowRequest(3));
+    }
+    EXPECT_FALSE(limiter.AllowRequest(3));
+    EXPECT_TRUE(limiter.AllowRequest(4));
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    EXPECT_TRUE(limiter.AllowRequest(3));
+}
+
+// 测试表满时淘汰没有活跃连接的旧条目
+TEST(IpLimiterTest, EvictsIdleEntries) {
+    IpLimiter limiter(64, 1, 0, 0);
+    for (uint32_t ip = 1; ip <= 10000; ip++) {
+        EXPECT_TRUE(limiter.Acquire(ip));
+        limiter.Release(ip);
+    }
+    EXPECT_TRUE(limiter.Acquire(7));
+    EXPECT_FALSE(limiter.Acquire(7));
+}
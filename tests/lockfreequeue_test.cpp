@@ -0,0 +1,126 @@
+#include "gtest/gtest.h"
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "../src/log/lockfreeQueue.h"
+
+// 测试容量取整、满/空时立即返回false，以及多次回绕后仍保持FIFO
+TEST(LockFreeQueueTest, FullEmptyAndWrap) {
+    LockFreeQueue<int> queue(5);
+    ASSERT_EQ(queue.capacity(), 8u);
+    int item = -1;
+    EXPECT_FALSE(queue.TryPop(item));
+    int next = 0, expect = 0;
+    for (int round = 0; round < 100; round++) {
+        while (queue.TryPush(next)) {
+            next++;
+        }
+        /* 满了之后失败的TryPush不改变队列 */
+        EXPECT_FALSE(queue.TryPush(-1));
+        for (int i = 0; i < 3 + round % 5; i++) {
+            ASSERT_TRUE(queue.TryPop(item));
+            ASSERT_EQ(item, expect++);
+        }
+    }
+    while (queue.TryPop(item)) {
+        ASSERT_EQ(item, expect++);
+    }
+    EXPECT_EQ(expect, next);
+    EXPECT_FALSE(queue.TryPop(item));
+}
+
+// 测试多个生产者同时往有界队列里写：恰好capacity个成功，其余都因队列满而失败，不丢不重
+TEST(LockFreeQueueTest, ConcurrentPushStopsWhenFull) {
+    const int producers = 8;
+    const int attempts = 1000;
+    LockFreeQueue<uint64_t> queue(1024);
+    std::atomic<int> accepted(0);
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++) {
+        threads.emplace_back([&queue, &accepted, p]() {
+            for (int i = 0; i < attempts; i++) {
+                if (queue.TryPush(static_cast<uint64_t>(p) * attempts + i)) {
+                    accepted++;
+                }
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    EXPECT_EQ(accepted.load(), 1024);
+    std::vector<int> seen(producers * attempts, 0);
+    uint64_t item;
+    int popped = 0;
+    while (queue.TryPop(item)) {
+        ASSERT_LT(item, seen.size());
+        seen[item]++;
+        popped++;
+    }
+    EXPECT_EQ(popped, 1024);
+    for (int count : seen) {
+        EXPECT_LE(count, 1);
+    }
+}
+
+// 测试N个生产者、M个消费者并发：每个元素恰好被取出一次；同一个消费者看到的同一生产者的元素保持写入顺序
+TEST(LockFreeQueueTest, MpmcEveryItemExactlyOnce) {
+    const int producers = 4;
+    const int consumers = 4;
+    const uint64_t perProducer = 100000;
+    LockFreeQueue<uint64_t> queue(64);
+    std::atomic<uint64_t> consumed(0);
+    std::atomic<uint64_t> fullHits(0);
+    std::vector<std::vector<uint64_t>> received(consumers);
+    std::vector<std::thread> threads;
+    for (int c = 0; c < consumers; c++) {
+        threads.emplace_back([&, c]() {
+            uint64_t item;
+            while (consumed.load(std::memory_order_relaxed) < producers * perProducer) {
+                if (queue.TryPop(item)) {
+                    received[c].push_back(item);
+                    consumed.fetch_add(1, std::memory_order_relaxed);
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (int p = 0; p < producers; p++) {
+        threads.emplace_back([&, p]() {
+            for (uint64_t i = 0; i < perProducer; i++) {
+                /* 高32位是生产者编号，低32位是序号 */
+                while (!queue.TryPush(static_cast<uint64_t>(p) << 32 | i)) {
+                    fullHits.fetch_add(1, std::memory_order_relaxed);
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    std::vector<std::vector<uint8_t>> seen(producers, std::vector<uint8_t>(perProducer, 0));
+    for (int c = 0; c < consumers; c++) {
+        std::vector<int64_t> last(producers, -1);
+        for (uint64_t item : received[c]) {
+            uint64_t p = item >> 32, seq = item & 0xFFFFFFFFu;
+            ASSERT_LT(p, static_cast<uint64_t>(producers));
+            ASSERT_LT(seq, perProducer);
+            ASSERT_GT(static_cast<int64_t>(seq), last[p]) << "consumer " << c << " producer " << p;
+            last[p] = seq;
+            ASSERT_EQ(seen[p][seq]++, 0) << "duplicate " << p << ":" << seq;
+        }
+    }
+    for (int p = 0; p < producers; p++) {
+        for (uint64_t i = 0; i < perProducer; i++) {
+            ASSERT_EQ(seen[p][i], 1) << "missing " << p << ":" << i;
+        }
+    }
+    uint64_t item;
+    EXPECT_FALSE(queue.TryPop(item));
+    /* 队列只有64格，记录生产者因队列满而重试的次数 */
+    RecordProperty("full_hits", std::to_string(fullHits.load()));
+}
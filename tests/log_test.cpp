@@ -0,0 +1,409 @@
+#include "gtest/gtest.h"
+#include <sys/wait.h>
+#include <unistd.h>
+#include <time.h>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../src/log/log.h"
+
+namespace fs = std::filesystem;
+
+/* Log是进程内单例，只能init一次：每个用例在子进程里写日志，exit时Log析构把缓冲区写完，父进程检查文件 */
+static void RunChild(const std::function<void()>& body)
+{
+    pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0) {
+        body();
+        exit(0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    ASSERT_TRUE(WIFEXITED(status));
+    ASSERT_EQ(WEXITSTATUS(status), 0);
+}
+
+class LogDirTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        char tmpl[] = "/tmp/logtestXXXXXX";
+        ASSERT_NE(mkdtemp(tmpl), nullptr);
+        dir_ = tmpl;
+    }
+    void TearDown() override { fs::remove_all(dir_); }
+
+    static std::string Today() {
+        time_t now = time(nullptr);
+        tm t;
+        localtime_r(&now, &t);
+        return fmt::format("{:04}_{:02}_{:02}", t.tm_year + 1900, t.tm_mon + 1, t.tm_mday);
+    }
+    void WriteFile(const std::string& name, const std::string& content) {
+        std::ofstream(dir_ + "/" + name) << content;
+    }
+    std::string ReadFile(const std::string& name) {
+        std::ifstream in(dir_ + "/" + name);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    std::vector<std::string> Files() {
+        std::vector<std::string> names;
+        for (auto& entry : fs::directory_iterator(dir_)) {
+            names.push_back(entry.path().filename());
+        }
+        std::sort(names.begin(), names.end());
+        return names;
+    }
+
+    std::string dir_;
+};
+
+TEST_F(LogDirTest, RotationAndQuotaOnlyTouchOwnFiles) {
+    const size_t fileBytes = 16 << 10;
+    const size_t quota = 64 << 10;
+    /* 早于日志文件创建、名字里也带 .log 的其他文件：慢日志、另一个worker的日志 */
+    WriteFile("slow.log", "slow request\n");
+    WriteFile(Today() + ".w1.log", "worker 1\n");
+    sleep(1);
+    std::string dir = dir_;
+    RunChild([dir, fileBytes, quota]() {
+        Log::Instance()->SetRotation(fileBytes, quota, false);
+        Log::Instance()->init(1, dir.c_str(), ".log", 64);
+        std::string pad(80, 'x');
+        for (int i = 0; i < 5000; i++) {
+            LOG_INFO("line {} {}", i, pad);
+        }
+    });
+
+    EXPECT_EQ(ReadFile("slow.log"), "slow request\n");
+    EXPECT_EQ(ReadFile(Today() + ".w1.log"), "worker 1\n");
+    size_t own = 0, total = 0;
+    for (auto& name : Files()) {
+        if (name == "slow.log" || name == Today() + ".w1.log") {
+            continue;
+        }
+        EXPECT_EQ(name.rfind(Today(), 0), 0u) << name;
+        own++;
+        total += fs::file_size(dir_ + "/" + name);
+    }
+    /* 写了约500KB，只保留最新的几个文件；当前文件在最后一次检查配额之后还会继续写 */
+    EXPECT_GE(own, 2u);
+    EXPECT_LE(total, quota + fileBytes + (64 << 8) * 2);
+    /* 最早的文件已被删除，最后一行还在 */
+    EXPECT_FALSE(fs::exists(dir_ + "/" + Today() + ".log"));
+    bool foundLast = false;
+    for (auto& name : Files()) {
+        foundLast |= ReadFile(name).find("line 4999 ") != std::string::npos;
+    }
+    EXPECT_TRUE(foundLast);
+}
+
+TEST_F(LogDirTest, RotatedFilesAreCompressed) {
+    WriteFile("slow.log", "slow request\n");
+    std::string dir = dir_;
+    RunChild([dir]() {
+        Log::Instance()->SetRotation(8 << 10, 0, true);
+        Log::Instance()->init(1, dir.c_str(), ".log", 64);
+        for (int i = 0; i < 2000; i++) {
+            LOG_INFO("line {}", i);
+        }
+    });
+    size_t gz = 0;
+    for (auto& name : Files()) {
+        gz += name.size() > 3 && name.compare(name.size() - 3, 3, ".gz") == 0;
+    }
+    EXPECT_GE(gz, 1u);
+    EXPECT_EQ(ReadFile("slow.log"), "slow request\n");
+}
+
+// 测试LogRing写满与回绕：记录长度与容量互质，读写位置多次越过缓冲区末尾，取出的数据与写入的一致
+TEST(LogRingTest, WrapAround) {
+    LogRing ring(4096);
+    ASSERT_EQ(ring.Capacity(), 4096u);
+    std::string written, drained;
+    Buffer buff;
+    int seq = 0;
+    for (int round = 0; round < 200; round++) {
+        while (true) {
+            std::string rec = fmt::format("{:06}:{}|", seq, std::string(seq % 97, 'a' + seq % 26));
+            if (!ring.Append(rec.data(), rec.size())) {
+                /* 空间不够时整条放弃，已有数据不受影响 */
+                EXPECT_GT(rec.size(), ring.Capacity() - ring.ReadableBytes());
+                break;
+            }
+            written += rec;
+            seq++;
+        }
+        /* 每轮只取走一部分，下一轮从中间位置继续写 */
+        if (round % 3 != 2) {
+            ring.DrainTo(buff);
+            drained += buff.RetrieveAllToStr();
+        }
+    }
+    ring.DrainTo(buff);
+    drained += buff.RetrieveAllToStr();
+    EXPECT_EQ(ring.ReadableBytes(), 0u);
+    EXPECT_GT(written.size(), 50 * ring.Capacity());
+    EXPECT_EQ(drained, written);
+    /* 超过整个缓冲区的记录永远写不进去 */
+    std::string huge(ring.Capacity() + 1, 'x');
+    EXPECT_FALSE(ring.Append(huge.data(), huge.size()));
+}
+
+// 测试一个生产者线程和一个消费者线程并发：消费者看到的总是完整的记录，顺序与写入一致
+TEST(LogRingTest, ConcurrentProducerConsumer) {
+    LogRing ring(4096);
+    const int count = 200000;
+    std::atomic<bool> done(false);
+    std::thread producer([&ring, &done]() {
+        for (int i = 0; i < count; i++) {
+            std::string rec = fmt::format("{}\n", i);
+            while (!ring.Append(rec.data(), rec.size())) {
+                std::this_thread::yield();
+            }
+        }
+        done = true;
+    });
+    Buffer buff;
+    std::string pending;
+    int expect = 0;
+    bool ordered = true;
+    while (true) {
+        bool finished = done.load();
+        ring.DrainTo(buff);
+        pending += buff.RetrieveAllToStr();
+        size_t start = 0, end;
+        while ((end = pending.find('\n', start)) != std::string::npos) {
+            ordered &= std::stoi(pending.substr(start, end - start)) == expect++;
+            start = end + 1;
+        }
+        pending.erase(0, start);
+        if (finished && ring.ReadableBytes() == 0) {
+            break;
+        }
+    }
+    producer.join();
+    EXPECT_TRUE(ordered);
+    EXPECT_EQ(expect, count);
+    EXPECT_TRUE(pending.empty());
+}
+
+/* 解析 "t<线程> seq <序号>" 行，按线程收集序号 */
+static std::map<int, std::vector<int>> CollectSeqs(const std::string& content) {
+    std::map<int, std::vector<int>> seqs;
+    std::istringstream in(content);
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t pos = line.find(" t");
+        int thread = 0, seq = 0;
+        if (pos != std::string::npos && sscanf(line.c_str() + pos, " t%d seq %d", &thread, &seq) == 2) {
+            seqs[thread].push_back(seq);
+        }
+    }
+    return seqs;
+}
+
+// 测试多个线程同时写：每个线程的日志都完整，且保持各自的写入顺序
+TEST_F(LogDirTest, MultiThreadPerThreadOrder) {
+    const int threads = 8;
+    const int lines = 5000;
+    std::string dir = dir_;
+    RunChild([dir]() {
+        /* 每个线程的LogRing只有4KB，写线程要反复取空，生产者经常要等待 */
+        Log::Instance()->SetRotation(1 << 30, 0, false);
+        Log::Instance()->init(1, dir.c_str(), ".log", 16);
+        std::vector<std::thread> pool;
+        for (int t = 0; t < threads; t++) {
+            pool.emplace_back([t]() {
+                for (int i = 0; i < lines; i++) {
+                    LOG_INFO("t{} seq {}", t, i);
+                }
+            });
+        }
+        for (auto& th : pool) {
+            th.join();
+        }
+    });
+    auto seqs = CollectSeqs(ReadFile(Today() + ".log"));
+    ASSERT_EQ(seqs.size(), static_cast<size_t>(threads));
+    for (auto& kv : seqs) {
+        ASSERT_EQ(kv.second.size(), static_cast<size_t>(lines)) << "thread " << kv.first;
+        for (int i = 0; i < lines; i++) {
+            ASSERT_EQ(kv.second[i], i) << "thread " << kv.first;
+        }
+    }
+}
+
+// 测试关闭时写线程把所有LogRing取空：包括已经退出的线程留下的、以及退出前刚写入还没被取走的数据
+TEST_F(LogDirTest, WriterDrainsOnShutdown) {
+    const int lines = 3000;
+    std::string dir = dir_;
+    RunChild([dir]() {
+        Log::Instance()->SetRotation(1 << 30, 0, false);
+        Log::Instance()->init(1, dir.c_str(), ".log", 1024);
+        /* 已退出线程的LogRing被标记为detached，写线程取空后才回收 */
+        std::thread early([]() {
+            for (int i = 0; i < lines; i++) {
+                LOG_INFO("t1 seq {}", i);
+            }
+        });
+        early.join();
+        /* 没有flush，紧接着exit：析构时写线程必须把剩余的数据写完 */
+        for (int i = 0; i < lines; i++) {
+            LOG_INFO("t0 seq {}", i);
+        }
+    });
+    auto seqs = CollectSeqs(ReadFile(Today() + ".log"));
+    EXPECT_EQ(seqs[0].size(), static_cast<size_t>(lines));
+    EXPECT_EQ(seqs[1].size(), static_cast<size_t>(lines));
+    ASSERT_FALSE(seqs[0].empty());
+    EXPECT_EQ(seqs[0].back(), lines - 1);
+}
+
+#undef LOG_MODULE
+#define LOG_MODULE LOG_MOD_HTTP
+static void LogFromHttp(int i) {
+    LOG_DEBUG("http debug {}", i);
+}
+#undef LOG_MODULE
+#define LOG_MODULE LOG_MOD_CORE
+
+/* 子进程里的检查失败时以非0状态退出，由RunChild报告 */
+#define CHILD_EXPECT(cond)                                      \
+    do {                                                        \
+        if (!(cond)) {                                          \
+            fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            exit(1);                                            \
+        }                                                       \
+    } while (0)
+
+// 测试按模块覆盖级别：Enabled和LOG_*宏只看所在模块的级别，level < 0恢复跟随全局级别
+TEST_F(LogDirTest, ModuleLevelOverride) {
+    std::string dir = dir_;
+    RunChild([dir]() {
+        Log::Instance()->init(1, dir.c_str(), ".log", 1024);
+        CHILD_EXPECT(!Log::Enabled(0, LOG_MOD_HTTP));
+        Log::Instance()->SetModuleLevel(LOG_MOD_HTTP, 0);
+        Log::Instance()->SetModuleLevel(LOG_MOD_POOL, 3);
+        CHILD_EXPECT(Log::Enabled(0, LOG_MOD_HTTP));
+        CHILD_EXPECT(!Log::Enabled(0, LOG_MOD_CORE));
+        CHILD_EXPECT(Log::Enabled(1, LOG_MOD_CORE));
+        CHILD_EXPECT(!Log::Enabled(2, LOG_MOD_POOL));
+        CHILD_EXPECT(Log::Enabled(3, LOG_MOD_POOL));
+        LogFromHttp(1);
+        LOG_DEBUG("core debug {}", 1);
+
+        /* 改全局级别不影响已覆盖的模块 */
+        Log::Instance()->SetLevel(2);
+        CHILD_EXPECT(!Log::Enabled(1, LOG_MOD_CORE));
+        CHILD_EXPECT(Log::Enabled(0, LOG_MOD_HTTP));
+        CHILD_EXPECT(Log::Instance()->GetModuleLevel(LOG_MOD_POOL) == 3);
+
+        Log::Instance()->SetModuleLevel(LOG_MOD_HTTP, -1);
+        CHILD_EXPECT(!Log::Enabled(0, LOG_MOD_HTTP));
+        CHILD_EXPECT(Log::Instance()->GetModuleLevel(LOG_MOD_HTTP) == 2);
+        LogFromHttp(2);
+        CHILD_EXPECT(Log::ModuleByName("pool") == LOG_MOD_POOL);
+        CHILD_EXPECT(Log::ModuleByName("nosuch") == -1);
+    });
+    std::string content = ReadFile(Today() + ".log");
+    EXPECT_NE(content.find("http debug 1"), std::string::npos);
+    EXPECT_EQ(content.find("http debug 2"), std::string::npos);
+    EXPECT_EQ(content.find("core debug"), std::string::npos);
+}
+
+/* 覆盖各种参数类型和格式说明符 */
+static void LogSample() {
+    std::string name = "alice";
+    for (int i = 0; i < 50; i++) {
+        LOG_INFO("req {} from {}:{} took {:.3f}ms", i, "127.0.0.1", 8000u + i, i * 0.125);
+        LOG_WARN("user {} ok={} grade={} delta={}", name, i % 2 == 0, 'A' + i % 3, -1234567890123ll * i);
+        LOG_ERROR("[{:>6}] {}", fmt::string_view("id", 2), std::string(i, 'x'));
+    }
+}
+
+/* 每行去掉时间前缀 "YYYY-MM-DD HH:MM:SS " */
+static std::vector<std::string> Bodies(const std::string& content) {
+    std::vector<std::string> lines;
+    std::istringstream in(content);
+    std::string line;
+    while (std::getline(in, line)) {
+        lines.push_back(line.size() > 20 ? line.substr(20) : line);
+    }
+    return lines;
+}
+
+// 测试二进制模式写出的文件(含字典记录和进程重启后再次出现的文件头)用logdecode的解码逻辑还原后，
+// 与文本模式、延迟格式化模式的输出一致
+TEST_F(LogDirTest, BinaryRoundTrip) {
+    std::string textDir = dir_ + "/text", deferredDir = dir_ + "/deferred", binDir = dir_ + "/bin";
+    fs::create_directory(textDir);
+    fs::create_directory(deferredDir);
+    fs::create_directory(binDir);
+    RunChild([textDir]() {
+        Log::Instance()->init(0, textDir.c_str(), ".log", 1024, LOG_TEXT);
+        LogSample();
+    });
+    RunChild([deferredDir]() {
+        Log::Instance()->init(0, deferredDir.c_str(), ".log", 1024, LOG_DEFERRED);
+        LogSample();
+    });
+    /* 两个进程先后追加到同一个二进制文件，第二段的格式串编号重新分配 */
+    for (int run = 0; run < 2; run++) {
+        RunChild([binDir]() {
+            Log::Instance()->init(0, binDir.c_str(), ".log", 1024, LOG_BINARY);
+            LogSample();
+        });
+    }
+
+    std::vector<std::string> text = Bodies(ReadFile("text/" + Today() + ".log"));
+    ASSERT_EQ(text.size(), 150u);
+    EXPECT_EQ(text[0], "[info] : req 0 from 127.0.0.1:8000 took 0.000ms");
+    EXPECT_EQ(text[4], "[warn] : user alice ok=false grade=66 delta=-1234567890123");
+    EXPECT_EQ(text[5], "[error]: [    id] x");
+    EXPECT_EQ(Bodies(ReadFile("deferred/" + Today() + ".log")), text);
+
+    std::string bin = ReadFile("bin/" + Today() + ".log.bin");
+    ASSERT_EQ(bin.compare(0, sizeof(logrecord::FILE_MAGIC),
+                          std::string(logrecord::FILE_MAGIC, sizeof(logrecord::FILE_MAGIC))), 0);
+    /* 逐条遍历记录，数出字典记录：每个进程每个调用点一条 */
+    size_t dicts = 0, magics = 0;
+    for (size_t off = 0; off < bin.size();) {
+        if (bin.compare(off, sizeof(logrecord::FILE_MAGIC),
+                        std::string(logrecord::FILE_MAGIC, sizeof(logrecord::FILE_MAGIC))) == 0) {
+            magics++;
+            off += sizeof(logrecord::FILE_MAGIC);
+            continue;
+        }
+        logrecord::Header header;
+        ASSERT_LE(off + sizeof(header), bin.size());
+        memcpy(&header, bin.data() + off, sizeof(header));
+        ASSERT_GE(header.size, sizeof(header));
+        dicts += header.fmtId == logrecord::DICT_ID;
+        off += header.size;
+    }
+    EXPECT_EQ(magics, 2u);
+    EXPECT_EQ(dicts, 6u);
+
+    std::string decoded;
+    size_t badOffset = 0;
+    ASSERT_TRUE(logrecord::DecodeFile(bin.data(), bin.size(), [&decoded](const char* line, size_t len) {
+        decoded.append(line, len);
+    }, badOffset));
+    std::vector<std::string> twice(text);
+    twice.insert(twice.end(), text.begin(), text.end());
+    EXPECT_EQ(Bodies(decoded), twice);
+
+    /* 截断的文件：已解码的行照常输出，报告截断位置 */
+    decoded.clear();
+    EXPECT_FALSE(logrecord::DecodeFile(bin.data(), bin.size() - 3, [&decoded](const char* line, size_t len) {
+        decoded.append(line, len);
+    }, badOffset));
+    EXPECT_LT(badOffset, bin.size() - 3);
+    EXPECT_EQ(Bodies(decoded).size(), twice.size() - 1);
+}
@@ -0,0 +1,77 @@
+#include "gtest/gtest.h"
+#include <thread>
+#include <vector>
+#include "../src/metrics/metrics.cpp"
+
+TEST(MetricsTest, CounterSumsShards) {
+    Counter counter;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; t++) {
+        threads.emplace_back([&counter]() {
+            for (int i = 0; i < 100000; i++) {
+                counter.Add();
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    EXPECT_EQ(counter.Value(), 800000u);
+}
+
+// 每个值都落在自己桶的[下界, 上界)里，相对宽度不超过1/8
+TEST(MetricsTest, HistogramBuckets) {
+    for (uint64_t v : { 0ull, 1ull, 7ull, 8ull, 15ull, 16ull, 1000ull, 123456789ull, ~0ull >> 1 }) {
+        size_t idx = Histogram::BucketIndex(v);
+        ASSERT_LT(idx, Histogram::BUCKETS);
+        EXPECT_LE(Histogram::BucketLower(idx), v);
+        if (idx + 1 < Histogram::BUCKETS) {
+            uint64_t upper = Histogram::BucketLower(idx + 1);
+            EXPECT_GT(upper, v);
+            EXPECT_LE(upper - Histogram::BucketLower(idx), std::max<uint64_t>(1, v / 8));
+        }
+    }
+    EXPECT_EQ(Histogram::BucketIndex(~0ull), Histogram::BUCKETS - 1);
+}
+
+TEST(MetricsTest, HistogramPercentile) {
+    Histogram hist;
+    for (uint64_t v = 1; v <= 10000; v++) {
+        hist.Observe(v);
+    }
+    Histogram::Snapshot snap = hist.Snap();
+    EXPECT_EQ(snap.count, 10000u);
+    EXPECT_EQ(snap.sum, 10000u * 10001 / 2);
+    for (double q : { 0.5, 0.9, 0.99, 0.999 }) {
+        double expect = q * 10000;
+        EXPECT_NEAR(snap.Percentile(q), expect, expect / 8) << q;
+    }
+    EXPECT_EQ(Histogram().Snap().Percentile(0.99), 0u);
+}
+
+TEST(MetricsTest, PrometheusText) {
+    Metrics* m = Metrics::Instance();
+    m->NewCounter("test_requests_total", "Requests", "code=\"200\"")->Add(3);
+    EXPECT_EQ(m->NewCounter("test_requests_total", "Requests", "code=\"200\""),
+              m->NewCounter("test_requests_total", "Requests", "code=\"200\""));
+    m->NewCounter("test_requests_total", "Requests", "code=\"404\"")->Add();
+    Histogram* hist = m->NewHistogram("test_latency_seconds", "Latency");
+    hist->Observe(10);
+    hist->Observe(100);
+    hist->Observe(20000000);
+    int owner = 0;
+    m->NewCallback("test_queue_depth", "Queue", "gauge", []() { return 5.0; }, "", &owner);
+
+    std::string text = m->Prometheus();
+    EXPECT_NE(text.find("# TYPE test_requests_total counter\n"
+                        "test_requests_total{code=\"200\"} 3\n"
+                        "test_requests_total{code=\"404\"} 1\n"), std::string::npos);
+    EXPECT_NE(text.find("test_latency_seconds_bucket{le=\"1.6e-05\"} 1\n"), std::string::npos);
+    EXPECT_NE(text.find("test_latency_seconds_bucket{le=\"0.000128\"} 2\n"), std::string::npos);
+    EXPECT_NE(text.find("test_latency_seconds_bucket{le=\"+Inf\"} 3\n"), std::string::npos);
+    EXPECT_NE(text.find("test_latency_seconds_count 3\n"), std::string::npos);
+    EXPECT_NE(text.find("test_queue_depth 5\n"), std::string::npos);
+
+    m->Unregister(&owner);
+    EXPECT_EQ(m->Prometheus().find("test_queue_depth"), std::string::npos);
+}
@@ -0,0 +1,49 @@
+#include "gtest/gtest.h"
+#include <sys/wait.h>
+#include <unistd.h>
+#include "../src/metrics/sharedstats.cpp"
+
+TEST(SharedStatsTest, ChildWritesAreVisibleToParent) {
+    SharedStats* stats = SharedStats::Create(2);
+    ASSERT_NE(stats, nullptr);
+    EXPECT_EQ(stats->Workers(), 2);
+    EXPECT_EQ(stats->Alive(), 0);
+
+    pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0) {
+        WorkerStats& slot = stats->Slot(1);
+        slot.counters[STAT_ACCEPTED] = 5;
+        slot.counters[STAT_BYTES_OUT] = 1000;
+        slot.connections = 3;
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    stats->Slot(0).counters[STAT_ACCEPTED] = 2;
+    EXPECT_EQ(stats->Total(STAT_ACCEPTED), 7u);
+    EXPECT_EQ(stats->Total(STAT_BYTES_OUT), 1000u);
+    EXPECT_EQ(stats->Connections(), 3);
+    SharedStats::Destroy(stats);
+}
+
+TEST(SharedStatsTest, RetireKeepsTotals) {
+    SharedStats* stats = SharedStats::Create(1);
+    ASSERT_NE(stats, nullptr);
+    WorkerStats& slot = stats->Slot(0);
+    slot.pid = 1234;
+    slot.counters[STAT_RESPONSES] = 10;
+    slot.connections = 4;
+    EXPECT_EQ(stats->Alive(), 1);
+
+    /* 重启后的worker从0开始计数，总数不回退 */
+    stats->Retire(0);
+    EXPECT_EQ(stats->Alive(), 0);
+    EXPECT_EQ(slot.counters[STAT_RESPONSES].load(), 0u);
+    EXPECT_EQ(stats->Connections(), 0);
+    slot.restarts++;
+    slot.counters[STAT_RESPONSES] = 3;
+    EXPECT_EQ(stats->Total(STAT_RESPONSES), 13u);
+    EXPECT_EQ(stats->Restarts(), 1u);
+    SharedStats::Destroy(stats);
+}
@@ -0,0 +1,61 @@
+#include "gtest/gtest.h"
+#include <unistd.h>
+#include <fstream>
+#include <sstream>
+#include "../src/metrics/slowlog.cpp"
+
+static std::string ReadFile(const std::string& path) {
+    std::ifstream in(path);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+TEST(SlowLogTest, TraceStages) {
+    RequestTrace trace;
+    trace.Mark(RequestTrace::ACCEPT);
+    trace.Mark(RequestTrace::PARSED);
+    EXPECT_EQ(trace.Begin(), trace.tsc[RequestTrace::PARSED]);
+    trace.Mark(RequestTrace::FIRST_READ);
+    EXPECT_EQ(trace.Begin(), trace.tsc[RequestTrace::FIRST_READ]);
+    trace.MarkOnce(RequestTrace::FIRST_READ);
+    EXPECT_EQ(trace.Begin(), trace.tsc[RequestTrace::FIRST_READ]);
+
+    trace.Next();
+    EXPECT_NE(trace.tsc[RequestTrace::ACCEPT], 0u);
+    EXPECT_EQ(trace.Begin(), 0u);
+    EXPECT_EQ(trace.TotalUs(), 0);
+}
+
+TEST(SlowLogTest, OnlySlowRequestsAreLogged) {
+    char path[] = "/tmp/slowlog_testXXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    close(fd);
+    sockaddr_in addr = {};
+    addr.sin_addr.s_addr = htonl(0x7f000001);
+    addr.sin_port = htons(8080);
+    {
+        SlowLog slow(path, 20);
+        RequestTrace fast;
+        fast.Mark(RequestTrace::FIRST_READ);
+        fast.Mark(RequestTrace::LAST_WRITE);
+        EXPECT_FALSE(slow.Check(fast, addr, "GET", "/fast", 200, 10));
+
+        RequestTrace trace;
+        trace.Mark(RequestTrace::ACCEPT);
+        trace.Mark(RequestTrace::FIRST_READ);
+        trace.Mark(RequestTrace::WORK_START);
+        usleep(30 * 1000);
+        trace.Mark(RequestTrace::WORK_DONE);
+        trace.Mark(RequestTrace::LAST_WRITE);
+        EXPECT_GE(trace.TotalUs(), 25000);
+        EXPECT_TRUE(slow.Check(trace, addr, "POST", "/login", 200, 1234));
+    }
+    std::string text = ReadFile(path);
+    unlink(path);
+    EXPECT_EQ(text.find("/fast"), std::string::npos);
+    EXPECT_NE(text.find("127.0.0.1:8080 POST /login 200 1234B total="), std::string::npos) << text;
+    EXPECT_NE(text.find(" work_done+"), std::string::npos) << text;
+    EXPECT_EQ(text.find(" parsed+"), std::string::npos) << text;
+}
@@ -0,0 +1,130 @@
+#include "gtest/gtest.h"
+#include <chrono>
+#include <functional>
+#include <thread>
+#include "../src/pool/sqlconnpool.h"
+
+/* 编译时 -Ifakemysql，<mysql/mysql.h> 是 tests/fakemysql 下的替身 */
+
+static bool WaitFor(const std::function<bool()>& pred, int timeoutMs = 3000) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (!pred()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return true;
+}
+
+class SqlConnPoolTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        fakemysql::Restart(true);
+        pool = SqlConnPool::Instance();
+    }
+    void TearDown() override {
+        pool->ClosePool();
+    }
+    /* 健康检查间隔设得很长，只有发现断连时才会被唤醒 */
+    void Init(int conns) {
+        pool->Init("localhost", 3306, "root", "root", "webserver", conns, conns, 100, 60000);
+    }
+    SqlConnPool* pool;
+};
+
+// 测试执行时连接断开：不在死连接上重试；归还时关闭并换一个新连接，新连接上重新prepare
+TEST_F(SqlConnPoolTest, ReplacesConnectionLostDuringExecute) {
+    Init(1);
+    uint64_t reconnects = pool->GetStats().reconnects;
+    MYSQL* sql = pool->GetConn();
+    ASSERT_NE(sql, nullptr);
+    unsigned long oldThread = mysql_thread_id(sql);
+    int prepares = fakemysql::prepares;
+    ASSERT_NE(pool->Execute(sql, STMT_USER_SELECT, nullptr), nullptr);
+    EXPECT_EQ(fakemysql::prepares, prepares + 1);
+    pool->FreeConn(sql);
+    /* 同一个句柄上复用已prepare的语句 */
+    sql = pool->GetConn();
+    ASSERT_NE(pool->Execute(sql, STMT_USER_SELECT, nullptr), nullptr);
+    EXPECT_EQ(fakemysql::prepares, prepares + 1);
+    pool->FreeConn(sql);
+
+    fakemysql::Restart();
+    sql = pool->GetConn();
+    ASSERT_NE(sql, nullptr);
+    EXPECT_EQ(mysql_thread_id(sql), oldThread);
+    EXPECT_EQ(pool->Execute(sql, STMT_USER_SELECT, nullptr), nullptr);
+    pool->FreeConn(sql);
+
+    SqlConnPool::Stats stats = pool->GetStats();
+    EXPECT_EQ(stats.reconnects, reconnects + 1);
+    EXPECT_EQ(stats.total, 1);
+    EXPECT_EQ(stats.idle, 1);
+
+    sql = pool->GetConn();
+    ASSERT_NE(sql, nullptr);
+    EXPECT_NE(mysql_thread_id(sql), oldThread);
+    prepares = fakemysql::prepares;
+    EXPECT_NE(pool->Execute(sql, STMT_USER_SELECT, nullptr), nullptr);
+    EXPECT_EQ(fakemysql::prepares, prepares + 1);
+    pool->FreeConn(sql);
+}
+
+// 测试发现一个断连后，其余刚用过的空闲连接也被立即ping并替换，不用等到下一个检查周期
+TEST_F(SqlConnPoolTest, PingsOtherIdleConnectionsAfterLoss) {
+    Init(3);
+    MYSQL* conns[3];
+    for (MYSQL*& sql : conns) {
+        sql = pool->GetConn();
+        ASSERT_NE(sql, nullptr);
+        ASSERT_NE(pool->Execute(sql, STMT_USER_SELECT, nullptr), nullptr);
+    }
+    for (MYSQL* sql : conns) {
+        pool->FreeConn(sql);
+    }
+    uint64_t reconnects = pool->GetStats().reconnects;
+
+    fakemysql::Restart();
+    MYSQL* sql = pool->GetConn();
+    ASSERT_NE(sql, nullptr);
+    EXPECT_EQ(pool->Execute(sql, STMT_USER_SELECT, nullptr), nullptr);
+    pool->FreeConn(sql);
+    EXPECT_TRUE(WaitFor([&] { return pool->GetStats().reconnects == reconnects + 3; }));
+
+    for (MYSQL*& conn : conns) {
+        conn = pool->GetConn();
+        ASSERT_NE(conn, nullptr);
+        EXPECT_NE(pool->Execute(conn, STMT_USER_SELECT, nullptr), nullptr);
+    }
+    for (MYSQL* conn : conns) {
+        pool->FreeConn(conn);
+    }
+    EXPECT_EQ(pool->GetStats().total, 3);
+}
+
+// 测试数据库重启后暂时连不上：断掉的连接被丢弃而不是放回池中；数据库恢复后重新建连
+TEST_F(SqlConnPoolTest, DropsLostConnectionWhileServerIsDown) {
+    Init(1);
+    uint64_t failures = pool->GetStats().connectFailures;
+    fakemysql::Restart(false);
+    MYSQL* sql = pool->GetConn();
+    ASSERT_NE(sql, nullptr);
+    EXPECT_EQ(pool->Execute(sql, STMT_USER_SELECT, nullptr), nullptr);
+    pool->FreeConn(sql);
+
+    SqlConnPool::Stats stats = pool->GetStats();
+    EXPECT_EQ(stats.total, 0);
+    EXPECT_GT(stats.connectFailures, failures);
+    EXPECT_EQ(pool->GetConn(), nullptr);
+
+    fakemysql::serverUp = true;
+    /* 建连失败后有RETRY_BACKOFF_MS的退避 */
+    EXPECT_TRUE(WaitFor([&] {
+        sql = pool->GetConn();
+        return sql != nullptr;
+    }));
+    ASSERT_NE(sql, nullptr);
+    EXPECT_NE(pool->Execute(sql, STMT_USER_SELECT, nullptr), nullptr);
+    pool->FreeConn(sql);
+}
@@ -0,0 +1,138 @@
+
+#include "gtest/gtest.h"
+#include <unistd.h>
+#include <thread>
+#include <vector>
+#include "../src/store/memorystore.cpp"
+#include "../src/store/sqlitestore.cpp"
+#include "../src/store/cachedstore.cpp"
+
+// 各后端对登录/注册的语义必须一致
+static void CheckStore(UserStore& store) {
+    EXPECT_EQ(store.Login("alice", "pw"), AuthResult::NO_USER);
+    EXPECT_EQ(store.Register("alice", "pw"), AuthResult::OK);
+    EXPECT_EQ(store.Register("alice", "other"), AuthResult::USER_EXISTS);
+    EXPECT_EQ(store.Login("alice", "pw"), AuthResult::OK);
+    EXPECT_EQ(store.Login("alice", "pw "), AuthResult::BAD_PASSWORD);
+    EXPECT_EQ(store.Login("alice'--", "pw"), AuthResult::NO_USER);
+}
+
+TEST(UserStoreTest, Memory) {
+    MemoryUserStore store;
+    CheckStore(store);
+    EXPECT_FALSE(store.Blocking());
+}
+
+TEST(UserStoreTest, Sqlite) {
+    char path[] = "/tmp/userstore_testXXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    close(fd);
+    {
+        SqliteUserStore store(path);
+        ASSERT_TRUE(store.IsOpen());
+        CheckStore(store);
+    }
+    {
+        // 重新打开后数据仍在
+        SqliteUserStore store(path);
+        EXPECT_EQ(store.Login("alice", "pw"), AuthResult::OK);
+    }
+    unlink(path);
+    unlink((std::string(path) + "-wal").c_str());
+    unlink((std::string(path) + "-shm").c_str());
+}
+
+// 测试并发注册同一个用户名只有一个成功
+TEST(UserStoreTest, ConcurrentRegister) {
+    MemoryUserStore store;
+    std::atomic<int> ok{0};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 8; i++) {
+        threads.emplace_back([&]() {
+            for (int j = 0; j < 1000; j++) {
+                if (store.Register("user" + std::to_string(j), "pw") == AuthResult::OK) {
+                    ok++;
+                }
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    EXPECT_EQ(ok, 1000);
+    EXPECT_EQ(store.Size(), 1000u);
+}
+
+// 测试SHA-256的标准向量
+TEST(UserStoreTest, Sha256) {
+    auto hex = [](const std::string& msg) {
+        uint8_t out[Sha256::DIGEST_LEN];
+        Sha256::Hash(msg.data(), msg.size(), out);
+        char buf[65];
+        for (size_t i = 0; i < sizeof(out); i++) {
+            snprintf(buf + 2 * i, 3, "%02x", out[i]);
+        }
+        return std::string(buf);
+    };
+    EXPECT_EQ(hex(""), "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    EXPECT_EQ(hex("abc"), "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    EXPECT_EQ(hex(std::string(1000, 'a')), "41edece42d63e8d9bf515a9ba6932e1c20cbc9f5a5d134645adb5db1b9737ea3");
+}
+
+// 记录后端被调用次数的内存存储
+class CountingStore : public MemoryUserStore {
+public:
+    AuthResult Login(const std::string& name, const std::string& pwd) override {
+        calls++;
+        return MemoryUserStore::Login(name, pwd);
+    }
+    AuthResult Register(const std::string& name, const std::string& pwd) override {
+        calls++;
+        return MemoryUserStore::Register(name, pwd);
+    }
+    int calls = 0;
+};
+
+TEST(UserStoreTest, CachedSemantics) {
+    auto backend = std::make_unique<CountingStore>();
+    CachedUserStore store(std::move(backend));
+    CheckStore(store);
+}
+
+// 测试命中、负缓存、注册失效与TTL过期
+TEST(UserStoreTest, CachedHitsAndExpiry) {
+    auto backend = std::make_unique<CountingStore>();
+    CountingStore* counter = backend.get();
+    CachedUserStore store(std::move(backend), 100, 50);
+
+    EXPECT_EQ(store.Login("bob", "pw"), AuthResult::NO_USER);
+    EXPECT_EQ(store.Login("bob", "pw"), AuthResult::NO_USER);
+    EXPECT_EQ(counter->calls, 1); // 负缓存
+
+    EXPECT_EQ(store.Register("bob", "pw"), AuthResult::OK);
+    EXPECT_EQ(counter->calls, 2);
+    EXPECT_EQ(store.Login("bob", "pw"), AuthResult::OK); // 注册覆盖了负缓存
+    EXPECT_EQ(store.Login("bob", "bad"), AuthResult::BAD_PASSWORD);
+    EXPECT_EQ(store.Register("bob", "x"), AuthResult::USER_EXISTS);
+    EXPECT_EQ(counter->calls, 2);
+    EXPECT_EQ(store.Hits(), 4u);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(120));
+    EXPECT_EQ(store.Login("bob", "pw"), AuthResult::OK);
+    EXPECT_EQ(counter->calls, 3); // 过期后回源
+}
+
+// 运行时调整TTL：之后写入的条目按新TTL过期
+TEST(UserStoreTest, CachedSetLimits) {
+    auto backend = std::make_unique<CountingStore>();
+    CountingStore* counter = backend.get();
+    CachedUserStore store(std::move(backend), 60000, 60000);
+    store.SetLimits(50, 50, 65536);
+
+    EXPECT_EQ(store.Login("carol", "pw"), AuthResult::NO_USER);
+    EXPECT_EQ(counter->calls, 1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(80));
+    EXPECT_EQ(store.Login("carol", "pw"), AuthResult::NO_USER);
+    EXPECT_EQ(counter->calls, 2);
+}
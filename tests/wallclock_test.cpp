@@ -0,0 +1,84 @@
+#include "gtest/gtest.h"
+#include <stdlib.h>
+#include <time.h>
+#include <chrono>
+#include <regex>
+#include <string>
+#include <thread>
+#include "../src/timer/wallclock.h"
+
+static const int64_t NS = 1000000000;
+/* 1994-11-06 08:49:37 UTC，RFC 7231里的示例时间 */
+static const int64_t EXAMPLE_SEC = 784111777;
+
+class WallClockTest : public ::testing::Test {
+protected:
+    /* LogPrefix按本地时间格式化，固定成UTC便于比较 */
+    static void SetUpTestSuite() {
+        setenv("TZ", "UTC", 1);
+        tzset();
+    }
+    static std::string Str(fmt::string_view view) { return std::string(view.data(), view.size()); }
+};
+
+// 测试同一秒内复用缓存(返回同一块内存)，换一秒后重新生成，包括跨分钟、跨天、回到更早的秒
+TEST_F(WallClockTest, LogPrefixCachedPerSecond) {
+    fmt::string_view first = WallClock::LogPrefix(EXAMPLE_SEC * NS);
+    EXPECT_EQ(Str(first), "1994-11-06 08:49:37 ");
+    fmt::string_view same = WallClock::LogPrefix(EXAMPLE_SEC * NS + NS - 1);
+    EXPECT_EQ(same.data(), first.data());
+    EXPECT_EQ(Str(same), "1994-11-06 08:49:37 ");
+
+    EXPECT_EQ(Str(WallClock::LogPrefix((EXAMPLE_SEC + 1) * NS)), "1994-11-06 08:49:38 ");
+    EXPECT_EQ(Str(WallClock::LogPrefix((EXAMPLE_SEC + 23) * NS)), "1994-11-06 08:50:00 ");
+    /* 08:49:37 到当天结束还有 15*3600 + 10*60 + 23 秒 */
+    EXPECT_EQ(Str(WallClock::LogPrefix((EXAMPLE_SEC + 54623) * NS)), "1994-11-07 00:00:00 ");
+    EXPECT_EQ(Str(WallClock::LogPrefix(EXAMPLE_SEC * NS)), "1994-11-06 08:49:37 ");
+}
+
+// 测试缓存按线程：另一个线程的结果不覆盖本线程已返回的string_view
+TEST_F(WallClockTest, LogPrefixCachePerThread) {
+    fmt::string_view mine = WallClock::LogPrefix(EXAMPLE_SEC * NS);
+    std::string other;
+    std::thread t([&other]() { other = Str(WallClock::LogPrefix((EXAMPLE_SEC + 60) * NS)); });
+    t.join();
+    EXPECT_EQ(other, "1994-11-06 08:50:37 ");
+    EXPECT_EQ(Str(mine), "1994-11-06 08:49:37 ");
+}
+
+// 测试HTTP Date为RFC 7231 IMF-fixdate，且与当前时间一致
+TEST_F(WallClockTest, HttpDateIsImfFixdate) {
+    static const std::regex IMF_FIXDATE(
+        "(Sun|Mon|Tue|Wed|Thu|Fri|Sat), [0-9]{2} (Jan|Feb|Mar|Apr|May|Jun|Jul|Aug|Sep|Oct|Nov|Dec) "
+        "[0-9]{4} [0-9]{2}:[0-9]{2}:[0-9]{2} GMT");
+    for (int attempt = 0; attempt < 3; attempt++) {
+        time_t before = time(nullptr);
+        std::string date = Str(WallClock::HttpDate());
+        time_t after = time(nullptr);
+        ASSERT_TRUE(std::regex_match(date, IMF_FIXDATE)) << date;
+        ASSERT_EQ(date.size(), 29u);
+        if (before != after) {
+            continue;   // 跨秒了，重试
+        }
+        tm t;
+        gmtime_r(&before, &t);
+        char expect[64];
+        strftime(expect, sizeof(expect), "%a, %d %b %Y %H:%M:%S GMT", &t);
+        EXPECT_EQ(date, expect);
+        return;
+    }
+}
+
+// 测试真实时间跨过一秒后，缓存的前缀和Date都会更新
+TEST_F(WallClockTest, RefreshesAfterSecondRollover) {
+    std::string prefix = Str(WallClock::LogPrefix());
+    std::string date = Str(WallClock::HttpDate());
+    EXPECT_EQ(Str(WallClock::LogPrefix()).size(), prefix.size());
+    time_t start = time(nullptr);
+    while (time(nullptr) == start) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    /* 开始取值与start之间也可能已经跨秒，那样两者本来就不同 */
+    EXPECT_NE(Str(WallClock::LogPrefix()), prefix);
+    EXPECT_NE(Str(WallClock::HttpDate()), date);
+}
@@ -0,0 +1,58 @@
+/*
+二进制日志解码工具
+用法: ./logdecode 2024_12_24.log.bin [more.bin ...] > out.log
+输出格式与文本日志一致：YYYY-MM-DD HH:MM:SS [level]: message
+*/
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "../src/log/logrecord.h"
+
+using namespace std;
+
+static bool ReadFile(const char* path, vector<char>& data)
+{
+    FILE* fp = fopen(path, "rb");
+    if (!fp) {
+        return false;
+    }
+    char buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) {
+        data.insert(data.end(), buf, buf + n);
+    }
+    fclose(fp);
+    return true;
+}
+
+static int Decode(const char* path)
+{
+    vector<char> data;
+    if (!ReadFile(path, data)) {
+        fprintf(stderr, "open %s failed\n", path);
+        return 1;
+    }
+    size_t badOffset = 0;
+    bool ok = logrecord::DecodeFile(data.data(), data.size(), [](const char* line, size_t len) {
+        fwrite(line, 1, len, stdout);
+    }, badOffset);
+    if (!ok) {
+        fprintf(stderr, "%s: truncated record at offset %zu\n", path, badOffset);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <log.bin> [...]\n", argv[0]);
+        return 1;
+    }
+    int ret = 0;
+    for (int i = 1; i < argc; i++) {
+        ret |= Decode(argv[i]);
+    }
+    return ret;
+}